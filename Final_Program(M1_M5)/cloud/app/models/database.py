@@ -32,9 +32,19 @@ def init_db():
             reg_read TEXT NOT NULL,
             interval INTEGER NOT NULL,
             version TEXT NOT NULL,
-            updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
+            updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
+            reg_period TEXT,
+            deadband TEXT,
+            slaves TEXT
         )
     ''')
+
+    # Databases created by older versions lack the newer columns
+    cursor.execute('PRAGMA table_info(config)')
+    config_columns = [col[1] for col in cursor.fetchall()]
+    for column in ('reg_period', 'deadband', 'slaves'):
+        if column not in config_columns:
+            cursor.execute(f'ALTER TABLE config ADD COLUMN {column} TEXT')
     
     # Create data table
     cursor.execute('''
@@ -51,10 +61,16 @@ def init_db():
             reg_7 INTEGER,
             reg_8 INTEGER,
             reg_9 INTEGER,
-            created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
+            created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
+            device INTEGER NOT NULL DEFAULT 1
         )
     ''')
 
+    # Rows stored before multi-inverter gateways belong to device 1
+    cursor.execute('PRAGMA table_info(sensor_data)')
+    if 'device' not in [col[1] for col in cursor.fetchall()]:
+        cursor.execute('ALTER TABLE sensor_data ADD COLUMN device INTEGER NOT NULL DEFAULT 1')
+
     # Create firmware table
     cursor.execute('''
         CREATE TABLE IF NOT EXISTS firmware (
@@ -128,16 +144,26 @@ def clear_command_queue():
     db.close()
 
 # Configuration operations
+DEFAULT_REG_PERIOD = [0] * 10  # ms per register, 0 = every polling interval
+# Report-by-exception; bands: number = absolute, "N%" = percent, 0 = device default
+DEFAULT_DEADBAND = {'enabled': False, 'keyframe_every': 60, 'bands': [0] * 10}
+# Inverters behind the gateway: [{"address": 1}, {"address": 2, "reg_read": [...]}]
+# Empty = the device's build-time list (INVERTER_SLAVES)
+DEFAULT_SLAVES = []
+
 def get_config():
     """Get current configuration"""
     db = get_db()
     cursor = db.cursor()
-    cursor.execute('SELECT reg_read, interval, version FROM config ORDER BY id DESC LIMIT 1')
+    cursor.execute('SELECT reg_read, interval, version, reg_period, deadband, slaves FROM config ORDER BY id DESC LIMIT 1')
     row = cursor.fetchone()
     if row:
         return {
             'reg_read': json.loads(row['reg_read']),
             'interval': row['interval'],
+            'reg_period': json.loads(row['reg_period']) if row['reg_period'] else DEFAULT_REG_PERIOD,
+            'deadband': json.loads(row['deadband']) if row['deadband'] else DEFAULT_DEADBAND,
+            'slaves': json.loads(row['slaves']) if row['slaves'] else DEFAULT_SLAVES,
             'version': row['version']
         }
     return None
@@ -166,18 +192,21 @@ def insert_firmware(file_path, version, update_level):
         (file_path, update_level, version)
     )
     # Also update config version
-    cursor.execute('SELECT reg_read, interval FROM config ORDER BY id DESC LIMIT 1')
+    cursor.execute('SELECT reg_read, interval, reg_period, deadband, slaves FROM config ORDER BY id DESC LIMIT 1')
     config_row = cursor.fetchone()
     reg_read = json.loads(config_row['reg_read']) if config_row else [1]*10
     interval = config_row['interval'] if config_row else 1000
+    reg_period = config_row['reg_period'] if config_row and config_row['reg_period'] else json.dumps(DEFAULT_REG_PERIOD)
+    deadband = config_row['deadband'] if config_row and config_row['deadband'] else json.dumps(DEFAULT_DEADBAND)
+    slaves = config_row['slaves'] if config_row and config_row['slaves'] else json.dumps(DEFAULT_SLAVES)
     cursor.execute(
-        'INSERT INTO config (reg_read, interval, version) VALUES (?, ?, ?)',
-        (json.dumps(reg_read), interval, version)
+        'INSERT INTO config (reg_read, interval, version, reg_period, deadband, slaves) VALUES (?, ?, ?, ?, ?, ?)',
+        (json.dumps(reg_read), interval, version, reg_period, deadband, slaves)
     )
     db.commit()
     return version
 
-def update_config(reg_read=None, interval=None):
+def update_config(reg_read=None, interval=None, reg_period=None, deadband=None, slaves=None):
     """Update configuration"""
     db = get_db()
     cursor = db.cursor()
@@ -190,13 +219,17 @@ def update_config(reg_read=None, interval=None):
     # Update with new values if provided
     new_reg_read = reg_read if reg_read is not None else current_config['reg_read']
     new_interval = interval if interval is not None else current_config['interval']
+    new_reg_period = reg_period if reg_period is not None else current_config['reg_period']
+    new_deadband = {**current_config['deadband'], **deadband} if deadband is not None else current_config['deadband']
+    new_slaves = slaves if slaves is not None else current_config['slaves']
     
     # Keep version unchanged
     current_version = current_config['version']
     # Insert new config with same version
     cursor.execute(
-        'INSERT INTO config (reg_read, interval, version) VALUES (?, ?, ?)',
-        (json.dumps(new_reg_read), new_interval, current_version)
+        'INSERT INTO config (reg_read, interval, version, reg_period, deadband, slaves) VALUES (?, ?, ?, ?, ?, ?)',
+        (json.dumps(new_reg_read), new_interval, current_version,
+         json.dumps(new_reg_period), json.dumps(new_deadband), json.dumps(new_slaves))
     )
     db.commit()
     return True
@@ -224,7 +257,8 @@ def insert_data_batch(snapshots):
     Insert multiple sensor data snapshots in batch
     
     Args:
-        snapshots: List of dicts with 'timestamp' and 'registers' (list of 10 values)
+        snapshots: List of dicts with 'timestamp' and 'registers' (list of 10 values),
+                   and the 'device' (inverter Modbus address, default 1)
         
     Returns:
         Number of records inserted
@@ -239,19 +273,19 @@ def insert_data_batch(snapshots):
         
         # Convert -1 to NULL for unreaded registers
         reg_values = [None if val == -1 else val for val in data]
-        records.append((timestamp, *reg_values))
-    
+        records.append((timestamp, *reg_values, snapshot.get('device', 1)))
+
     cursor.executemany('''
-        INSERT INTO sensor_data 
-        (timestamp, reg_0, reg_1, reg_2, reg_3, reg_4, reg_5, reg_6, reg_7, reg_8, reg_9)
-        VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
+        INSERT INTO sensor_data
+        (timestamp, reg_0, reg_1, reg_2, reg_3, reg_4, reg_5, reg_6, reg_7, reg_8, reg_9, device)
+        VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
     ''', records)
     
     db.commit()
     return len(records)
 
-def get_latest_data():
-    """Get the latest value for each register"""
+def get_latest_data(device=None):
+    """Get the latest value for each register (of one device, or of any)"""
     db = get_db()
     cursor = db.cursor()
     
@@ -261,10 +295,10 @@ def get_latest_data():
         cursor.execute(f'''
             SELECT {reg_col}, timestamp 
             FROM sensor_data 
-            WHERE {reg_col} IS NOT NULL 
-            ORDER BY id DESC 
+            WHERE {reg_col} IS NOT NULL AND (? IS NULL OR device = ?)
+            ORDER BY id DESC
             LIMIT 1
-        ''')
+        ''', (device, device))
         row = cursor.fetchone()
         if row:
             latest_values.append({
@@ -281,24 +315,25 @@ def get_latest_data():
     
     return latest_values
 
-def get_data_by_id_range(start_id, end_id):
-    """Get data by ID range"""
+def get_data_by_id_range(start_id, end_id, device=None):
+    """Get data by ID range (of one device, or of any)"""
     db = get_db()
     cursor = db.cursor()
     
     cursor.execute('''
-        SELECT id, timestamp, reg_0, reg_1, reg_2, reg_3, reg_4, 
+        SELECT id, device, timestamp, reg_0, reg_1, reg_2, reg_3, reg_4, 
                reg_5, reg_6, reg_7, reg_8, reg_9
         FROM sensor_data
-        WHERE id BETWEEN ? AND ?
+        WHERE id BETWEEN ? AND ? AND (? IS NULL OR device = ?)
         ORDER BY id
-    ''', (start_id, end_id))
+    ''', (start_id, end_id, device, device))
     
     rows = cursor.fetchall()
     result = []
     for row in rows:
         data_entry = {
             'id': row['id'],
+            'device': row['device'],
             'timestamp': row['timestamp'],
             'data': [row[f'reg_{i}'] if row[f'reg_{i}'] is not None else -1 for i in range(10)]
         }
@@ -306,24 +341,25 @@ def get_data_by_id_range(start_id, end_id):
     
     return result
 
-def get_data_by_timestamp_range(start_time, end_time):
-    """Get data by timestamp range"""
+def get_data_by_timestamp_range(start_time, end_time, device=None):
+    """Get data by timestamp range (of one device, or of any)"""
     db = get_db()
     cursor = db.cursor()
     
     cursor.execute('''
-        SELECT id, timestamp, reg_0, reg_1, reg_2, reg_3, reg_4, 
+        SELECT id, device, timestamp, reg_0, reg_1, reg_2, reg_3, reg_4, 
                reg_5, reg_6, reg_7, reg_8, reg_9
         FROM sensor_data
-        WHERE timestamp BETWEEN ? AND ?
+        WHERE timestamp BETWEEN ? AND ? AND (? IS NULL OR device = ?)
         ORDER BY timestamp
-    ''', (start_time, end_time))
+    ''', (start_time, end_time, device, device))
     
     rows = cursor.fetchall()
     result = []
     for row in rows:
         data_entry = {
             'id': row['id'],
+            'device': row['device'],
             'timestamp': row['timestamp'],
             'data': [row[f'reg_{i}'] if row[f'reg_{i}'] is not None else -1 for i in range(10)]
         }
@@ -26,6 +26,52 @@ def get_device_config():
             'message': str(e)
         }), 500
 
+def _validate_deadband(deadband):
+    """Return an error message for an invalid deadband object, else None"""
+    if not isinstance(deadband, dict):
+        return 'deadband must be an object'
+    if 'enabled' in deadband and not isinstance(deadband['enabled'], bool):
+        return 'deadband.enabled must be true or false'
+    if 'keyframe_every' in deadband:
+        kf = deadband['keyframe_every']
+        if not isinstance(kf, int) or kf <= 0 or kf > 65535:
+            return 'deadband.keyframe_every must be an integer between 1 and 65535'
+    if 'bands' in deadband:
+        bands = deadband['bands']
+        if not isinstance(bands, list) or len(bands) != 10:
+            return 'deadband.bands must be a list of 10 elements'
+        for band in bands:
+            if isinstance(band, str):
+                try:
+                    ok = band.endswith('%') and float(band[:-1]) >= 0
+                except ValueError:
+                    ok = False
+                if not ok:
+                    return 'deadband.bands strings must be percentages like "2%"'
+            elif isinstance(band, bool) or not isinstance(band, (int, float)) or band < 0:
+                return 'deadband.bands elements must be non-negative numbers or "N%" strings'
+    return None
+
+def _validate_slaves(slaves):
+    """Return an error message for an invalid inverter list, else None"""
+    if not isinstance(slaves, list) or len(slaves) > 4:
+        return 'slaves must be a list of at most 4 inverters'
+    addresses = set()
+    for slave in slaves:
+        if not isinstance(slave, dict):
+            return 'slaves elements must be objects like {"address": 2}'
+        address = slave.get('address')
+        if isinstance(address, bool) or not isinstance(address, int) or not 1 <= address <= 247:
+            return 'slaves[].address must be a Modbus address between 1 and 247'
+        if address in addresses:
+            return f'slaves[].address {address} is listed twice'
+        addresses.add(address)
+        reg_read = slave.get('reg_read')
+        if reg_read is not None and (not isinstance(reg_read, list) or len(reg_read) != 10
+                                     or not all(x in [0, 1] for x in reg_read)):
+            return 'slaves[].reg_read must be a list of 10 elements, each 0 or 1'
+    return None
+
 @config_bp.route('/config', methods=['POST'])
 def update_device_config():
     """
@@ -34,7 +80,17 @@ def update_device_config():
     Expected JSON body:
     {
         "reg_read": [1, 0, 1, 0, 1, 0, 1, 0, 1, 0],  // optional
-        "interval": 2000  // optional
+        "interval": 2000,  // optional
+        "reg_period": [1000, 1000, 0, 0, 0, 0, 0, 60000, 0, 1000],  // optional, ms per register (0 = every interval)
+        "deadband": {  // optional, report-by-exception (keys may be given individually)
+            "enabled": true,
+            "keyframe_every": 60,  // polling cycles between full reports
+            "bands": [1.0, 0.2, 0.05, 1.0, 1.0, 0.2, 0.2, 1.0, 1, "2%"]  // number = absolute, "N%" = percent, 0 = default
+        },
+        "slaves": [  // optional, inverters polled round-robin (Modbus addresses, at most 4)
+            {"address": 1},
+            {"address": 2, "reg_read": [1, 1, 1, 0, 0, 0, 0, 0, 0, 0]}  // own reg_read, else the global one
+        ]
     }
     """
     try:
@@ -48,6 +104,9 @@ def update_device_config():
         
         reg_read = data.get('reg_read')
         interval = data.get('interval')
+        reg_period = data.get('reg_period')
+        deadband = data.get('deadband')
+        slaves = data.get('slaves')
         
         # Validate reg_read if provided
         if reg_read is not None:
@@ -70,8 +129,40 @@ def update_device_config():
                     'message': 'interval must be a positive integer'
                 }), 400
         
+        # Validate reg_period if provided
+        if reg_period is not None:
+            if not isinstance(reg_period, list) or len(reg_period) != 10:
+                return jsonify({
+                    'status': 'error',
+                    'message': 'reg_period must be a list of 10 elements'
+                }), 400
+            if not all(isinstance(x, int) and x >= 0 for x in reg_period):
+                return jsonify({
+                    'status': 'error',
+                    'message': 'reg_period elements must be non-negative integers (ms)'
+                }), 400
+        
+        # Validate deadband if provided
+        if deadband is not None:
+            error = _validate_deadband(deadband)
+            if error:
+                return jsonify({
+                    'status': 'error',
+                    'message': error
+                }), 400
+        
+        # Validate slaves if provided
+        if slaves is not None:
+            error = _validate_slaves(slaves)
+            if error:
+                return jsonify({
+                    'status': 'error',
+                    'message': error
+                }), 400
+        
         # Update config
-        success = update_config(reg_read=reg_read, interval=interval)
+        success = update_config(reg_read=reg_read, interval=interval,
+                                reg_period=reg_period, deadband=deadband, slaves=slaves)
         
         if success:
             new_config = get_config()
@@ -8,7 +8,12 @@ from app.models.database import (
     get_data_by_timestamp_range,
     get_data_count
 )
-from app.utils.compressor import process_compressed_data, reset_sequence_counter
+from app.utils.compressor import (
+    process_compressed_data,
+    reset_sequence_counter,
+    reset_reference,
+    ResyncRequired
+)
 
 @data_bp.route('/data', methods=['POST'])
 def receive_data():
@@ -26,7 +31,10 @@ def receive_data():
     
     2. Binary format (compressed):
     Content-Type: application/octet-stream
-    Raw compressed bytes (TimeSeriesCompressor format)
+    Encrypted upload payload; its header names the codec of the rows and
+    the inverter (device) behind the gateway they came from.
+    A payload delta coded against a batch this server does not hold is
+    answered with 409 (resync); the device resends it as a keyframe.
     """
     try:
         # Check if request contains binary data (compressed)
@@ -51,12 +59,20 @@ def receive_data():
             # Reset sequence counter if requested (use when device restarts)
             if reset_seq:
                 reset_sequence_counter()
+                reset_reference()
                 print("[Data Route] Sequence counter reset")
             
             print(f"[Data Route] Received {len(raw_bytes)} bytes, regs={regs}")
             
             # Process compressed data (decrypt + decompress + decode)
-            snapshots = process_compressed_data(raw_bytes, regs, key)
+            try:
+                snapshots = process_compressed_data(raw_bytes, regs, key)
+            except ResyncRequired as e:
+                return jsonify({
+                    'status': 'resync',
+                    'message': str(e),
+                    'hint': 'Resend the batch as a keyframe'
+                }), 409
             
             if not snapshots:
                 return jsonify({
@@ -127,17 +143,20 @@ def get_data():
     - No params: Returns latest value for each register
     - start_id & end_id: Returns data in ID range
     - start_time & end_time: Returns data in timestamp range
+    - device (optional): Only rows of this inverter (Modbus address)
     
     Examples:
     - GET /data (latest values)
     - GET /data?start_id=1&end_id=100
     - GET /data?start_time=2025-10-18T00:00:00&end_time=2025-10-18T23:59:59
+    - GET /data?device=2 (latest values of inverter 2)
     """
     try:
         start_id = request.args.get('start_id', type=int)
         end_id = request.args.get('end_id', type=int)
         start_time = request.args.get('start_time')
         end_time = request.args.get('end_time')
+        device = request.args.get('device', type=int)
         
         # Case 1: ID range query
         if start_id is not None and end_id is not None:
@@ -147,7 +166,7 @@ def get_data():
                     'message': 'Invalid ID range'
                 }), 400
             
-            data = get_data_by_id_range(start_id, end_id)
+            data = get_data_by_id_range(start_id, end_id, device)
             return jsonify({
                 'status': 'success',
                 'count': len(data),
@@ -156,7 +175,7 @@ def get_data():
         
         # Case 2: Timestamp range query
         elif start_time is not None and end_time is not None:
-            data = get_data_by_timestamp_range(start_time, end_time)
+            data = get_data_by_timestamp_range(start_time, end_time, device)
             return jsonify({
                 'status': 'success',
                 'count': len(data),
@@ -165,7 +184,7 @@ def get_data():
         
         # Case 3: Latest values (default)
         else:
-            data = get_latest_data()
+            data = get_latest_data(device)
             return jsonify({
                 'status': 'success',
                 'data': data
@@ -1,5 +1,5 @@
 from typing import List, Iterable
-from datetime import datetime
+from datetime import datetime, timedelta, timezone
 from typing import Optional
 
 # -----------------------------
@@ -32,141 +32,775 @@ def unpack_s4(nib: int) -> int:
 # -----------------------------
 # Codec
 # -----------------------------
+#
+# Stream layout (v2, see include/compression.h):
+#   u8 version (2), u16 column count (BE)
+#   first row: u16 (BE) per column
+#   later rows: mask ceil(cols/8) B (bit j -> byte j//8, bit j%8),
+#               nibbles ceil(cols/2) B (even column in the high nibble),
+#               u16 (BE) absolutes for masked columns in column order
+# Run-length layout (v3), chosen by compress() only when smaller:
+#   u8 version (3), u16 column count, u16 row count (BE),
+#   run mask ceil(cols/8) B (bit j -> column j is run-length coded),
+#   per run-length column: varint run count, then (u16 BE value, varint length),
+#   remaining columns as v2 rows
+# Streams without a header (v1, 16-bit mask) are still decoded when the
+# caller passes regs.
 
-def compress(values: Iterable[int], regs: int) -> bytes:
-    """Python port of TimeSeriesCompressor::compress."""
-    vals = list(int(v) & 0xFFFF for v in values)
-    out = bytearray()
-    if regs <= 0 or not vals:
-        return bytes(out)
+FORMAT_VERSION = 2
+HEADER_BYTES = 3
+RUN_FORMAT_VERSION = 3
+RUN_HEADER_BYTES = 5
+MAX_COLUMNS = 0xFFFF
 
-    if len(vals) % regs != 0:
-        raise ValueError("values length must be a multiple of regs")
+def mask_bytes(regs: int) -> int:
+    return (regs + 7) // 8
 
-    frames = len(vals) // regs
+def nibble_bytes(regs: int) -> int:
+    return (regs + 1) // 2
+
+def put_varu(out: bytearray, v: int) -> None:
+    while v >= 0x80:
+        out.append(0x80 | (v & 0x7F))
+        v >>= 7
+    out.append(v)
+
+def get_varu(b: bytes, i: int):
+    """Returns (value, next offset)."""
+    v = shift = 0
+    while i < len(b):
+        byte = b[i]
+        i += 1
+        v |= (byte & 0x7F) << shift
+        if not byte & 0x80:
+            break
+        shift += 7
+    return v, i
+
+def columns(blob: bytes) -> Optional[int]:
+    """Column count from a v2/v3 stream header, or None."""
+    if len(blob) < HEADER_BYTES or blob[0] not in (FORMAT_VERSION, RUN_FORMAT_VERSION):
+        return None
+    regs = get_u16_be(blob, 1)
+    return regs or None
+
+def _encode_rows(out: bytearray, vals: List[int], frames: int, regs: int,
+                 absolute_first: bool = True) -> None:
+    """Delta rows: first row absolute (unless it is a reference the decoder
+    already has), then mask/nibbles/absolutes."""
+    mb, nb = mask_bytes(regs), nibble_bytes(regs)
 
     # First frame (absolute)
-    for j in range(regs):
-        put_u16_be(out, vals[j])
+    if absolute_first:
+        for j in range(regs):
+            put_u16_be(out, vals[j])
 
     # Subsequent frames
     for f in range(1, frames):
         prev = vals[(f - 1) * regs : f * regs]
         curr = vals[f * regs : (f + 1) * regs]
-        mask = 0
-        nibbles = [0] * regs
+        mask = bytearray(mb)
+        nibbles = bytearray(nb)
 
         # Compute deltas
         for j in range(regs):
-            diff = curr[j] - prev[j]
-            s4 = clamp_s4(diff)
+            s4 = clamp_s4(curr[j] - prev[j])
             if s4 == 127:
-                mask |= (1 << j)
-                nibbles[j] = 0
+                mask[j // 8] |= 1 << (j % 8)
+            elif j % 2 == 0:
+                nibbles[j // 2] |= pack_s4(s4) << 4
             else:
-                nibbles[j] = pack_s4(s4)
-
-        # Mask (LE)
-        out.append(mask & 0xFF)
-        out.append((mask >> 8) & 0xFF)
+                nibbles[j // 2] |= pack_s4(s4)
 
-        # Packed nibbles
-        for j in range(0, regs, 2):
-            hi = nibbles[j] & 0xF
-            lo = (nibbles[j + 1] & 0xF) if j + 1 < regs else 0
-            out.append((hi << 4) | lo)
+        out += mask
+        out += nibbles
 
         # Absolute values for flagged regs
         for j in range(regs):
-            if mask & (1 << j):
+            if mask[j // 8] & (1 << (j % 8)):
                 put_u16_be(out, curr[j])
 
-    return bytes(out)
+def _runs(vals: List[int], frames: int, regs: int, j: int):
+    runs = []
+    for f in range(frames):
+        v = vals[f * regs + j]
+        if runs and runs[-1][0] == v:
+            runs[-1][1] += 1
+        else:
+            runs.append([v, 1])
+    return runs
 
-def decompress(blob: bytes, regs: int) -> List[int]:
-    """Python port of TimeSeriesCompressor::decompress."""
-    out: List[int] = []
-    if regs <= 0 or len(blob) < regs * 2:
-        return out
+def _varu_len(v: int) -> int:
+    n = 1
+    while v >= 0x80:
+        v >>= 7
+        n += 1
+    return n
 
-    i = 0
-    prev = [0] * regs
+def _compress_runs(vals: List[int], frames: int, regs: int,
+                   referenced: bool = False) -> Optional[bytes]:
+    """Port of compress_runs(): None when no column is worth run-length coding."""
+    run_mask = bytearray(mask_bytes(regs))
+    column_runs = {}
+    for j in range(regs):
+        runs = _runs(vals, frames, regs, j)
+        run_bytes = _varu_len(len(runs)) + sum(2 + _varu_len(n) for _, n in runs)
+        escapes = sum(1 for f in range(1, frames)
+                      if clamp_s4(vals[f * regs + j] - vals[(f - 1) * regs + j]) == 127)
+        delta_bits = (0 if referenced else 16) + (frames - 1) * 5 + escapes * 16
+        if run_bytes * 8 < delta_bits:
+            run_mask[j // 8] |= 1 << (j % 8)
+            column_runs[j] = runs
+    if not column_runs:
+        return None
 
-    # First frame (absolute)
+    out = bytearray([RUN_FORMAT_VERSION])
+    put_u16_be(out, regs)
+    put_u16_be(out, frames)
+    out += run_mask
     for j in range(regs):
-        prev[j] = get_u16_be(blob, i)
-        i += 2
-        out.append(prev[j])
+        if j in column_runs:
+            put_varu(out, len(column_runs[j]))
+            for v, n in column_runs[j]:
+                put_u16_be(out, v)
+                put_varu(out, n)
 
-    # Subsequent frames
-    while i < len(blob):
-        need = 2 + ((regs + 1) // 2)
-        if i + need > len(blob):
-            break
+    rest_cols = [j for j in range(regs) if j not in column_runs]
+    if rest_cols:
+        rest = [vals[f * regs + j] for f in range(frames) for j in rest_cols]
+        _encode_rows(out, rest, frames, len(rest_cols), not referenced)
+    return bytes(out)
+
+def compress(values: Iterable[int], regs: int, ref: Optional[List[int]] = None) -> bytes:
+    """Python port of TimeSeriesCompressor::compress.
+
+    With a reference row the rows are encoded as if it came first, and its
+    absolute values are left out of the stream.
+    """
+    vals = list(int(v) & 0xFFFF for v in values)
+    out = bytearray()
+    if regs <= 0 or regs > MAX_COLUMNS or not vals:
+        return bytes(out)
+
+    if len(vals) % regs != 0:
+        raise ValueError("values length must be a multiple of regs")
+
+    referenced = ref is not None
+    if referenced:
+        vals = [int(v) & 0xFFFF for v in ref[:regs]] + vals
+    frames = len(vals) // regs
 
-        mask = blob[i] | (blob[i + 1] << 8)
-        i += 2
-        nb = (regs + 1) // 2
-        packed = blob[i : i + nb]
-        i += nb
+    # Header
+    out.append(FORMAT_VERSION)
+    put_u16_be(out, regs)
+    _encode_rows(out, vals, frames, regs, not referenced)
+
+    # Run-length layout only when it actually comes out smaller
+    if (referenced or frames > 1) and frames <= 0xFFFF:
+        runs = _compress_runs(vals, frames, regs, referenced)
+        if runs is not None and len(runs) < len(out):
+            return runs
+    return bytes(out)
+
+def _decode_rows(blob: bytes, i: int, regs: int, mb: int, max_frames: int = 0,
+                 first: Optional[List[int]] = None):
+    """Rows of a stream starting at offset i (first row absolute, or taken
+    from `first` instead of the stream).
+
+    Returns (values, next offset); stops after max_frames rows if given.
+    """
+    out: List[int] = []
+    nb = nibble_bytes(regs)
+    if first is not None:
+        prev = list(first)
+    else:
+        if len(blob) < i + regs * 2:
+            return out, i
+        prev = [0] * regs
+
+        # First frame (absolute)
+        for j in range(regs):
+            prev[j] = get_u16_be(blob, i)
+            i += 2
+    out.extend(prev)
+    frames = 1
+
+    # Subsequent frames
+    while (not max_frames or frames < max_frames) and i + mb + nb <= len(blob):
+        mask = int.from_bytes(blob[i : i + mb], "little")
+        packed = blob[i + mb : i + mb + nb]
+        at = i + mb + nb
 
         curr = prev[:]
         for j in range(regs):
-            byte = packed[j // 2]
-            nib = (byte >> 4) & 0xF if j % 2 == 0 else byte & 0xF
             if mask & (1 << j):
-                if i + 1 >= len(blob):
-                    return out
-                curr[j] = get_u16_be(blob, i)
-                i += 2
+                if at + 1 >= len(blob):
+                    return out, i
+                curr[j] = get_u16_be(blob, at)
+                at += 2
             else:
+                byte = packed[j // 2]
+                nib = (byte >> 4) & 0xF if j % 2 == 0 else byte & 0xF
                 curr[j] = (curr[j] + unpack_s4(nib)) & 0xFFFF
 
         out.extend(curr)
         prev = curr
+        i = at
+        frames += 1
+
+    return out, i
 
+def _decode_runs(blob: bytes, regs: int, ref: Optional[List[int]] = None) -> List[int]:
+    if len(blob) < RUN_HEADER_BYTES + mask_bytes(regs):
+        return []
+    frames = get_u16_be(blob, 3)
+    run_mask = int.from_bytes(blob[RUN_HEADER_BYTES:RUN_HEADER_BYTES + mask_bytes(regs)], "little")
+    i = RUN_HEADER_BYTES + mask_bytes(regs)
+    out = [0] * (frames * regs)
+
+    rest_cols = []
+    for j in range(regs):
+        if not run_mask & (1 << j):
+            rest_cols.append(j)
+            continue
+        runs, i = get_varu(blob, i)
+        f = 0
+        for _ in range(runs):
+            if i + 2 > len(blob):
+                return []
+            v = get_u16_be(blob, i)
+            n, i = get_varu(blob, i + 2)
+            for _ in range(n):
+                if f < frames:
+                    out[f * regs + j] = v
+                    f += 1
+        if f != frames:
+            return []
+
+    if rest_cols:
+        rest_ref = [ref[j] for j in rest_cols] if ref is not None else None
+        rest, i = _decode_rows(blob, i, len(rest_cols), mask_bytes(len(rest_cols)), frames, rest_ref)
+        if len(rest) != frames * len(rest_cols):
+            return []
+        k = 0
+        for f in range(frames):
+            for j in rest_cols:
+                out[f * regs + j] = rest[k]
+                k += 1
     return out
 
+def decompress(blob: bytes, regs: int = 0, ref: Optional[List[int]] = None) -> List[int]:
+    """Python port of TimeSeriesCompressor::decompress.
+
+    v2/v3 streams carry their column count; if regs is given it must match.
+    A referenced stream needs the same reference row back.
+    Header-less v1 streams need regs and use a 2-byte mask.
+    """
+    cols = columns(blob)
+    if cols is not None:
+        if regs > 0 and regs != cols:
+            return []
+        if blob[0] == RUN_FORMAT_VERSION:
+            out = _decode_runs(blob, cols, ref)
+        else:
+            out = _decode_rows(blob, HEADER_BYTES, cols, mask_bytes(cols), 0, ref)[0]
+        return out[cols:] if ref is not None else out
+    if regs <= 0:
+        return []
+    return _decode_rows(blob, 0, regs, 2)[0]
+
+# -----------------------------
+# Other upload codecs
+# -----------------------------
+#
+# ForPack (include/compression.h, ForPackCompressor):
+#   u8 version (1), u16 columns, u16 rows (BE), first row u16 (BE),
+#   per block of up to 32 delta rows: per column u8 width | 0x80 (+ u8
+#   exception count), packed zig-zag deltas column-major (LSB-first),
+#   then per flagged column (u8 row, u16 BE high bits)
+# Delta16Var: u16 (BE) first value, then zig-zag varint deltas, row-major
+
+FORPACK_VERSION = 1
+FORPACK_HEADER_BYTES = 5
+FORPACK_BLOCK_ROWS = 32
+FORPACK_EXCEPTION_BITS = 24
+
+def _zigzag16(curr: int, prev: int) -> int:
+    d = (curr - prev) & 0xFFFF
+    d = d - 0x10000 if d & 0x8000 else d
+    return ((d << 1) ^ (d >> 15)) & 0xFFFF
+
+def _unzigzag16(z: int) -> int:
+    return ((z >> 1) ^ -(z & 1)) & 0xFFFF
+
+def _forpack_width(lengths: List[int], rows: int):
+    """Port of chooseWidth(): (width, exceptions) of one block column."""
+    best, best_exc, best_cost = 16, 0, rows * 16
+    above = 0
+    for b in range(16, -1, -1):
+        if b < 16:
+            above += lengths[b + 1]
+        cost = rows * b + above * FORPACK_EXCEPTION_BITS
+        if cost <= best_cost and above < 256:
+            best, best_cost, best_exc = b, cost, above
+    return best, best_exc
+
+def forpack_compress(values: Iterable[int], regs: int, ref: Optional[List[int]] = None) -> bytes:
+    """Python port of ForPackCompressor::compress (reference row: see compress())."""
+    vals = [int(v) & 0xFFFF for v in values]
+    if regs <= 0 or regs > 0xFFFF or not vals or len(vals) % regs:
+        return b""
+    if ref is not None:
+        vals = [int(v) & 0xFFFF for v in ref[:regs]] + vals
+    rows = len(vals) // regs
+    if rows > 0xFFFF:
+        return b""
+
+    out = bytearray([FORPACK_VERSION])
+    put_u16_be(out, regs)
+    put_u16_be(out, rows)
+    if ref is None:
+        for j in range(regs):
+            put_u16_be(out, vals[j])
+
+    for start in range(1, rows, FORPACK_BLOCK_ROWS):
+        n = min(FORPACK_BLOCK_ROWS, rows - start)
+        zz = [[_zigzag16(vals[(start + r) * regs + j], vals[(start + r - 1) * regs + j])
+               for r in range(n)] for j in range(regs)]
+        widths = []
+        for j in range(regs):
+            lengths = [0] * 17
+            for z in zz[j]:
+                lengths[z.bit_length()] += 1
+            b, exc = _forpack_width(lengths, n)
+            widths.append(b)
+            out.append(b | (0x80 if exc else 0))
+            if exc:
+                out.append(exc)
+
+        acc = bits = 0
+        for j in range(regs):
+            for z in zz[j]:
+                acc |= (z & ((1 << widths[j]) - 1)) << bits
+                bits += widths[j]
+        out += acc.to_bytes((bits + 7) // 8, "little")
+
+        for j in range(regs):
+            for r, z in enumerate(zz[j]):
+                if z.bit_length() > widths[j]:
+                    out.append(r)
+                    put_u16_be(out, z >> widths[j])
+    return bytes(out)
+
+def forpack_decompress(blob: bytes, regs: int = 0, ref: Optional[List[int]] = None) -> List[int]:
+    """Python port of ForPackCompressor::decompress; [] on a column mismatch."""
+    out = _forpack_rows(blob, regs, ref)
+    return out[len(ref):] if ref is not None else out
+
+def _forpack_rows(blob: bytes, regs: int, ref: Optional[List[int]]) -> List[int]:
+    if len(blob) < FORPACK_HEADER_BYTES or blob[0] != FORPACK_VERSION:
+        return []
+    cols, rows = get_u16_be(blob, 1), get_u16_be(blob, 3)
+    first_bytes = 0 if ref is not None else 2 * cols
+    if cols == 0 or rows == 0 or (regs > 0 and regs != cols) or len(blob) < FORPACK_HEADER_BYTES + first_bytes:
+        return []
+
+    i = FORPACK_HEADER_BYTES
+    out = [0] * (rows * cols)
+    for j in range(cols):
+        if ref is not None:
+            out[j] = int(ref[j]) & 0xFFFF
+        else:
+            out[j] = get_u16_be(blob, i)
+            i += 2
+
+    for start in range(1, rows, FORPACK_BLOCK_ROWS):
+        n = min(FORPACK_BLOCK_ROWS, rows - start)
+        widths, exc_count = [], []
+        for j in range(cols):
+            if i >= len(blob):
+                return out[:start * cols]
+            h = blob[i]
+            i += 1
+            exc = 0
+            if h & 0x80:
+                if i >= len(blob):
+                    return out[:start * cols]
+                exc = blob[i]
+                i += 1
+            if h & 0x1F > 16:
+                return out[:start * cols]
+            widths.append(h & 0x1F)
+            exc_count.append(exc)
+
+        packed_bytes = (sum(widths) * n + 7) // 8
+        if len(blob) - i < packed_bytes:
+            return out[:start * cols]
+        acc = int.from_bytes(blob[i:i + packed_bytes], "little")
+        i += packed_bytes
+
+        for j in range(cols):
+            b = widths[j]
+            zz = []
+            for _ in range(n):
+                zz.append(acc & ((1 << b) - 1))
+                acc >>= b
+            for _ in range(exc_count[j]):
+                if len(blob) - i < 3:
+                    return out[:start * cols]
+                r = blob[i]
+                if r < n:
+                    zz[r] = (zz[r] | (get_u16_be(blob, i + 1) << b)) & 0xFFFF
+                i += 3
+            for r in range(n):
+                f = start + r
+                out[f * cols + j] = (out[(f - 1) * cols + j] + _unzigzag16(zz[r])) & 0xFFFF
+    return out
+
+def delta_var_compress(values: Iterable[int], regs: int = 0,
+                       ref: Optional[List[int]] = None) -> bytes:
+    """Python port of Delta16VarCompressor::compress. A referenced stream
+    starts from the reference row's last word, which is not sent."""
+    vals = [int(v) & 0xFFFF for v in values]
+    if not vals:
+        return b""
+    if ref is not None and regs > 0:
+        return delta_var_compress([ref[regs - 1]] + vals)[2:]
+    out = bytearray()
+    put_u16_be(out, vals[0])
+    for prev, curr in zip(vals, vals[1:]):
+        d = curr - prev
+        put_varu(out, ((d << 1) ^ (d >> 31)) & 0xFFFFFFFF)
+    return bytes(out)
+
+def delta_var_decompress(blob: bytes, regs: int = 0,
+                         ref: Optional[List[int]] = None) -> List[int]:
+    """Python port of Delta16VarCompressor::decompress; [] unless whole rows."""
+    if ref is not None and regs > 0:
+        out = delta_var_decompress(bytes([ref[regs - 1] >> 8, ref[regs - 1] & 0xFF]) + blob)[1:]
+        return [] if len(out) % regs else out
+    if len(blob) < 2:
+        return []
+    prev = get_u16_be(blob, 0)
+    out = [prev]
+    i = 2
+    while i < len(blob):
+        zz, i = get_varu(blob, i)
+        prev = (prev + ((zz >> 1) ^ -(zz & 1))) & 0xFFFF
+        out.append(prev)
+    if regs > 0 and len(out) % regs:
+        return []
+    return out
+
+# Codec registry, by the ID in the upload payload header
+# (Compression::CodecId): name, compress, decompress, parameter bytes
+CODEC_TIME_SERIES = 1
+CODEC_FOR_PACK = 2
+CODEC_DELTA_VAR = 3
+
+CODECS = {
+    CODEC_TIME_SERIES: ("TimeSeriesS4", compress, decompress, b""),
+    CODEC_FOR_PACK: ("ForPack", forpack_compress, forpack_decompress, bytes([FORPACK_BLOCK_ROWS])),
+    CODEC_DELTA_VAR: ("Delta16Var", delta_var_compress, delta_var_decompress, b""),
+}
+
+# -----------------------------
+# Epoch column (delta-of-delta)
+# -----------------------------
+#
+# Python port of Compression::EpochEncoder, MSB-first bits:
+#   first epoch 32 bits, then per row D = delta - previous delta, zig-zagged:
+#   '0' D == 0 | '10'+7 | '110'+9 | '1110'+12 | '1111'+32 bits
+
+_EPOCH_CODES = ((128, 0b10, 2, 7), (512, 0b110, 3, 9), (4096, 0b1110, 4, 12))
+_EPOCH_WIDTHS = (0, 7, 9, 12, 32)
+
+def _zigzag32(d: int) -> int:
+    d &= 0xFFFFFFFF
+    signed = d - (1 << 32) if d & 0x80000000 else d
+    return ((signed << 1) ^ (signed >> 31)) & 0xFFFFFFFF
+
+def _unzigzag32(z: int) -> int:
+    return ((z >> 1) ^ -(z & 1)) & 0xFFFFFFFF
+
+def encode_epochs(epochs: Iterable[int]) -> bytes:
+    bits: List[int] = []
+
+    def put(v: int, n: int) -> None:
+        bits.extend((v >> k) & 1 for k in range(n - 1, -1, -1))
+
+    prev = prev_delta = None
+    for e in epochs:
+        e &= 0xFFFFFFFF
+        if prev is None:
+            put(e, 32)
+            prev_delta = 0
+        else:
+            delta = (e - prev) & 0xFFFFFFFF
+            zz = _zigzag32(delta - prev_delta)
+            if zz == 0:
+                put(0, 1)
+            else:
+                for limit, code, code_bits, width in _EPOCH_CODES:
+                    if zz < limit:
+                        put(code, code_bits)
+                        put(zz, width)
+                        break
+                else:
+                    put(0b1111, 4)
+                    put(zz, 32)
+            prev_delta = delta
+        prev = e
+
+    out = bytearray((len(bits) + 7) // 8)
+    for i, b in enumerate(bits):
+        if b:
+            out[i // 8] |= 0x80 >> (i % 8)
+    return bytes(out)
+
+def decode_epochs(data: bytes, count: int) -> List[int]:
+    total = len(data) * 8
+    pos = 0
+
+    def get(n: int) -> Optional[int]:
+        nonlocal pos
+        if pos + n > total:
+            return None
+        v = 0
+        for _ in range(n):
+            v = (v << 1) | ((data[pos // 8] >> (7 - pos % 8)) & 1)
+            pos += 1
+        return v
+
+    out: List[int] = []
+    prev = get(32) if count > 0 else None
+    if prev is None:
+        return out
+    out.append(prev)
+    delta = 0
+    while len(out) < count:
+        ones = 0
+        while ones < 4:
+            b = get(1)
+            if b is None:
+                return out
+            if not b:
+                break
+            ones += 1
+        zz = get(_EPOCH_WIDTHS[ones]) if ones else 0
+        if zz is None:
+            return out
+        delta = (delta + _unzigzag32(zz)) & 0xFFFFFFFF
+        prev = (prev + delta) & 0xFFFFFFFF
+        out.append(prev)
+    return out
+
+# -----------------------------
+# Upload payload (v6)
+# -----------------------------
+#
+#   u8 version (6) | u8 codec ID | u8 flags | u8 device |
+#   u16 columns | u16 rows (BE) |
+#   u8 parameter bytes + parameters |
+#   [u16 reference CRC (BE), when flags bit 0 is set] |
+#   u16 epoch column bytes (BE) | epoch column |
+#   register rows compressed with the codec
+# A referenced payload (flags bit 0) deltas its first row against the last
+# row of the previously delivered batch of the same device; the CRC
+# (Buffer::rowCrc) names that row. Flags bit 1 marks raw register words
+# (REGISTER_SCALES apply); without it the words are whole engineering units,
+# as older firmware sent. The device byte is the Modbus address of the
+# inverter behind the gateway. v5 payloads have no device byte (device 1);
+# v4 payloads have no flags or reference either. v3 payloads have no codec fields
+# (version, epoch bytes, epoch column, TimeSeriesCompressor rows). Older
+# payloads are a bare TimeSeriesCompressor stream whose rows start with
+# six date/time words.
+
+UPLOAD_PAYLOAD_VERSION = 6
+UPLOAD_PAYLOAD_V5 = 5
+UPLOAD_PAYLOAD_V4 = 4
+UPLOAD_PAYLOAD_V3 = 3
+UPLOAD_FLAG_REFERENCED = 0x01
+UPLOAD_FLAG_RAW = 0x02
+UPLOAD_HEADER_BYTES = 11
+UPLOAD_REFERENCE_BYTES = 2
+UPLOAD_LEGACY_DEVICE = 1
+
+# Device clock offset (configTime() in main.cpp); timestamps are stored as
+# the device's wall-clock time, as they were when it sent date/time words
+DEVICE_UTC_OFFSET_S = int(5.5 * 3600)
+
+class ResyncRequired(Exception):
+    """A referenced payload whose reference row this server does not hold."""
+
+def modbus_crc_update(crc: int, data: bytes) -> int:
+    """CRC-16/Modbus over data, continuing from crc (0xFFFF to start)."""
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0xA001 if crc & 1 else crc >> 1
+    return crc
+
+def row_crc(epoch: int, row: List[int]) -> int:
+    """Python port of Buffer::rowCrc from a fresh CRC: epoch (u32 LE) then
+    the row's words (LE)."""
+    data = bytearray((epoch & 0xFFFFFFFF).to_bytes(4, "little"))
+    for v in row:
+        data += (int(v) & 0xFFFF).to_bytes(2, "little")
+    return modbus_crc_update(0xFFFF, data)
+
+def build_upload_payload(epochs: List[int], values: List[int], regs: int,
+                         codec: int = CODEC_TIME_SERIES, reference=None,
+                         raw: bool = True, device: int = UPLOAD_LEGACY_DEVICE) -> bytes:
+    """Python port of initiateCompression's payload layout.
+
+    reference is the (epoch, row) the rows are delta coded against, or None
+    for a self-contained payload. raw marks the values as unscaled register
+    words, as the firmware sends them. device is the inverter's Modbus address.
+    """
+    _, codec_compress, _, params = CODECS[codec]
+    times = encode_epochs(epochs)
+    ref_row = list(reference[1]) if reference is not None else None
+    flags = (UPLOAD_FLAG_REFERENCED if reference is not None else 0) | (UPLOAD_FLAG_RAW if raw else 0)
+    out = bytearray([UPLOAD_PAYLOAD_VERSION, codec, flags, device & 0xFF])
+    put_u16_be(out, regs)
+    put_u16_be(out, len(values) // regs)
+    out.append(len(params))
+    out += params
+    if reference is not None:
+        put_u16_be(out, row_crc(reference[0], ref_row))
+    put_u16_be(out, len(times))
+    return bytes(out + times + codec_compress(values, regs, ref_row))
+
+def decode_upload_payload(blob: bytes, regs: int, reference=None):
+    """Returns (epochs, register values) of a v6/v5/v4/v3 payload, or None.
+
+    A v6/v5/v4 payload with an unknown codec, other codec parameters or
+    another column count decodes to no rows. A referenced payload raises
+    ResyncRequired unless reference is the (epoch, row) it names; pass the
+    reference held for payload_device(blob).
+    """
+    if len(blob) < 3 or regs <= 0:
+        return None
+    codec_decompress = decompress
+    rows = None
+    ref_row = None
+    i = 1
+    if blob[0] in (UPLOAD_PAYLOAD_VERSION, UPLOAD_PAYLOAD_V5, UPLOAD_PAYLOAD_V4):
+        # f = flags and device bytes: v5 has no device byte, v4 no flags either
+        f = {UPLOAD_PAYLOAD_VERSION: 2, UPLOAD_PAYLOAD_V5: 1}.get(blob[0], 0)
+        if len(blob) < UPLOAD_HEADER_BYTES - 2 + f:
+            return None
+        codec = CODECS.get(blob[1])
+        flags = blob[2] if f else 0
+        param_bytes = blob[6 + f]
+        i = 7 + f + param_bytes
+        if (codec is None or get_u16_be(blob, 2 + f) != regs or len(blob) < i + 2
+                or blob[7 + f:i] != codec[3]):
+            return [], []
+        if flags & UPLOAD_FLAG_REFERENCED:
+            if len(blob) < i + UPLOAD_REFERENCE_BYTES + 2:
+                return None
+            check = get_u16_be(blob, i)
+            i += UPLOAD_REFERENCE_BYTES
+            if (reference is None or len(reference[1]) != regs
+                    or row_crc(reference[0], reference[1]) != check):
+                raise ResyncRequired(f"reference row {check:04X} not held")
+            ref_row = list(reference[1])
+        codec_decompress = codec[2]
+        rows = get_u16_be(blob, 4 + f)
+    elif blob[0] != UPLOAD_PAYLOAD_V3:
+        return None
+
+    time_bytes = get_u16_be(blob, i)
+    i += 2
+    if len(blob) < i + time_bytes:
+        return None
+    if ref_row is not None:
+        values = codec_decompress(blob[i + time_bytes:], regs, ref_row)
+    else:
+        values = codec_decompress(blob[i + time_bytes:], regs)
+    if rows is not None and len(values) != rows * regs:
+        return [], []
+    epochs = decode_epochs(blob[i:i + time_bytes], len(values) // regs)
+    return epochs, values
+
+def payload_device(blob: bytes) -> int:
+    """Modbus address of the inverter a decrypted payload came from."""
+    if len(blob) >= 4 and blob[0] == UPLOAD_PAYLOAD_VERSION:
+        return blob[3]
+    return UPLOAD_LEGACY_DEVICE
+
+def format_device_time(epoch: int) -> str:
+    tz = timezone(timedelta(seconds=DEVICE_UTC_OFFSET_S))
+    return datetime.fromtimestamp(epoch, tz).strftime("%Y-%m-%dT%H:%M:%S")
+
 # -----------------------------
 # Decoding & Pipeline
 # -----------------------------
 
-def decode_decompressed_data(values: List[int], regs: int) -> List[dict]:
+UNREAD = 0xFFFF  # register not read in this frame
+HELD = 0xFFFE    # register within its deadband: same as last reported value
+
+# Scale of each register (raw / scale = engineering units); mirrors
+# registerMap in the firmware's include/register_map.h
+REGISTER_SCALES = [10, 10, 100, 10, 10, 10, 10, 10, 1, 1]
+
+def scale_value(raw: int, reg: int):
+    """Raw register word in engineering units (int when the scale is 1)."""
+    scale = REGISTER_SCALES[reg] if reg < len(REGISTER_SCALES) else 1
+    return raw if scale <= 1 else raw / scale
+
+def decode_decompressed_data(values: List[int], regs: int,
+                             epochs: Optional[List[int]] = None,
+                             raw: bool = False) -> List[dict]:
     """Decode a flat list of uint16 values into timestamped snapshots.
 
     Contract:
-    - Input values are uint16 words laid out as frames of (6 + regs) words
+    - With epochs (v3/v4 payloads), values are frames of regs words, one epoch
+      per frame; timestamps are the device's local time
+    - Without epochs (older payloads), frames are (6 + regs) words
       [year, month, day, hour, minute, second, reg0..reg{regs-1}]
     - 65535 indicates unread value and must be converted to -1 in output
+    - 65534 marks a value held by the device's deadband (report-by-exception):
+      the register kept its last reported value in this batch (-1 if none yet)
     - regs > 0; frames with incomplete words are ignored
+    - raw: values are unscaled register words (payload flag) and are divided
+      by REGISTER_SCALES; otherwise they already are whole units
 
-    Returns list of dicts: { 'timestamp': ISO8601 str, 'registers': List[int] }
+    Returns list of dicts: { 'timestamp': ISO8601 str, 'registers': List[int | float] }
     """
     if regs <= 0 or not values:
         return []
 
-    frame_words = 6 + regs
+    time_words = 0 if epochs is not None else 6
+    frame_words = time_words + regs
     frame_count = len(values) // frame_words
+    if epochs is not None:
+        frame_count = min(frame_count, len(epochs))
     snapshots: List[dict] = []
+    last_reported = [-1] * regs
 
     for f in range(frame_count):
         base = f * frame_words
-        y, mo, d, h, mi, s = (
-            int(values[base + 0]),
-            int(values[base + 1]),
-            int(values[base + 2]),
-            int(values[base + 3]),
-            int(values[base + 4]),
-            int(values[base + 5]),
-        )
-
-        # Build ISO timestamp string safely (no validation beyond formatting)
-        ts = f"{y:04d}-{mo:02d}-{d:02d}T{h:02d}:{mi:02d}:{s:02d}"
+        if epochs is not None:
+            ts = format_device_time(epochs[f])
+        else:
+            y, mo, d, h, mi, s = (int(values[base + k]) for k in range(6))
+            # Build ISO timestamp string safely (no validation beyond formatting)
+            ts = f"{y:04d}-{mo:02d}-{d:02d}T{h:02d}:{mi:02d}:{s:02d}"
 
         regs_vals: List[int] = []
         for j in range(regs):
-            v = int(values[base + 6 + j])
-            regs_vals.append(-1 if v == 0xFFFF else v)
+            v = int(values[base + time_words + j])
+            if v == HELD:
+                regs_vals.append(last_reported[j])
+            elif v == UNREAD:
+                regs_vals.append(-1)
+            else:
+                shown = scale_value(v, j) if raw else v
+                regs_vals.append(shown)
+                last_reported[j] = shown
 
         snapshots.append({
             'timestamp': ts,
@@ -194,11 +828,19 @@ SEQ_LEN = 4
 # Anti-replay state
 last_seq_received = 0
 
+# Last row of the last decoded batch per device: {device: (epoch, register
+# words)}, which that device's next referenced payload deltas against
+_references = {}
+
 def reset_sequence_counter():
     """Reset the anti-replay sequence counter. Use for testing or reinitialization."""
     global last_seq_received
     last_seq_received = 0
 
+def reset_reference():
+    """Forget the cross-batch reference rows; the next referenced payload asks for a resync."""
+    _references.clear()
+
 def _rotl32(x: int, r: int) -> int:
     """32-bit rotate left."""
     x = x & 0xFFFFFFFF
@@ -354,14 +996,19 @@ def xor_crypt(data: bytes, key: int) -> bytes:
 def process_compressed_data(blob: bytes, regs: int, key: Optional[int] = None) -> List[dict]:
     """Complete pipeline: decrypt, decompress bytes then decode into structured frames.
 
-    Note: regs refers to the number of sensor registers (e.g., 10). The
-    compressed stream contains 6 timestamp words + regs data words per frame,
-    so we decompress with regs_total = 6 + regs, then decode with regs.
+    Note: regs refers to the number of sensor registers (e.g., 10). v6/v5/v4/v3
+    payloads carry an epoch column plus regs words per frame (v6/v5/v4 also
+    name the codec of the register rows, v6 the device); older ones
+    carry 6 timestamp words + regs data words per frame. Every snapshot
+    carries the 'device' it came from.
     
     Args:
         blob: Encrypted packet or compressed data
         regs: Number of sensor registers
         key: Legacy parameter (deprecated) - if None, uses new decryption; if provided, uses legacy XOR
+
+    Raises ResyncRequired for a referenced payload this server cannot
+    rebuild; the device then resends the batch as a keyframe.
     """
     # Choose decryption method
     if key is None:
@@ -375,9 +1022,23 @@ def process_compressed_data(blob: bytes, regs: int, key: Optional[int] = None) -
         # Legacy XOR decryption (deprecated but kept for backward compatibility)
         blob = xor_crypt(blob, key)
 
-    regs_total = 6 + regs
-    vals = decompress(blob, regs_total)
-    return decode_decompressed_data(vals, regs)
+    device = payload_device(blob)
+    payload = decode_upload_payload(blob, regs, _references.get(device))
+    if payload is not None:
+        epochs, vals = payload
+        if epochs and len(vals) == len(epochs) * regs:
+            _references[device] = (epochs[-1], vals[-regs:])
+        raw = (blob[0] in (UPLOAD_PAYLOAD_VERSION, UPLOAD_PAYLOAD_V5)
+               and bool(blob[2] & UPLOAD_FLAG_RAW))
+        snapshots = decode_decompressed_data(vals, regs, epochs, raw)
+    else:
+        regs_total = 6 + regs
+        vals = decompress(blob, regs_total)
+        snapshots = decode_decompressed_data(vals, regs)
+
+    for snap in snapshots:
+        snap['device'] = device
+    return snapshots
 
 
 def print_decoded_snapshots(snapshots: List[dict]) -> None:
@@ -2,10 +2,17 @@
 Test script for TimeSeriesCompressor decompression and decoding
 """
 
+import os
+import re
 import sys
 sys.path.insert(0, 'e:\\UoM\\Sem07\\Embedded\\Repo\\Embedded-Systems-Engineering-EN4440\\cloud')
 
-from app.utils.compressor import decompress, decode_decompressed_data, process_compressed_data, xor_crypt
+from app.utils.compressor import compress, decompress, decode_decompressed_data, process_compressed_data, xor_crypt
+from app.utils.compressor import encode_epochs, decode_epochs, build_upload_payload
+from app.utils.compressor import decode_upload_payload, CODECS
+from app.utils.compressor import UPLOAD_FLAG_REFERENCED, UPLOAD_REFERENCE_BYTES, ResyncRequired, reset_reference
+from app.utils.compressor import UPLOAD_LEGACY_DEVICE, payload_device
+from app.utils.compressor import UPLOAD_FLAG_RAW, REGISTER_SCALES
 
 
 def test_decompression():
@@ -84,7 +91,10 @@ def test_decompression():
     print("=" * 80)
     print("STEP 4: COMPLETE PIPELINE TEST")
     print("=" * 80)
-    result = process_compressed_data(compressed_bytes, regs)
+    # key=0: plain (unencrypted) blob through the legacy XOR path; key=None
+    # expects an authenticated packet and returns [] for this one
+    result = process_compressed_data(compressed_bytes, regs, 0)
+    assert len(result) == 3, f"Expected 3 snapshots from the pipeline, got {len(result)}"
     print(f"Processed {len(result)} snapshots successfully")
     print()
 
@@ -102,9 +112,290 @@ def test_decompression():
     return True
 
 
-if __name__ == "__main__":
-    success = test_decompression()
-    if success:
-        print("✓ All tests PASSED!")
+def test_deadband_held_values():
+    """Held cells (0xFFFE) repeat the register's last reported value"""
+    regs = 10
+    regs_total = 6 + regs
+    U, H = 0xFFFF, 0xFFFE
+    raw = [
+        2025, 10, 19, 19, 28, 14, 2301, U, 50, U, U, U, U, 385, 25, 1200,   # keyframe
+        2025, 10, 19, 19, 28, 20, H,    U, H,  U, U, U, U, H,   H,  1260,
+        2025, 10, 19, 19, 28, 32, 2290, U, H,  U, U, U, U, H,   H,  H,
+    ]
+    values = decompress(compress(raw, regs_total), regs_total)
+    assert values == raw, "Held markers must survive the codec unchanged"
+
+    snapshots = decode_decompressed_data(values, regs)
+    assert [s['registers'] for s in snapshots] == [
+        [2301, -1, 50, -1, -1, -1, -1, 385, 25, 1200],
+        [2301, -1, 50, -1, -1, -1, -1, 385, 25, 1260],
+        [2290, -1, 50, -1, -1, -1, -1, 385, 25, 1260],
+    ]
+
+    # A held cell with no earlier report in the batch stays unread
+    lone = decode_decompressed_data([2025, 10, 19, 19, 28, 14] + [H] * regs, regs)
+    assert lone[0]['registers'] == [-1] * regs
+    print("✓ Deadband held values decoded correctly")
+    return True
+
+
+def test_wide_streams():
+    """Header carries the column count; masks grow past 16 columns"""
+    for cols in (1, 7, 16, 17, 33, 64):
+        raw = []
+        for f in range(6):
+            raw += [(1000 * j + f * (3 if j % 3 else 400)) & 0xFFFF for j in range(cols)]
+        blob = compress(raw, cols)
+        assert blob[0] == 2 and (blob[1] << 8 | blob[2]) == cols, "v2 header expected"
+        assert decompress(blob) == raw, f"Round trip failed at {cols} columns"
+        assert decompress(blob, cols) == raw
+        assert decompress(blob, cols + 1) == [], "Column count mismatch must be rejected"
+    print("✓ Wide streams (1..64 columns) round-trip")
+    return True
+
+
+def test_epoch_column():
+    """Delta-of-delta epochs: a regular poll costs about one bit per row"""
+    regular = [1760900000 + 5 * i for i in range(200)]
+    blob = encode_epochs(regular)
+    assert decode_epochs(blob, len(regular)) == regular
+    assert len(blob) <= 4 + 2 + 200 // 8 + 1, f"Regular poll too large: {len(blob)} B"
+
+    jittery = [1760900000, 1760900005, 1760900011, 1760900016, 1760903616, 1760903621, 0, 4294967295]
+    assert decode_epochs(encode_epochs(jittery), len(jittery)) == jittery
+
+    # Full v3 payload: epoch column + register rows
+    regs = 10
+    U = 0xFFFF
+    values = [U, U, 50, U, U, U, U, U, 25, U] * 3
+    epochs = [1760900000, 1760900005, 1760900010]
+    payload = build_upload_payload(epochs, values, regs, raw=False)   # whole units
+    snapshots = process_compressed_data(xor_crypt(payload, 0x5A), regs, 0x5A)
+    assert [s['timestamp'] for s in snapshots] == [
+        "2025-10-20T00:23:20", "2025-10-20T00:23:25", "2025-10-20T00:23:30"]
+    assert snapshots[0]['registers'] == [-1, -1, 50, -1, -1, -1, -1, -1, 25, -1]
+    print(f"✓ Epoch column: 200 regular rows in {len(blob)} B")
+    return True
+
+
+def test_run_length_columns():
+    """Unread and constant columns collapse to runs; busy data stays v2"""
+    regs = 10
+    U = 0xFFFF
+    values = []
+    for f in range(60):
+        row = [U] * regs
+        row[2] = 2300 + (f % 5)
+        row[8] = 500 + 7 * f
+        values += row
+    blob = compress(values, regs)
+    assert blob[0] == 3, "Mostly unread rows should use the run-length layout"
+    assert decompress(blob) == values and decompress(blob, regs) == values
+    assert decompress(blob, regs + 1) == []
+
+    busy = [(f * 37 + j * 1013) & 0xFFFF for f in range(20) for j in range(regs)]
+    assert compress(busy, regs)[0] == 2, "No column worth run-length coding"
+    assert decompress(compress(busy, regs)) == busy
+
+    # Changing runs (a register that steps now and then)
+    steps = [(f // 15) * 1000 for f in range(60) for _ in range(3)]
+    assert decompress(compress(steps, 3)) == steps
+    print(f"✓ Run-length columns: 60 default rows in {len(blob)} B")
+    return True
+
+
+def test_codec_payloads():
+    """Every registered codec round-trips through the v6 payload header"""
+    regs = 10
+    values = []
+    for f in range(40):
+        values += [(3000 + 7 * f + 100 * j) & 0xFFFF if j % 3 else 0xFFFF for j in range(regs)]
+    epochs = [1760900000 + 5 * f for f in range(40)]
+    for codec_id, (name, _, _, params) in CODECS.items():
+        payload = build_upload_payload(epochs, values, regs, codec_id)
+        assert payload[0] == 6 and payload[1] == codec_id and payload[2] == UPLOAD_FLAG_RAW and payload[8] == len(params)
+        assert payload[3] == UPLOAD_LEGACY_DEVICE
+        assert decode_upload_payload(payload, regs) == (epochs, values), f"{name} round trip failed"
+        assert decode_upload_payload(payload, regs + 1) == ([], []), "Column mismatch must be rejected"
+
+    # Unknown codec and foreign codec parameters decode to nothing
+    payload = bytearray(build_upload_payload(epochs, values, regs, 2))
+    payload[9] = 16
+    assert decode_upload_payload(bytes(payload), regs) == ([], [])
+    payload[1] = 99
+    assert decode_upload_payload(bytes(payload), regs) == ([], [])
+
+    # v5 (no device byte) and v4 (no flags byte either) payloads still
+    # waiting in a device spool
+    payload = build_upload_payload(epochs, values, regs, 2)
+    v5 = bytes([5]) + payload[1:3] + payload[4:]
+    assert decode_upload_payload(v5, regs) == (epochs, values)
+    v4 = bytes([4]) + payload[1:2] + payload[4:]
+    assert decode_upload_payload(v4, regs) == (epochs, values)
+
+    # v3 payloads still waiting in a device spool
+    times = encode_epochs(epochs)
+    v3 = bytes([3, len(times) >> 8, len(times) & 0xFF]) + times + compress(values, regs)
+    assert decode_upload_payload(v3, regs) == (epochs, values)
+    print(f"✓ Codec payloads: {len(CODECS)} codecs round-trip")
+    return True
+
+
+def test_cross_batch_reference():
+    """Referenced payloads delta against the previous batch's last row"""
+    regs = 10
+    def batch(start):
+        vals = []
+        for f in range(start, start + 6):
+            vals += [(2300 + f % 3 + 50 * j) & 0xFFFF if j < 4 else 0xFFFF for j in range(regs)]
+        return [1760900000 + 5 * f for f in range(start, start + 6)], vals
+
+    epochs, values = batch(0)
+    reference = (epochs[-1], values[-regs:])
+    next_epochs, next_values = batch(6)
+    for codec_id, (name, _, _, _) in CODECS.items():
+        full = build_upload_payload(next_epochs, next_values, regs, codec_id)
+        ref = build_upload_payload(next_epochs, next_values, regs, codec_id, reference)
+        assert ref[2] & UPLOAD_FLAG_REFERENCED and len(ref) <= len(full) + UPLOAD_REFERENCE_BYTES + 2
+        assert decode_upload_payload(ref, regs, reference) == (next_epochs, next_values), f"{name} round trip failed"
+
+    # Missing or different reference row: the device must resend a keyframe
+    for held in (None, (reference[0] + 5, reference[1]), (reference[0], [0] * regs)):
+        try:
+            decode_upload_payload(ref, regs, held)
+            assert False, "Referenced payload decoded without its reference"
+        except ResyncRequired:
+            pass
+
+    # The module keeps the last row of each decoded batch
+    reset_reference()
+    assert process_compressed_data(build_upload_payload(epochs, values, regs), regs, 0)
+    assert len(process_compressed_data(ref, regs, 0)) == 6
+    reset_reference()
+    try:
+        process_compressed_data(ref, regs, 0)
+        assert False, "Reference must be forgotten after reset"
+    except ResyncRequired:
+        pass
+    full = build_upload_payload(next_epochs, next_values, regs)
+    ref = build_upload_payload(next_epochs, next_values, regs, 1, reference)
+    assert len(ref) < len(full)
+    print(f"✓ Cross-batch reference: {len(full)} B → {len(ref)} B per batch")
+    return True
+
+
+def test_device_references():
+    """Each inverter behind a gateway deltas against its own last row"""
+    regs = 10
+    def batch(device, start):
+        vals = []
+        for f in range(start, start + 4):
+            vals += [(1000 * device + f + j) & 0xFFFF for j in range(regs)]
+        return [1760900000 + 5 * f for f in range(start, start + 4)], vals
+
+    reset_reference()
+    held = {}
+    for device in (1, 2, 7):
+        epochs, values = batch(device, 0)
+        snaps = process_compressed_data(build_upload_payload(epochs, values, regs, device=device), regs, 0)
+        assert [s['device'] for s in snaps] == [device] * 4
+        held[device] = (epochs[-1], values[-regs:])
+
+    # Interleaved referenced batches decode against their own device's row
+    for device in (7, 1, 2):
+        epochs, values = batch(device, 4)
+        payload = build_upload_payload(epochs, values, regs, 1, held[device], device=device)
+        assert payload_device(payload) == device
+        snaps = process_compressed_data(payload, regs, 0)
+        assert len(snaps) == 4 and snaps[0]['device'] == device
+
+    # A reference from another device is not accepted
+    epochs, values = batch(2, 8)
+    wrong = build_upload_payload(epochs, values, regs, 1, (epochs[0] - 5, batch(1, 7)[1][-regs:]), device=2)
+    try:
+        process_compressed_data(wrong, regs, 0)
+        assert False, "Payload decoded against another device's reference"
+    except ResyncRequired:
+        pass
+
+    # v5 payloads belong to the default device
+    v5 = bytes([5]) + payload[1:3] + payload[4:]
+    assert payload_device(v5) == UPLOAD_LEGACY_DEVICE
+    reset_reference()
+    print("✓ Per-device references: 3 inverters interleaved on one gateway")
+    return True
+
+
+def test_raw_register_scaling():
+    """Raw register words are scaled on the server, whole units pass through"""
+    regs = 10
+    row = [2301, 52, 4998, 3120, 0xFFFF, 81, 0xFFFF, 415, 100, 1234]
+    epochs = [1760900000, 1760900005]
+    values = row + [0xFFFE if j == 2 else v for j, v in enumerate(row)]
+
+    reset_reference()
+    snaps = process_compressed_data(build_upload_payload(epochs, values, regs), regs, 0)
+    expected = [230.1, 5.2, 49.98, 312.0, -1, 8.1, -1, 41.5, 100, 1234]
+    assert snaps[0]['registers'] == expected, snaps[0]['registers']
+    assert snaps[1]['registers'] == expected, "Held cell must repeat the scaled value"
+
+    # Payloads without the raw flag carry whole units already
+    reset_reference()
+    snaps = process_compressed_data(build_upload_payload(epochs, values, regs, raw=False), regs, 0)
+    assert snaps[0]['registers'] == [v if v != 0xFFFF else -1 for v in row]
+    reset_reference()
+    print("✓ Raw registers scaled on the server (R2 4998 → 49.98 Hz)")
+    return True
+
+
+def test_register_map_scales():
+    """Server scales follow the firmware register map (include/register_map.h)"""
+    header = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "include", "register_map.h")
+    with open(header, encoding="utf-8") as f:
+        entries = re.findall(r'X\((\d+),\s*"[^"]*",\s*(\d+),', f.read())
+    assert entries, "No register map entries found"
+    assert [int(a) for a, _ in entries] == list(range(len(entries))), "Addresses must be R0, R1, ..."
+    scales = [int(s) for _, s in entries]
+    assert scales == REGISTER_SCALES, f"{scales} != {REGISTER_SCALES}"
+    print(f"✓ REGISTER_SCALES match the firmware register map ({len(scales)} registers)")
+    return True
+
+
+TESTS = [
+    test_decompression,
+    test_deadband_held_values,
+    test_wide_streams,
+    test_epoch_column,
+    test_run_length_columns,
+    test_codec_payloads,
+    test_cross_batch_reference,
+    test_device_references,
+    test_raw_register_scaling,
+    test_register_map_scales,
+]
+
+
+def run_all():
+    """Runs every test on its own, so one failure does not hide the rest"""
+    failed = []
+    for test in TESTS:
+        try:
+            ok = test() is not False
+        except Exception as e:
+            print(f"✗ {test.__name__}: {type(e).__name__}: {e}")
+            ok = False
+        if not ok:
+            failed.append(test.__name__)
+
+    print("=" * 80)
+    for test in TESTS:
+        print(f"  {'✗ FAIL' if test.__name__ in failed else '✓ PASS'}  {test.__name__}")
+    if failed:
+        print(f"✗ {len(failed)} of {len(TESTS)} tests FAILED!")
     else:
-        print("✗ Some tests FAILED!")
+        print("✓ All tests PASSED!")
+    return not failed
+
+
+if __name__ == "__main__":
+    sys.exit(0 if run_all() else 1)
@@ -3,16 +3,97 @@
 
 #include <Arduino.h>
 #include <vector>
-#include "timed_snapshot.h"
+#include "snapshot_record.h"
 #include "inverter_comm.h"   // for NUM_REGISTERS, RequestSIM
 #include "request_config.h"
+#include "compression.h"
 
 namespace Buffer {
 
-    void appendFromTemporary(const RequestSIM& config);
-    const std::vector<TimedSnapshot>& getAll();
+    // Heap one legacy TimedSnapshot {String timestamp; vector<float> values;}
+    // cost on the ESP8266: 24 B inline plus two umm_malloc blocks (20 B
+    // timestamp -> 24 B, 40 B of floats -> 48 B, 8-byte granules + header)
+    static const size_t LEGACY_SNAPSHOT_BYTES = 96;
+    static const size_t LEGACY_CAPACITY = 100;
+
+    // Same RAM as the legacy buffer, now spent on compressed blocks
+    static const size_t RAM_BUDGET = LEGACY_CAPACITY * LEGACY_SNAPSHOT_BYTES;
+
+    // One upload-stream row: one word per register (the timestamp is a
+    // separate epoch column)
+    static const int ROW_WORDS = REGISTER_COUNT;
+
+    // Snapshots are encoded into blocks as they arrive: register rows as a
+    // TimeSeriesCompressor stream from the front of data, epochs as an
+    // EpochEncoder column from the back. Every slave has its own open
+    // block, so a block holds the rows of one inverter. A block is sealed
+    // when the next row might not fit (or at upload time); its register
+    // stream is then repacked with run-length columns if that is smaller,
+    // and the block holds one complete upload payload (see
+    // initiate_compression.h).
+    static const size_t BLOCK_BYTES = 512;
+    struct Block {
+        uint32_t firstEpoch;
+        uint32_t lastEpoch;
+        uint16_t rows;
+        uint16_t length;              // register stream bytes, from data[0]
+        uint16_t timeLength;          // epoch column bytes, from the end
+        uint16_t crc;                 // rowCrc() over the rows as appended
+        uint8_t slave;                // Modbus address of the inverter
+        uint16_t lastRow[ROW_WORDS];  // last row as encoded (the next upload's reference)
+        uint8_t data[BLOCK_BYTES];
+    };
+    static const size_t MAX_BLOCKS = RAM_BUDGET / sizeof(Block);
+
+    // A block must take at least one worst-case row (all-absolute delta
+    // row plus the stream header and a raw-coded epoch)
+    static_assert(Compression::TimeSeriesCompressor::HEADER_BYTES +
+                      Compression::TimeSeriesCompressor::maskBytes(ROW_WORDS) +
+                      Compression::TimeSeriesCompressor::nibbleBytes(ROW_WORDS) + ROW_WORDS * 2 +
+                      Compression::EpochEncoder::MAX_VALUE_BYTES <= BLOCK_BYTES,
+                  "Buffer::BLOCK_BYTES too small for one register row");
+
+    // CRC-16/Modbus of one row fed into crc: epoch then register words,
+    // little-endian. Lets a decoded payload be checked against its block.
+    uint16_t rowCrc(uint16_t crc, uint32_t epoch, const uint16_t* row);
+
+    // Blocks are kept in a fixed ring; when it is full the oldest block is
+    // overwritten. Every block gets a sequence number that stays valid
+    // until it is committed or evicted.
+    void appendFromTemporary(const RequestSIM& config, uint8_t slave);
+
+    size_t size();          // snapshots buffered, open block included
+    size_t blockCount();
+    bool isEmpty();
+
+    // Closes every open block so they can be peeked and uploaded
+    void seal();
+
+    // Block with sequence number `seq`, or nullptr once it is gone
+    const Block* get(uint32_t seq);
+    uint32_t oldestSeq();
+
+    // Up to maxCount oldest sealed blocks, left in place until commit()
+    struct Batch {
+        uint32_t firstSeq;
+        size_t count;
+    };
+    Batch peek(size_t maxCount = MAX_BLOCKS);
+
+    // Releases the blocks of a peeked batch that are still buffered;
+    // anything sealed after the peek stays. Returns blocks released.
+    size_t commit(const Batch& batch);
+
     void clear();
     bool hasOverflowed();
+    uint32_t evictedCount();     // snapshots lost to overwritten blocks
+
+    // Bytes per snapshot and capacity vs. the legacy snapshot layout
+    void printMemoryReport();
+
+    // CPU cycles per sample of frame decode, buffer append and upload
+    // compression; run before polling starts (needs an empty buffer)
+    void printPipelineBenchmark(size_t samples = 240);
 
 }  // namespace Buffer
 
@@ -5,15 +5,25 @@
 #include <vector>
 
 struct DecodedSnapshot {
-    String timestamp;              // "YYYY-MM-DD HH:MM:SS"
-    std::vector<uint16_t> registers;  // Register values (0xFFFF = unread)
+    uint32_t epoch;                // Seconds since 1970 (UTC)
+    String timestamp;              // "YYYY-MM-DD HH:MM:SS", device local time
+    std::vector<uint16_t> registers;  // Register values (0xFFFF = unread, 0xFFFE = held)
 };
 
-// 🧠 Decode decompressed uint16_t data back into timestamped snapshots
+// 🧠 Decode decompressed register rows plus their epoch column back into
+// timestamped snapshots (one epoch per row of `regs` words)
 std::vector<DecodedSnapshot> decodeDecompressedData(
-    const std::vector<uint16_t>& data, int regs);
+    const std::vector<uint32_t>& epochs, const std::vector<uint16_t>& data, int regs);
 
-// 🧾 Optional: pretty-print decoded data to Serial/console
+// 📦 Decode a whole upload payload (see initiate_compression.h). A
+// referenced payload needs the last row of the batch before it from the
+// same device (epoch and raw register words, see payloadDevice()); without
+// it, or with another row, nothing decodes.
+std::vector<DecodedSnapshot> decodeUploadPayload(const std::vector<uint8_t>& payload, int regs,
+                                                 const DecodedSnapshot* ref = nullptr);
+
+// 🧾 Optional: pretty-print decoded data to Serial/console (raw words
+// shown in engineering units, see formatScaled())
 void printDecodedSnapshots(const std::vector<DecodedSnapshot>& snapshots);
 
 #endif  // CLOUD_DECODE_UTILS_H
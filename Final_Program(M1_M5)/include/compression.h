@@ -7,6 +7,11 @@
 
 using namespace std;
 
+// Set to 1 to print the column-count throughput benchmark at boot
+#ifndef COMPRESSION_BENCHMARK
+#define COMPRESSION_BENCHMARK 0
+#endif
+
 // 🧾 Benchmark result
 struct BenchResult {
     String mode;
@@ -37,16 +42,267 @@ public:
 // 🕒 TimeSeriesCompressor
 // - Packs 4-bit signed deltas per register
 // - Uses mask bits for large jumps
+//
+// Stream layout (v2):
+//   u8 version (2)   u16 column count (BE)
+//   first row: one u16 (BE) per column
+//   each later row: mask, ceil(cols/8) bytes, bit j = column j is sent
+//                   absolute (byte j/8, bit j%8)
+//                   nibbles, ceil(cols/2) bytes, column j in the high
+//                   nibble when j is even
+//                   absolutes, u16 (BE) per masked column in column order
+// With 16 columns a row is byte-compatible with the old header-less format.
+//
+// Run-length layout (v3), used by compress() only when it is smaller:
+//   u8 version (3)   u16 column count (BE)   u16 row count (BE)
+//   run mask, ceil(cols/8) bytes, bit j = column j is run-length coded
+//   per run-length column: varint run count, then per run u16 (BE) value
+//                          + varint length
+//   remaining columns as v2 rows (first row absolute, then deltas)
+// Unread or constant columns then cost a few bytes per block.
 // ================================================================
 class TimeSeriesCompressor {
 public:
     static constexpr const char* name() { return "TimeSeriesS4"; }
 
-    static vector<uint8_t> compress(const vector<uint16_t>& values, int regs);
-    static vector<uint16_t> decompress(const vector<uint8_t>& blob, int regs);
+    static const uint8_t FORMAT_VERSION = 2;
+    static const size_t HEADER_BYTES = 3;
+    static const uint8_t RUN_FORMAT_VERSION = 3;
+    static const size_t RUN_HEADER_BYTES = 5;
+    static const int MAX_COLUMNS = 0xFFFF;
+
+    static constexpr size_t maskBytes(int regs) { return (size_t)(regs + 7) / 8; }
+    static constexpr size_t nibbleBytes(int regs) { return (size_t)(regs + 1) / 2; }
+
+    // With a reference row (regs words the decoder already has, e.g. the
+    // last row of the previous batch) the rows are encoded as if it came
+    // first, and its absolute values are left out of the stream; a v3
+    // header then counts it as a row
+    static vector<uint8_t> compress(const vector<uint16_t>& values, int regs,
+                                    const uint16_t* ref = nullptr);
+
+    // Column count from the stream header, or -1 if it is not a v2/v3 stream
+    static int columns(const vector<uint8_t>& blob);
+
+    // Rows are rebuilt with the header's column count; when regs > 0 it
+    // must match or nothing is returned. A referenced stream needs the
+    // same reference row back.
+    static vector<uint16_t> decompress(const vector<uint8_t>& blob, int regs = 0,
+                                       const uint16_t* ref = nullptr);
+    static BenchResult benchmark(const vector<uint16_t>& values, int regs);
+
+    // Only the first `rows` rows (fewer if the stream is shorter)
+    static vector<uint16_t> decompressPrefix(const vector<uint8_t>& blob, size_t rows);
+
+    // Rewrites a v2 stream in place as compress() would lay it out;
+    // returns the new length (unchanged when it does not shrink)
+    static size_t repack(uint8_t* data, size_t len);
+};
+
+// ================================================================
+// ➕ TimeSeriesEncoder
+// - Incremental TimeSeriesCompressor: rows are appended one at a time
+//   into a caller-owned buffer as a v2 stream
+// - Sealing the stream with TimeSeriesCompressor::repack() gives the
+//   same bytes as compress()
+// - Only the previous row is kept as the delta base
+// ================================================================
+class TimeSeriesEncoder {
+public:
+    // Writes the stream header; false if regs or the buffer is unusable
+    bool begin(uint8_t* buf, size_t capacity, int regs);
+
+    // Worst case for one more row (absolute first row, or all-absolute delta)
+    size_t maxRowBytes() const;
+
+    // Appends one row of `regs` words; false (nothing written) if it does not fit
+    bool append(const uint16_t* row);
+
+    size_t size() const { return _len; }
+    uint32_t rows() const { return _rows; }
+
+private:
+    uint8_t* _buf = nullptr;
+    size_t _cap = 0;
+    size_t _len = 0;
+    int _regs = 0;
+    uint32_t _rows = 0;
+    vector<uint16_t> _prev;     // sized once per column count
+};
+
+// ================================================================
+// ⏱️ EpochEncoder
+// - Timestamp column as delta-of-delta (Gorilla-style), MSB-first bits:
+//     first epoch          32 bits raw
+//     then per row D = delta - previous delta, zig-zagged:
+//       '0'                 D == 0 (same interval as last time)
+//       '10'   + 7 bits     zz(D) < 128
+//       '110'  + 9 bits     zz(D) < 512
+//       '1110' + 12 bits    zz(D) < 4096
+//       '1111' + 32 bits    anything else
+//   A regular poll costs one bit per row after the second.
+// - Bytes are stored backwards from `end` (byte k at end[-1 - k]) so the
+//   column can share a buffer with a stream growing from the front;
+//   copyTo() writes them out in stream order.
+// ================================================================
+class EpochEncoder {
+public:
+    static const size_t MAX_VALUE_BYTES = 5;   // worst code: 36 bits
+
+    void begin(uint8_t* end, size_t capacity);
+    bool append(uint32_t epoch);
+
+    size_t size() const { return (_bits + 7) / 8; }
+    uint32_t count() const { return _count; }
+    void copyTo(uint8_t* out) const;
+
+    // Decodes `count` epochs from a stream in normal byte order
+    static vector<uint32_t> decode(const uint8_t* data, size_t len, size_t count);
+
+private:
+    void putBits(uint32_t v, int n);
+
+    uint8_t* _end = nullptr;
+    size_t _cap = 0;
+    size_t _bits = 0;
+    uint32_t _count = 0;
+    uint32_t _prev = 0;
+    uint32_t _prevDelta = 0;
+};
+
+// ================================================================
+// 📐 ForPackCompressor
+// - Frame-of-reference bit packing of zig-zagged per-column deltas
+// - Each column of each block of BLOCK_ROWS rows gets the bit width that
+//   minimises its size; deltas wider than that are patched in as
+//   exceptions (PFor), so one outlier does not widen the whole column
+// - Bits are written and read a 32-bit word at a time into output sized
+//   once up front (little-endian bit order)
+//
+// Stream layout:
+//   u8 version (1)   u16 column count (BE)   u16 row count (BE)
+//   first row: one u16 (BE) per column
+//   per block of up to BLOCK_ROWS delta rows:
+//     per column: u8 width (bits 0..4) | 0x80 if exceptions follow,
+//                 then u8 exception count when flagged
+//     packed bits, column-major, low `width` bits of each zig-zag delta,
+//     padded to a byte
+//     per flagged column: u8 row in block, u16 (BE) delta >> width
+// ================================================================
+class ForPackCompressor {
+public:
+    static constexpr const char* name() { return "ForPack"; }
+
+    static const uint8_t FORMAT_VERSION = 1;
+    static const size_t HEADER_BYTES = 5;
+    static const int BLOCK_ROWS = 32;
+    static const int EXCEPTION_BITS = 24;    // row index + high bits
+
+    // With a reference row (regs words, see TimeSeriesCompressor) the
+    // stream has no absolute first row and its row count includes the
+    // reference
+    static vector<uint8_t> compress(const vector<uint16_t>& values, int regs,
+                                    const uint16_t* ref = nullptr);
+    static vector<uint16_t> decompress(const vector<uint8_t>& blob, const uint16_t* ref = nullptr);
     static BenchResult benchmark(const vector<uint16_t>& values, int regs);
+
+    // Upper bound of compress() output, used to size it once
+    static size_t maxCompressedSize(size_t rows, int regs);
+
+private:
+    // Rows of the stream, the reference row included
+    static vector<uint16_t> decodeRows(const vector<uint8_t>& blob, const uint16_t* ref);
+};
+
+// ================================================================
+// 🗂️ Codec registry
+// - Every codec an upload payload can carry, by the ID written into the
+//   payload header (IDs are on the wire: never renumber, only append)
+// - params are fixed codec settings the decoder must agree with; they
+//   travel in the payload header after the ID
+// - estimate() compresses a prefix of the batch and scales its size to
+//   the full row count
+// ================================================================
+#ifndef CODEC_SELECT_BUDGET_US
+#define CODEC_SELECT_BUDGET_US 20000UL    // CPU time per batch for choosing + compressing
+#endif
+
+#ifndef CODEC_SAMPLE_ROWS
+#define CODEC_SAMPLE_ROWS 16              // rows of the prefix each estimate compresses
+#endif
+
+enum CodecId : uint8_t {
+    CODEC_TIME_SERIES = 1,    // TimeSeriesCompressor (v2 deltas / v3 run-length)
+    CODEC_FOR_PACK    = 2,    // ForPackCompressor
+    CODEC_DELTA_VAR   = 3,    // Delta16VarCompressor over the rows, row-major
+};
+
+struct Codec {
+    CodecId id;
+    const char* name;
+    const uint8_t* params;
+    uint8_t paramBytes;
+    // ref: optional reference row the batch is delta coded against
+    vector<uint8_t> (*compress)(const vector<uint16_t>& values, int regs, const uint16_t* ref);
+    vector<uint16_t> (*decompress)(const vector<uint8_t>& blob, int regs, const uint16_t* ref);
+    // Bytes for `rows` rows, extrapolated from `sample` (whole rows)
+    size_t (*estimate)(const vector<uint16_t>& sample, int regs, size_t rows);
+};
+
+// Registry in preference order (the first one is the fallback)
+const Codec* codecs(size_t& count);
+const Codec* findCodec(uint8_t id);
+
+struct CodecChoice {
+    const Codec* codec;
+    size_t estimatedBytes;
+    unsigned long spentUs;       // Time spent on the estimates
+    unsigned long projectedUs;   // Expected time to compress the whole batch
 };
 
+// 🎯 Picks the codec with the smallest estimate for this batch. A codec
+// is only considered while the estimates so far plus its projected full
+// compress time stay within budgetUs; the fallback is always eligible.
+CodecChoice selectCodec(const vector<uint16_t>& values, int regs,
+                        unsigned long budgetUs = CODEC_SELECT_BUDGET_US,
+                        size_t sampleRows = CODEC_SAMPLE_ROWS);
+
+// Same, from a prefix that is already decoded; rows is the row count of
+// the whole batch
+CodecChoice selectCodecFromSample(const vector<uint16_t>& sample, int regs, size_t rows,
+                                  unsigned long budgetUs = CODEC_SELECT_BUDGET_US);
+
+// ================================================================
+// 📊 Column-count benchmark
+// - Compress/decompress/encoder throughput on a synthetic random walk
+// ================================================================
+struct ColumnBenchResult {
+    int columns;
+    size_t rows;
+    size_t origBytes;
+    size_t compBytes;
+    unsigned long tCompressUs;
+    unsigned long tDecompressUs;
+    unsigned long tEncoderUs;
+    bool lossless;               // decompress(compress(x)) == x
+    bool encoderMatches;         // Encoder's v2 stream, repacked, == compress()
+};
+
+ColumnBenchResult benchmarkColumns(int columns, size_t rows = 60);
+
+// Runs 16, 32 and 64 columns and prints one line each
+void printColumnBenchmark(size_t rows = 60);
+
+// Ratio and µs/sample of every codec on the same synthetic batch
+void printCodecBenchmark(int columns = 16, size_t rows = 120);
+
+// Upload-stream bytes with and without run-length columns, for the
+// default two-register config and with every register read
+void printRunLengthBenchmark(size_t rows = 60);
+
+// Estimated vs actual bytes and the selector's pick on a few batch shapes
+void printCodecSelectionBenchmark(size_t rows = 120);
+
 }  // namespace Compression
 
 #endif  // COMPRESSION_H
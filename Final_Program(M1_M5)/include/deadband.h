@@ -0,0 +1,79 @@
+#ifndef DEADBAND_H
+#define DEADBAND_H
+
+#include <Arduino.h>
+#include "snapshot_record.h"
+#include "request_sim.h"
+
+// ================================================================
+// Report-by-exception acquisition
+// - A register is stored only when it leaves the band around its last
+//   reported value; otherwise its cell is marked held (server keeps the
+//   previous value). Rows with nothing to report are not buffered.
+// - Bands are absolute (register units) or a percentage of the last
+//   reported value; defaults come from the register map units.
+// - Reported values and keyframe timing are kept per slave (row.slave);
+//   bands are the same for every slave.
+// - Every keyframeEvery cycles each register's next reading is reported
+//   in full. The first held cell of each column in an upload batch is
+//   sent as the last reported value (reported()), so the server can
+//   rebuild the series from any batch on its own and never holds a
+//   value other than the one the band is measured from.
+// ================================================================
+namespace Deadband {
+
+    // Upload stream code for held cells (0xFFFF = unread)
+    static const uint16_t HELD_RAW = 0xFFFE;
+
+    static const uint16_t DEFAULT_KEYFRAME_EVERY = 60;
+
+    enum BandType : uint8_t {
+        BAND_ABSOLUTE,     // |value - reported| > width (register units)
+        BAND_PERCENT       // |value - reported| > width % of |reported|
+    };
+
+    struct Band {
+        BandType type;
+        float width;
+    };
+
+    void setEnabled(bool enabled);
+    bool isEnabled();
+
+    void setKeyframeEvery(uint16_t cycles);
+    uint16_t getKeyframeEvery();
+
+    void setBand(int reg, BandType type, float width);
+    Band getBand(int reg);
+    Band defaultBand(int reg);
+    void resetBands();
+
+    // Parses the "deadband" object of the cloud config:
+    //   {"enabled":true,"keyframe_every":60,"bands":[1.0,"2%",0,...]}
+    // Numbers are absolute widths, "N%" strings are percentages, 0 = default.
+    void updateFromConfig(const String& json);
+
+    // Next reading of every register is reported in full
+    void forceKeyframe();
+
+    // Applies the band to one row in place (sets its held bits). Returns
+    // false when the row has nothing to report and should be dropped.
+    bool apply(SnapshotRecord& row);
+
+    // Last value reported for the slave's register (what its held cells
+    // stand for); false when nothing has been reported since the keyframe
+    bool reported(uint8_t slave, int reg, uint16_t& value);
+
+    struct Stats {
+        uint32_t rows;             // Rows offered
+        uint32_t rowsDropped;      // Rows with every cell in band
+        uint32_t keyframes;        // Forced full reports
+        uint32_t cellsReported;    // Cells stored with a value
+        uint32_t cellsHeld;        // Cells marked held
+    };
+    const Stats& stats();
+    void printStats();
+
+}  // namespace Deadband
+
+#endif  // DEADBAND_H
@@ -0,0 +1,71 @@
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <Arduino.h>
+#include "register_map.h"
+
+// Frame slots shared by request building, the transaction engine and
+// decoding: a full queue of requests (FRAME_QUEUE_CAPACITY) plus the
+// responses of the frames in flight and FC06 fallback frames
+#ifndef FRAME_POOL_SLOTS
+#define FRAME_POOL_SLOTS 40
+#endif
+
+// Bytes per slot. Every frame the firmware sends or accepts is small:
+// an FC16 write of the whole register map (9 + 2 * REGISTER_COUNT) or a
+// read response covering it (5 + 2 * REGISTER_COUNT). Responses are
+// received into one full-size ADU buffer and copied down.
+#ifndef FRAME_POOL_SLOT_BYTES
+#define FRAME_POOL_SLOT_BYTES 32
+#endif
+
+// ================================================================
+// Statically allocated Modbus frames
+// - Frames are handed around as one-byte handles; acquire() never
+//   touches the heap and returns NONE when every slot is taken.
+// - Whoever holds a handle releases it: the frame queue until it is
+//   submitted, then the transaction engine after the completion callback.
+// ================================================================
+namespace FramePool {
+
+    typedef uint8_t Handle;
+    static const Handle NONE = 0xFF;
+
+    static const uint8_t SLOTS = FRAME_POOL_SLOTS;
+    static const size_t SLOT_BYTES = FRAME_POOL_SLOT_BYTES;
+
+    static_assert(SLOTS > 0 && SLOTS < NONE, "FRAME_POOL_SLOTS must be 1..254");
+    static_assert(SLOT_BYTES >= 9 + 2 * REGISTER_COUNT,
+                  "FRAME_POOL_SLOT_BYTES too small for an FC16 write of every register");
+
+    struct Frame {
+        uint16_t len;
+        uint8_t bytes[SLOT_BYTES];
+
+        uint8_t operator[](size_t i) const { return bytes[i]; }
+        uint8_t slave() const { return len ? bytes[0] : 0; }
+    };
+
+    // Empty slot, or NONE when the pool is exhausted
+    Handle acquire();
+
+    // Slot holding a copy of `len` bytes; NONE when exhausted or too long
+    Handle copy(const uint8_t* data, size_t len);
+
+    void release(Handle h);
+
+    Frame& get(Handle h);
+
+    struct Stats {
+        uint8_t inUse;             // Slots held right now
+        uint8_t highWater;         // Most slots ever held at once
+        uint32_t acquires;         // Slots handed out
+        uint32_t exhausted;        // Acquires refused, every slot taken
+        uint32_t oversized;        // Copies refused, frame longer than a slot
+    };
+    const Stats& stats();
+    void printStats();
+
+}  // namespace FramePool
+
+#endif  // FRAME_POOL_H
@@ -1,6 +1,34 @@
 #pragma once
-#include <vector>
 #include <Arduino.h>
+#include "frame_pool.h"
+
+// Frames one poll or command batch may queue (also the transaction
+// engine's queue length)
+#ifndef FRAME_QUEUE_CAPACITY
+#define FRAME_QUEUE_CAPACITY 32
+#endif
+
+// Bounded list of pool frames in send order. It owns the handles it
+// holds: clear() releases them, take() hands them over to the caller.
+struct FrameQueue {
+    static const uint8_t CAPACITY = FRAME_QUEUE_CAPACITY;
+    static_assert(CAPACITY <= FramePool::SLOTS, "FRAME_QUEUE_CAPACITY exceeds FRAME_POOL_SLOTS");
+
+    FramePool::Handle handles[CAPACITY];
+    uint8_t count = 0;
+
+    // False (and h released) when the queue is full or h is NONE
+    bool push(FramePool::Handle h);
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const FramePool::Frame& operator[](size_t i) const { return FramePool::get(handles[i]); }
+
+    // Empties the queue without releasing; the caller now owns the handles
+    uint8_t take(FramePool::Handle* out);
+
+    void clear();
+};
 
 // Declare the global frame queue
-extern std::vector<std::vector<uint8_t>> frameQueue;
+extern FrameQueue frameQueue;
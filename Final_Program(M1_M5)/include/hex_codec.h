@@ -0,0 +1,60 @@
+#ifndef HEX_CODEC_H
+#define HEX_CODEC_H
+
+#include <Arduino.h>
+
+// Build the firmware with -D HEX_CODEC_COUNT_ALLOCS=1 and
+// -Wl,--wrap=malloc,--wrap=realloc,--wrap=free (see [env:nodemcuv2_allocbench])
+// to let the benchmark count heap allocations
+#ifndef HEX_CODEC_COUNT_ALLOCS
+#define HEX_CODEC_COUNT_ALLOCS 0
+#endif
+
+// ================================================================
+// Fixed-buffer hex codec and {"frame":"..."} envelope for the
+// simulator API. Everything writes into caller-supplied buffers;
+// nothing here touches the heap.
+// ================================================================
+namespace HexCodec {
+
+    // Largest Modbus RTU ADU
+    static const size_t MAX_FRAME_BYTES = 256;
+
+    // Length of {"frame":""} around the hex digits
+    static const size_t JSON_ENVELOPE_CHARS = 12;
+
+    // Buffer size for the largest envelope, including the terminating NUL
+    static const size_t MAX_JSON_CHARS = JSON_ENVELOPE_CHARS + 2 * MAX_FRAME_BYTES + 1;
+
+    // Bytes → uppercase hex, NUL-terminated. Returns the digit count,
+    // or 0 if dst (capacity `cap`) is too small.
+    size_t encode(const uint8_t* src, size_t len, char* dst, size_t cap);
+
+    // Hex (either case) → bytes. Returns the byte count, or -1 on an odd
+    // length, a non-hex digit or more than `cap` bytes.
+    int decode(const char* hex, size_t len, uint8_t* dst, size_t cap);
+
+    // Writes {"frame":"<HEX>"} into dst. Returns the length, 0 if it does not fit.
+    size_t writeFrameJson(const uint8_t* frame, size_t len, char* dst, size_t cap);
+
+    // Finds the "frame" value in a JSON body (whitespace around ':' allowed)
+    // and decodes it in place. Returns the byte count or -1.
+    int readFrameJson(const char* json, size_t len, uint8_t* dst, size_t cap);
+
+    // Heap traffic of one request/response conversion, old vs new path
+    struct AllocBenchResult {
+        size_t transactions;         // Encode + decode round trips
+        bool counted;                // Allocation counters compiled in
+        float legacyAllocs;          // Heap allocations per transaction (ostringstream/substring)
+        float codecAllocs;           // Heap allocations per transaction (fixed buffers)
+        unsigned long legacyUs;      // Total time, old path
+        unsigned long codecUs;       // Total time, new path
+        bool identical;              // Both paths produce the same JSON and frames
+    };
+
+    // Runs `transactions` random FC03 request/response pairs through both paths
+    AllocBenchResult benchmarkAllocations(size_t transactions = 100);
+    void printAllocBenchmark(const AllocBenchResult& result);
+}
+
+#endif  // HEX_CODEC_H
@@ -0,0 +1,37 @@
+#ifndef HTTP_JSON_TRANSPORT_H
+#define HTTP_JSON_TRANSPORT_H
+
+#include "inverter_transport.h"
+#include "inverter_session.h"
+
+// Simulator API transport: each RTU frame travels as hex text in
+// {"frame":"..."} over an HTTP/1.1 keep-alive session
+// (/api/inverter/read for FC03, /api/inverter/write otherwise).
+class HttpJsonTransport : public InverterTransport {
+public:
+    // Uses `session` if given (not owned), otherwise opens its own
+    explicit HttpJsonTransport(InverterSession* session = nullptr);
+    ~HttpJsonTransport();
+
+    Kind kind() const override { return HTTP_JSON; }
+    const char* name() const override { return "HTTP/JSON"; }
+
+    bool begin(const uint8_t* frame, size_t len) override;
+    Status poll(uint8_t* response, size_t cap, size_t& len) override;
+    bool busy() const override { return _session->busy(); }
+    void abort() override { _session->abort(); }
+    void close() override { _session->close(); }
+
+    void setTimeout(unsigned long ms) override { _session->setTimeout(ms); }
+    Stats stats() const override;
+    void resetStats() override { _session->resetStats(); }
+
+    InverterSession& session() { return *_session; }
+
+private:
+    InverterSession* _session;
+    bool _ownsSession;
+    String _response;
+};
+
+#endif  // HTTP_JSON_TRANSPORT_H
@@ -3,7 +3,103 @@
 
 #include <vector>
 #include <Arduino.h>
+#include "buffer.h"
 
-std::vector<uint8_t> initiateCompression();
+// Upload payload (v6) of one sealed buffer block:
+//   u8  version (6)
+//   u8  codec ID (Compression::CodecId)
+//   u8  flags, bit 0 = referenced: rows are delta coded against the last
+//       row of the previous delivered batch of the same device (codec
+//       `ref` argument); bit 1 = raw: register words are unscaled
+//       (registerMap scales apply), otherwise whole engineering units as
+//       older firmware sent
+//   u8  device: Modbus address of the inverter the rows came from
+//   u16 column count (BE)   u16 row count (BE)
+//   u8  codec parameter bytes, then the parameters (Compression::Codec)
+//   u16 reference check (BE), referenced payloads only: Buffer::rowCrc()
+//       of the reference row and its epoch, so a receiver holding another
+//       row can tell and ask for a resync
+//   u16 epoch column bytes (BE)
+//   epoch column (Compression::EpochEncoder, one epoch per row)
+//   register rows, compressed with that codec
+// v5 payloads are the same without the device byte (device 1); v4
+// payloads have no flags byte either (never referenced); v3 payloads (no codec fields, TimeSeriesCompressor rows) can still be
+// waiting in the spool and decode as before.
+static const uint8_t UPLOAD_PAYLOAD_VERSION = 6;
+static const uint8_t UPLOAD_PAYLOAD_V5 = 5;
+static const uint8_t UPLOAD_PAYLOAD_V4 = 4;
+static const uint8_t UPLOAD_PAYLOAD_V3 = 3;
+static const uint8_t UPLOAD_FLAG_REFERENCED = 0x01;
+static const uint8_t UPLOAD_FLAG_RAW = 0x02;
+static const size_t UPLOAD_HEADER_BYTES = 11;   // without parameters and reference check
+static const uint8_t UPLOAD_LEGACY_DEVICE = 1;  // device of v5 and older payloads
+static const size_t UPLOAD_REFERENCE_BYTES = 2;
+
+// 1 = the first row of a batch is delta coded against the last row of the
+// previously delivered batch instead of being sent absolute. Costs a full
+// decode + re-encode of every referenced batch (fullDecodes / reencodeUs
+// in compressionStats()); keyframes go out straight from the block.
+#ifndef UPLOAD_CROSS_BATCH_DELTA
+#define UPLOAD_CROSS_BATCH_DELTA 1
+#endif
+
+// A keyframe (not referenced) at least every N payloads; failed uploads
+// and resync requests force one too
+#ifndef UPLOAD_KEYFRAME_EVERY
+#define UPLOAD_KEYFRAME_EVERY 20
+#endif
+
+// 1 = per batch hex dump, full decode with printed snapshots and a
+// summary (the old verbose path); 0 = production path below
+#ifndef COMPRESSION_DIAGNOSTICS
+#define COMPRESSION_DIAGNOSTICS 0
+#endif
+
+// Every Nth payload is decoded and its CRC checked against the block's
+// (0 = never); diagnostics mode checks every payload
+#ifndef UPLOAD_VERIFY_EVERY
+#define UPLOAD_VERIFY_EVERY 16
+#endif
+
+// The block is already compressed with TimeSeriesCompressor. Only a
+// prefix of it is decoded to let Compression::selectCodecFromSample()
+// estimate the other codecs; the rows are decoded and recompressed in
+// full only when another codec is expected to come out smaller, or when
+// the payload is referenced (keyframe = false and a delivered batch to
+// refer to). The payload is written once into a buffer sized up front.
+// A rebuild (the same block again after a failed upload) is not counted
+// as a new batch in compressionStats().
+std::vector<uint8_t> initiateCompression(const Buffer::Block& block, bool keyframe = false,
+                                         bool rebuild = false);
+
+bool isReferencedPayload(const std::vector<uint8_t>& payload);
+
+// Device (Modbus address) a payload's rows came from
+uint8_t payloadDevice(const std::vector<uint8_t>& payload);
+
+// 🔗 Cross-batch reference, kept per device: the last payload built was
+// delivered, so its last row is what the server holds now for its device
+void acknowledgeUpload();
+
+// It was not delivered (or the server lost its copy): the next payload
+// of that device is a keyframe
+void dropUploadReference();
+
+// 📊 Totals from the single pass of every payload built
+struct CompressionStats {
+    uint32_t batches;
+    uint32_t rows;
+    uint32_t rawBytes;         // rows as six date/time words + registers
+    uint32_t payloadBytes;
+    uint32_t recompressed;     // batches sent with a codec other than the buffered one
+    uint32_t referenced;       // batches delta coded against the previous one
+    uint32_t encodeUs;         // codec choice + payload layout
+    uint32_t fullDecodes;      // batches decoded whole to be re-encoded (reference or other codec)
+    uint32_t reencodeUs;       // time spent in those decodes and re-encodes
+    uint32_t verified;
+    uint32_t verifyFailures;
+};
+const CompressionStats& compressionStats();
+void printCompressionStats();
 
 #endif
@@ -3,8 +3,19 @@
 
 #include <Arduino.h>
 #include <vector>
+#include "inverter_session.h"
 using namespace std;
 
+// Simulator API endpoint; override with -D INVERTER_API_BASE_URL=\"http://host:port\"
+// to point the firmware at a local stand-in (see simulator/inverter_standin.py)
+#ifndef INVERTER_API_BASE_URL
+#define INVERTER_API_BASE_URL "http://20.15.114.131:8080"
+#endif
+
+#ifndef INVERTER_API_KEY
+#define INVERTER_API_KEY "NjhhZWIwNDU1ZDdmMzg3MzNiMTQ5Yjg2OjY4YWViMDQ1NWQ3ZjM4NzMzYjE0OWI3Yw"
+#endif
+
 namespace InverterUtils {
 
     // Convert Modbus binary frame → JSON string
@@ -13,6 +24,9 @@ namespace InverterUtils {
     // Convert JSON string → binary frame
     vector<uint8_t> jsonToFrame(const String& response);
 
+    // Keep-alive session shared by readAPI / writeAPI
+    InverterSession& getSession();
+
     // Cloud API calls (ESP8266)
     String readAPI(const String& jsonFrame, const String& apiKey);
     String writeAPI(const String& jsonFrame, const String& apiKey);
@@ -5,8 +5,11 @@
 #include <vector>
 #include "decoded_registers.h"
 #include "temporary_buffer.h"
-#include "timed_snapshot.h"
+#include "snapshot_record.h"
 #include "register_map.h"
+#include "inverter_transport.h"
+#include "frame_pool.h"
+#include "frame_queue.h"
 
 using namespace std;
 
@@ -19,17 +22,33 @@ namespace InverterSim {
     String readAPI(const String& jsonFrame, const String& apiKey);
     String writeAPI(const String& jsonFrame, const String& apiKey);
 
+    // Wire format used for every frame (default: INVERTER_TRANSPORT).
+    // Switching closes the current connections; call while the engine is idle.
+    void setTransport(InverterTransport::Kind kind);
+    InverterTransport::Kind getTransportKind();
+
+    // Transport for one in-flight slot (slot 0 also serves blocking sends)
+    InverterTransport& getTransport(uint8_t slot = 0);
+    void printTransportStats();
+
     // Main function to send a frame to the inverter simulator
-    bool sendFrameToInverter(const vector<uint8_t>& frame);
+    bool sendFrameToInverter(const uint8_t* frame, size_t len);
+
+    // Queue all frames on the non-blocking transaction engine (it takes
+    // over the pool slots, frames is left empty)
+    void processFrameQueue(FrameQueue& frames);
 
-    // Process all frames in queue with retry logic
-    void processFrameQueue(const vector<vector<uint8_t>>& frames);
+    // TransactionEngine completion callback: validates and decodes the response
+    void onTransactionComplete(const FramePool::Frame& request, const FramePool::Frame& response, bool success);
 
-    void processResponseFrame(const String& response, uint16_t startAddr);
+    // Returns true when the response decoded into a valid Modbus frame
+    bool processResponseFrame(const String& response, uint16_t startAddr, uint16_t quantity = 0);
+    bool processResponseFrame(const uint8_t* frame, size_t len, uint16_t startAddr, uint16_t quantity = 0);
 
-    bool validateCRC(const vector<uint8_t>& frame);
+    bool validateCRC(const uint8_t* frame, size_t len);
 
-    TimedSnapshot decodeResponseFrame(const vector<uint8_t>& frame, uint16_t startAddr);
+    // Scatters a read response's registers into snapshot; returns how many
+    int decodeResponseFrame(const uint8_t* frame, size_t len, uint16_t startAddr, SnapshotRecord& snapshot);
 
 
 }
@@ -0,0 +1,96 @@
+#ifndef INVERTER_SESSION_H
+#define INVERTER_SESSION_H
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include "hex_codec.h"
+
+// Reusable HTTP/1.1 keep-alive session to the inverter simulator API.
+// One TCP connection is kept open across frames and polling cycles and
+// re-opened automatically when the server or the Wi-Fi link drops it.
+//
+// Requests can be driven two ways:
+//   - post(): blocking, returns the response body
+//   - beginPost() + poll(): the request is written and poll() is called
+//     from loop() until the response is complete, without blocking
+class InverterSession {
+public:
+    enum PollStatus {
+        POLL_PENDING,      // Response not complete yet
+        POLL_DONE,         // Body available
+        POLL_FAILED        // Connection lost, timeout or malformed reply
+    };
+
+    struct Stats {
+        uint32_t requests;         // POSTs attempted
+        uint32_t failures;         // POSTs that returned no response
+        uint32_t connects;         // TCP connections opened (1 = fully reused)
+        uint32_t reconnects;       // Retries after a dropped connection
+        uint32_t bytesOut;         // Request bytes written (headers + body)
+        uint32_t bytesIn;          // Response bytes read (headers + body)
+        unsigned long lastUs;      // Latency of the last request
+        unsigned long maxUs;       // Worst request latency
+        unsigned long totalUs;     // Sum of request latencies
+    };
+
+    InverterSession(const String& baseUrl, const String& apiKey);
+
+    // POST a JSON body to baseUrl + path; returns the body or "" on failure
+    String post(const char* path, const String& jsonBody);
+
+    // Non-blocking form: write the request, then poll() until DONE/FAILED
+    bool beginPost(const char* path, const String& jsonBody);
+    bool beginPost(const char* path, const char* jsonBody, size_t len);
+    PollStatus poll(String& response);
+    bool busy() const { return _busy; }
+
+    // Give up on the in-flight request (counted as a failure)
+    void abort();
+
+    // Drop the TCP connection (next post reconnects)
+    void close();
+
+    void setBaseUrl(const String& baseUrl);
+    void setApiKey(const String& apiKey) { _apiKey = apiKey; }
+    void setTimeout(unsigned long ms) { _timeoutMs = ms; }
+    const Stats& stats() const { return _stats; }
+    void resetStats();
+    void printStats() const;
+
+private:
+    // Receive buffer capacity: response headers plus the largest frame envelope
+    static const size_t RX_RESERVE = 256 + HexCodec::MAX_JSON_CHARS;
+
+    bool connect();
+    bool sendRequest();
+    void parseHeaders();
+    bool bodyComplete();
+    String extractBody();
+    PollStatus finish(bool ok);
+
+    WiFiClient _client;
+    String _baseUrl;
+    String _host;
+    uint16_t _port;
+    String _apiKey;
+    unsigned long _timeoutMs;
+    Stats _stats;
+
+    // In-flight request
+    bool _busy;
+    bool _reused;              // request went out on a kept-alive socket
+    bool _resent;              // already retried on a fresh socket
+    const char* _path;
+    char _body[HexCodec::MAX_JSON_CHARS];   // kept for a resend
+    size_t _bodyLen;
+    String _rx;                // raw response bytes
+    int _headerEnd;            // offset of the body, -1 until headers end
+    int _httpCode;
+    long _contentLength;       // -1 when not announced
+    bool _chunked;
+    bool _keepAlive;
+    unsigned long _startUs;
+    unsigned long _startMs;
+};
+
+#endif  // INVERTER_SESSION_H
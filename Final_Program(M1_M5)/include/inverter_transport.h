@@ -0,0 +1,82 @@
+#ifndef INVERTER_TRANSPORT_H
+#define INVERTER_TRANSPORT_H
+
+#include <Arduino.h>
+
+class InverterSession;
+
+// Wire format between the firmware and the inverter gateway:
+//   0 = HTTP/JSON simulator API (hex frame inside {"frame":"..."})
+//   1 = Modbus-TCP (MBAP header + raw PDU over a persistent TCP socket)
+#ifndef INVERTER_TRANSPORT
+#define INVERTER_TRANSPORT 0
+#endif
+
+// Modbus-TCP gateway; see simulator/modbus_tcp_standin.py for a local one
+#ifndef INVERTER_MODBUS_TCP_HOST
+#define INVERTER_MODBUS_TCP_HOST "20.15.114.131"
+#endif
+
+#ifndef INVERTER_MODBUS_TCP_PORT
+#define INVERTER_MODBUS_TCP_PORT 502
+#endif
+
+// ================================================================
+// One request/response channel to the inverter. Callers always hand
+// over and get back complete Modbus RTU frames (CRC included), so
+// validation and decoding do not depend on the wire format.
+// ================================================================
+class InverterTransport {
+public:
+    enum Kind : uint8_t {
+        HTTP_JSON = 0,
+        MODBUS_TCP = 1
+    };
+
+    enum Status {
+        PENDING,           // Response not complete yet
+        DONE,              // Response frame available
+        FAILED             // Connection lost, timeout or malformed reply
+    };
+
+    struct Stats {
+        uint32_t requests;         // Exchanges started
+        uint32_t failures;         // Exchanges that returned no response
+        uint32_t connects;         // TCP connections opened
+        uint32_t bytesOut;         // Bytes written to the socket
+        uint32_t bytesIn;          // Bytes read from the socket
+        unsigned long maxUs;       // Worst exchange latency
+        unsigned long totalUs;     // Sum of exchange latencies
+    };
+
+    virtual ~InverterTransport() {}
+
+    virtual Kind kind() const = 0;
+    virtual const char* name() const = 0;
+
+    // Send one RTU request frame; poll() until DONE/FAILED
+    virtual bool begin(const uint8_t* frame, size_t len) = 0;
+    virtual Status poll(uint8_t* response, size_t cap, size_t& len) = 0;
+    virtual bool busy() const = 0;
+
+    // Give up on the in-flight exchange (counted as a failure)
+    virtual void abort() = 0;
+
+    // Drop the connection (next exchange reconnects)
+    virtual void close() = 0;
+
+    virtual void setTimeout(unsigned long ms) = 0;
+    virtual Stats stats() const = 0;
+    virtual void resetStats() = 0;
+
+    // Blocking exchange built on begin()/poll()
+    bool exchange(const uint8_t* frame, size_t len, uint8_t* response, size_t cap, size_t& respLen);
+
+    void printStats() const;
+
+    // HTTP_JSON instances open their own keep-alive session unless one is given
+    static InverterTransport* create(Kind kind, InverterSession* session = nullptr);
+    static const char* kindName(Kind kind);
+};
+
+#endif  // INVERTER_TRANSPORT_H
@@ -0,0 +1,56 @@
+#ifndef MODBUS_TCP_TRANSPORT_H
+#define MODBUS_TCP_TRANSPORT_H
+
+#include <WiFiClient.h>
+#include "inverter_transport.h"
+#include "hex_codec.h"
+
+// Modbus-TCP transport: the RTU frame is re-framed as
+//   MBAP [transaction id:2][protocol 0:2][length:2][unit id:1] + PDU
+// (slave address → unit id, CRC dropped) and sent over one persistent
+// TCP socket. Responses are turned back into RTU frames with a fresh
+// CRC so the decoder sees the same bytes as over HTTP/JSON.
+class ModbusTcpTransport : public InverterTransport {
+public:
+    static const size_t MBAP_HEADER_BYTES = 7;
+
+    ModbusTcpTransport(const char* host, uint16_t port);
+
+    Kind kind() const override { return MODBUS_TCP; }
+    const char* name() const override { return "Modbus-TCP"; }
+
+    bool begin(const uint8_t* frame, size_t len) override;
+    Status poll(uint8_t* response, size_t cap, size_t& len) override;
+    bool busy() const override { return _busy; }
+    void abort() override;
+    void close() override;
+
+    void setTimeout(unsigned long ms) override { _timeoutMs = ms; }
+    Stats stats() const override { return _stats; }
+    void resetStats() override { _stats = Stats{}; }
+
+private:
+    bool connect();
+    bool sendRequest();
+    Status finish(bool ok);
+
+    WiFiClient _client;
+    const char* _host;
+    uint16_t _port;
+    unsigned long _timeoutMs;
+    Stats _stats;
+
+    // In-flight exchange
+    bool _busy;
+    bool _reused;              // request went out on a kept-alive socket
+    bool _resent;              // already retried on a fresh socket
+    uint16_t _transactionId;
+    uint8_t _tx[MBAP_HEADER_BYTES + HexCodec::MAX_FRAME_BYTES];
+    size_t _txLen;
+    uint8_t _rx[MBAP_HEADER_BYTES + HexCodec::MAX_FRAME_BYTES];
+    size_t _rxLen;
+    unsigned long _startUs;
+    unsigned long _startMs;
+};
+
+#endif  // MODBUS_TCP_TRANSPORT_H
@@ -4,9 +4,55 @@
 #include <Arduino.h>
 #include <vector>
 
+// Set to 0 to drop the three extra slicing tables (saves 1.5 KB flash)
+#ifndef MODBUS_CRC_SLICE4
+#define MODBUS_CRC_SLICE4 1
+#endif
+
+// Set to 1 to print the CRC16 variant benchmark at boot (host version:
+// pio test -e native, see test/test_crc)
+#ifndef MODBUS_CRC_BENCHMARK
+#define MODBUS_CRC_BENCHMARK 0
+#endif
+
 namespace Modbus {
+
+    // CRC register value at the start of every frame
+    static const uint16_t CRC_INIT = 0xFFFF;
+
+    // Frames at least this long use the slicing-by-4 loop
+    static const size_t CRC_SLICE4_MIN_LEN = 16;
+
     // Calculates Modbus RTU CRC16 (LSB first, polynomial 0xA001)
-    uint16_t modbusCRC(uint8_t *buf, int len);
+    uint16_t modbusCRC(const uint8_t *buf, int len);
+
+    // Incremental form: start from CRC_INIT and feed bytes as they are built
+    uint16_t crcUpdate(uint16_t crc, uint8_t byte);
+    uint16_t crcUpdate(uint16_t crc, const uint8_t *buf, size_t len);
+
+    // Table-driven byte-at-a-time and slicing-by-4 variants
+    uint16_t crcTable(uint16_t crc, const uint8_t *buf, size_t len);
+    uint16_t crcSlice4(uint16_t crc, const uint8_t *buf, size_t len);
+
+    // Reference bit-at-a-time loop (kept for the benchmark)
+    uint16_t crcBitwise(const uint8_t *buf, size_t len);
+
+    // Append CRC (low byte first) over the whole frame
+    void appendCRC(std::vector<uint8_t>& frame);
+
+    // CRC throughput report over random frames
+    struct CrcBenchResult {
+        size_t frames;               // Random frames checked
+        size_t bytes;                // Total bytes hashed per variant
+        unsigned long tBitwiseUs;    // Old bit-at-a-time loop
+        unsigned long tTableUs;      // 256-entry table, one byte per step
+        unsigned long tSlice4Us;     // Slicing-by-4 (0 if disabled)
+        bool identical;              // All variants agree on every frame
+    };
+
+    // Compares the variants on `frames` random frames of 4..maxLen bytes
+    CrcBenchResult benchmarkCRC(size_t frames = 200, size_t maxLen = 256);
+    void printCrcBenchmark(const CrcBenchResult& result);
 }
 
 #endif  // MODBUS_UTILS_H
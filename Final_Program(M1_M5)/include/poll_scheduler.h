@@ -0,0 +1,48 @@
+#ifndef POLL_SCHEDULER_H
+#define POLL_SCHEDULER_H
+
+#include <Arduino.h>
+#include "request_sim.h"
+
+// ================================================================
+// Multi-rate polling
+// - The global pollingInterval is the base tick; every polling cycle
+//   starts on a multiple of it, so all snapshots share one time base.
+// - Each register may have a slower period (cloud config "reg_period",
+//   ms, 0 = every tick). Periods are rounded to whole ticks, and a
+//   register is due on ticks that are a multiple of its period, so
+//   slow registers land on the same instants as the fast ones.
+// ================================================================
+namespace PollScheduler {
+
+    // Upper bound on a register period, in base ticks
+    static const uint16_t MAX_PERIOD_TICKS = 3600;
+
+    void setPeriod(int reg, uint32_t periodMs);
+    uint32_t getPeriod(int reg);
+    void clearPeriods();
+
+    // Whole base ticks between reads of `reg` (>= 1)
+    uint16_t periodTicks(int reg, unsigned long baseIntervalMs);
+
+    // Registers enabled in `enabled` that are due on the current tick;
+    // call advance() once the cycle has been started
+    RequestSIM due(const RequestSIM& enabled, unsigned long baseIntervalMs);
+    void advance();
+
+    // Start again at tick 0 (every enabled register due)
+    void reset();
+    uint32_t currentTick();
+
+    // Register reads issued vs. what single-rate polling would have issued
+    struct Stats {
+        uint32_t cycles;
+        uint32_t regsPolled;
+        uint32_t regsSkipped;
+    };
+    const Stats& stats();
+    void printStats();
+
+}  // namespace PollScheduler
+
+#endif  // POLL_SCHEDULER_H
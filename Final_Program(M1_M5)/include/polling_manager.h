@@ -16,6 +16,12 @@ namespace PollingManager {
     void begin(unsigned long intervalMs = 5000);
     void handle();
 
+    // True while frames of the current polling cycle are in flight
+    bool cycleInProgress();
+
+    // Time left until the next polling tick (0 when one is due)
+    unsigned long msUntilNextPoll();
+
 }  // namespace PollingManager
 
 #endif  // POLLING_MANAGER_H
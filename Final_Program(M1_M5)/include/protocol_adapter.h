@@ -3,20 +3,41 @@
 
 #include <Arduino.h>
 #include <vector>
-#include "request_sim.h" 
+#include "request_sim.h"
+#include "slave_registry.h"
+#include "frame_pool.h"
+#include "frame_queue.h"
 
 using namespace std;
 
 namespace ProtocolAdapter {
 
-    // Build Modbus Request Frame
-    vector<uint8_t> BuildRequestFrame(uint8_t slaveAddr, uint8_t funcCode, uint16_t startAddr, uint16_t numReg, uint16_t data = 0);
+    // Build Modbus Request Frame into a pool slot (NONE if the pool is exhausted)
+    FramePool::Handle BuildRequestFrame(uint8_t slaveAddr, uint8_t funcCode, uint16_t startAddr, uint16_t numReg, uint16_t data = 0);
 
-    // Decode struct → Build & Queue frames
-    const vector<vector<uint8_t>>& decodeRequestStruct(const RequestSIM &input);
+    // Build Modbus Write Multiple Registers (0x10) frame from `count` values
+    FramePool::Handle BuildRequestFrame(uint8_t slaveAddr, uint8_t funcCode, uint16_t startAddr,
+                                        const uint16_t* values, uint16_t count);
+
+    // Split an FC16 frame into equivalent FC06 frames appended to `out`
+    // (fallback path); returns how many were added
+    size_t splitWriteMultiple(const FramePool::Frame& frame, FrameQueue& out);
+
+    // FC16 batching switch (cleared when the device rejects 0x10)
+    void setWriteMultipleEnabled(bool enabled);
+    bool isWriteMultipleEnabled();
+
+    // Decode struct → Build & Queue frames for one slave (appends to the queue)
+    // Returns how many frames could not be queued (pool or queue full)
+    int decodeRequestStruct(const RequestSIM &input,
+                            uint8_t slaveAddr = SlaveRegistry::defaultAddress());
+
+    // Reorders frames round-robin across slaves (first frame of each slave,
+    // then the second, ...), keeping each slave's own order
+    void interleaveBySlave(FrameQueue& frames);
 
     // Queue accessors
-    const vector<vector<uint8_t>>& getFrameQueue();
+    FrameQueue& getFrameQueue();
     void clearFrameQueue();
 
 }  // namespace ProtocolAdapter
@@ -0,0 +1,103 @@
+#ifndef READ_PLANNER_H
+#define READ_PLANNER_H
+
+#include <Arduino.h>
+#include <vector>
+#include "request_sim.h"
+#include "register_map.h"
+
+using namespace std;
+
+// One contiguous FC03 range read
+struct ReadRange {
+    uint16_t startAddr;    // First register address in the frame
+    uint16_t count;        // Number of registers read by the frame
+};
+
+// Result of planning a RequestSIM::read[] bitmap
+struct ReadPlan {
+    vector<ReadRange> ranges;   // One entry per FC03 frame
+    size_t wantedRegs;          // Registers actually requested
+    size_t extraRegs;           // Unwanted registers read to bridge gaps
+    size_t requestBytes;        // Wire bytes of all request frames
+    size_t responseBytes;       // Wire bytes of all expected responses
+
+    size_t frameCount() const { return ranges.size(); }
+    size_t wireBytes() const { return requestBytes + responseBytes; }
+};
+
+namespace ReadPlanner {
+
+    // Modbus RTU sizes used for wire-byte estimates
+    static const size_t FC03_REQUEST_BYTES  = 8;   // addr + fc + start(2) + count(2) + crc(2)
+    static const size_t FC03_RESPONSE_BASE  = 5;   // addr + fc + byteCount + crc(2)
+    static const uint16_t FC03_MAX_REGS     = 125; // Modbus spec limit for one FC03 read
+
+    // Defaults: bridge gaps up to 16 registers, frames up to the spec limit
+    static const uint16_t DEFAULT_MAX_GAP           = 16;
+    static const uint16_t DEFAULT_MAX_REGS_PER_FRAME = FC03_MAX_REGS;
+
+    // Plan of a read bitmask (bit i = register i) in fixed storage. The
+    // planner core is constexpr, so plans of masks known at build time
+    // are produced by the compiler.
+    struct MaskPlan {
+        ReadRange ranges[REGISTER_COUNT];
+        uint8_t count;      // ranges used
+        uint8_t wanted;     // registers requested
+        uint8_t extra;      // unwanted registers bridged
+    };
+
+    constexpr MaskPlan planMask(uint32_t mask, uint16_t maxGap, uint16_t maxRegsPerFrame) {
+        MaskPlan p{};
+        int i = 0;
+        while (i < REGISTER_COUNT) {
+            // Skip to the next wanted register
+            if (!((mask >> i) & 1)) { i++; continue; }
+
+            int start = i;
+            int last = i;            // last wanted register inside this range
+            p.wanted++;
+
+            // Extend while the next wanted register is within gap tolerance
+            // and the frame stays within the per-frame limit
+            for (int j = i + 1; j < REGISTER_COUNT; j++) {
+                if (!((mask >> j) & 1)) continue;
+                int gap = j - last - 1;
+                if (gap > maxGap || j - start + 1 > maxRegsPerFrame) break;
+                p.extra += gap;
+                p.wanted++;
+                last = j;
+            }
+
+            p.ranges[p.count].startAddr = (uint16_t)start;
+            p.ranges[p.count].count = (uint16_t)(last - start + 1);
+            p.count++;
+            i = last + 1;
+        }
+        return p;
+    }
+
+    // Every register, default limits: built at compile time
+    constexpr MaskPlan FULL_READ_PLAN =
+        planMask(RegisterMap::ALL_MASK, DEFAULT_MAX_GAP, DEFAULT_MAX_REGS_PER_FRAME);
+    static_assert(FULL_READ_PLAN.count == (REGISTER_COUNT + FC03_MAX_REGS - 1) / FC03_MAX_REGS,
+                  "A full read must need no more frames than the FC03 limit forces");
+
+    // Set gap tolerance (unwanted registers bridged inside one frame)
+    // and the maximum registers per frame (clamped to 1..125)
+    void setLimits(uint16_t maxGap, uint16_t maxRegsPerFrame);
+    uint16_t getMaxGap();
+    uint16_t getMaxRegsPerFrame();
+
+    // Turn the read bitmap into the minimal set of contiguous FC03 reads
+    ReadPlan plan(const RequestSIM& input);
+    ReadPlan plan(const bool* read, int count);
+    ReadPlan plan(uint32_t mask);
+
+    // Print frame count and wire bytes vs. the old one full-map FC03
+    // per wanted register
+    void printPlan(const ReadPlan& plan);
+
+}  // namespace ReadPlanner
+
+#endif  // READ_PLANNER_H
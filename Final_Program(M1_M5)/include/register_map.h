@@ -3,30 +3,143 @@
 
 #include <Arduino.h>
 
-// Define the RegisterInfo structure
+// Engineering unit of a register (strings in register_map.cpp)
+enum RegisterUnit : uint8_t {
+    UNIT_VOLT,
+    UNIT_AMP,
+    UNIT_HERTZ,
+    UNIT_CELSIUS,
+    UNIT_PERCENT,
+    UNIT_WATT,
+    UNIT_KINDS
+};
+
+// ================================================================
+// Register map: one line per register, in Modbus address order
+// (R0 to R9; extend if you add more). Everything else is generated
+// from this list: the constexpr registerMap and the tables below at
+// compile time, the flash name/unit strings in register_map.cpp.
+//   X(address, name, scale, unit, writable)
+// ================================================================
+#define REGISTER_MAP_ENTRIES(X) \
+    X(0, "Vac1 / L1 Phase voltage",       10,  UNIT_VOLT,    false) \
+    X(1, "Iac1 / L1 Phase current",       10,  UNIT_AMP,     false) \
+    X(2, "Fac1 / L1 Phase frequency",     100, UNIT_HERTZ,   false) \
+    X(3, "Vpv1 / PV1 input voltage",      10,  UNIT_VOLT,    false) \
+    X(4, "Vpv2 / PV2 input voltage",      10,  UNIT_VOLT,    false) \
+    X(5, "Ipv1 / PV1 input current",      10,  UNIT_AMP,     false) \
+    X(6, "Ipv2 / PV2 input current",      10,  UNIT_AMP,     false) \
+    X(7, "Inverter internal temperature", 10,  UNIT_CELSIUS, false) \
+    X(8, "Export power percentage",       1,   UNIT_PERCENT, true)  \
+    X(9, "Pac L / Inverter output power", 1,   UNIT_WATT,    false)
+
 struct RegisterInfo {
-    uint8_t index;       // Register index (R0, R1, ...)
-    const char *name;    // Register description
+    uint8_t index;       // Register address (R0, R1, ...), also its upload column
     uint16_t scale;      // Scale factor (e.g. 10, 100)
-    const char *unit;    // Unit (e.g. V, A, Hz)
+    RegisterUnit unit;   // Unit (e.g. V, A, Hz)
     bool writable;       // true = can write
 };
 
-// R0 to R9 (extend if you add more)
-const RegisterInfo registerMap[] = {
-    {0, "Vac1 / L1 Phase voltage", 10, "V", false},
-    {1, "Iac1 / L1 Phase current", 10, "A", false},
-    {2, "Fac1 / L1 Phase frequency", 100, "Hz", false},
-    {3, "Vpv1 / PV1 input voltage", 10, "V", false},
-    {4, "Vpv2 / PV2 input voltage", 10, "V", false},
-    {5, "Ipv1 / PV1 input current", 10, "A", false},
-    {6, "Ipv2 / PV2 input current", 10, "A", false},
-    {7, "Inverter internal temperature", 10, "°C", false},
-    {8, "Export power percentage", 1, "%", true},
-    {9, "Pac L / Inverter output power", 1, "W", false}
-};
+#define REGISTER_INFO_ENTRY(addr, name, scale, unit, writable) { addr, scale, unit, writable },
+constexpr RegisterInfo registerMap[] = { REGISTER_MAP_ENTRIES(REGISTER_INFO_ENTRY) };
+#undef REGISTER_INFO_ENTRY
 
 // Automatically count registers
-const int REGISTER_COUNT = sizeof(registerMap) / sizeof(registerMap[0]);
+constexpr int REGISTER_COUNT = sizeof(registerMap) / sizeof(registerMap[0]);
+
+namespace RegisterMap {
+
+    // Register bitmasks (bit i = register i)
+    constexpr uint32_t maskOf(bool RegisterInfo::*field) {
+        uint32_t mask = 0;
+        for (int i = 0; i < REGISTER_COUNT; i++) {
+            if (registerMap[i].*field) mask |= 1UL << i;
+        }
+        return mask;
+    }
+    constexpr uint32_t ALL_MASK = REGISTER_COUNT >= 32 ? 0xFFFFFFFFUL : (1UL << REGISTER_COUNT) - 1;
+    constexpr uint32_t WRITABLE_MASK = maskOf(&RegisterInfo::writable);
+
+    constexpr bool isWritable(int reg) {
+        return reg >= 0 && reg < REGISTER_COUNT && ((WRITABLE_MASK >> reg) & 1);
+    }
+
+    // Upload column j carries register j: rows are laid out by address,
+    // and the cloud decodes them by position
+    constexpr bool columnsMatchAddresses() {
+        for (int i = 0; i < REGISTER_COUNT; i++) {
+            if (registerMap[i].index != i || registerMap[i].scale == 0) return false;
+        }
+        return true;
+    }
+    static_assert(columnsMatchAddresses(),
+                  "registerMap must list R0, R1, ... in order with non-zero scales");
+    static_assert(REGISTER_COUNT <= 16,
+                  "Snapshot presence/held bitmasks and upload run masks hold 16 registers");
+
+    // Flash strings copied into buf (always terminated); return buf
+    const char* name(int reg, char* buf, size_t cap);
+    const char* unit(int reg, char* buf, size_t cap);
+
+    static const size_t NAME_CHARS = 40;    // longest name + terminator
+    static const size_t UNIT_CHARS = 4;     // "°C" is three bytes
+
+}  // namespace RegisterMap
+
+// ================================================================
+// Fixed-point scaling
+// - Acquisition, buffer and upload codecs carry raw register words;
+//   value = raw / scale is only formed where it is shown.
+// - Tables are generated at compile time from registerMap, so no
+//   float or divide runs per sample:
+//     whole    = (raw * recip) >> 32   exact for every 16-bit raw
+//     fraction = raw - whole * scale   in `decimals` digits when scale
+//                                      is a power of ten
+// ================================================================
+struct ScaleTables {
+    uint32_t recip[REGISTER_COUNT];      // ceil(2^32 / scale), 0 for scale 1
+    uint16_t scale[REGISTER_COUNT];
+    uint16_t pow10[REGISTER_COUNT];      // 10^decimals
+    uint8_t decimals[REGISTER_COUNT];    // digits needed to show 1 / scale
+};
+
+constexpr ScaleTables makeScaleTables() {
+    ScaleTables t{};
+    for (int i = 0; i < REGISTER_COUNT; i++) {
+        uint32_t scale = registerMap[i].scale ? registerMap[i].scale : 1;
+        t.scale[i] = (uint16_t)scale;
+        t.recip[i] = scale > 1 ? (uint32_t)((((uint64_t)1 << 32) + scale - 1) / scale) : 0;
+        uint32_t p = 1;
+        uint8_t d = 0;
+        while (p < scale && d < 4) { p *= 10; d++; }
+        t.pow10[i] = (uint16_t)p;
+        t.decimals[i] = d;
+    }
+    return t;
+}
+
+constexpr ScaleTables SCALE_TABLES = makeScaleTables();
+
+// Integer part of raw / scale
+inline uint16_t scaledWhole(int reg, uint16_t raw) {
+    uint32_t r = SCALE_TABLES.recip[reg];
+    return r ? (uint16_t)(((uint64_t)raw * r) >> 32) : raw;
+}
+
+// Writes raw / scale in engineering units ("49.98"); returns snprintf's count
+inline int formatScaled(char* buf, size_t cap, int reg, uint16_t raw) {
+    if (reg < 0 || reg >= REGISTER_COUNT) return snprintf(buf, cap, "%u", raw);
+    uint16_t whole = scaledWhole(reg, raw);
+    uint8_t decimals = SCALE_TABLES.decimals[reg];
+    if (decimals == 0) return snprintf(buf, cap, "%u", whole);
+
+    uint32_t scale = SCALE_TABLES.scale[reg];
+    uint32_t rem = raw - (uint32_t)whole * scale;
+    uint32_t frac = scale == SCALE_TABLES.pow10[reg] ? rem : rem * SCALE_TABLES.pow10[reg] / scale;
+    return snprintf(buf, cap, "%u.%0*u", whole, (int)decimals, (unsigned)frac);
+}
+
+// Enough for formatScaled() of any register
+static const size_t SCALED_VALUE_CHARS = 12;
 
 #endif
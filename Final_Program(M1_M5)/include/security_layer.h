@@ -8,4 +8,7 @@
 std::vector<uint8_t> encryptBuffer(const std::vector<uint8_t>& plain);
 std::vector<uint8_t> decryptBuffer(const std::vector<uint8_t>& packet);
 
+// Next packet is numbered above `seq` (packets spooled before a reboot)
+void ensureSequenceAbove(uint32_t seq);
+
 #endif // SECURITY_LAYER_H
@@ -0,0 +1,81 @@
+#ifndef SLAVE_REGISTRY_H
+#define SLAVE_REGISTRY_H
+
+#include <Arduino.h>
+#include "request_sim.h"
+
+// Modbus addresses of the inverters on the gateway's bus, polled round-
+// robin every cycle (e.g. -D INVERTER_SLAVES=1,2,3). The cloud config can
+// replace the list at runtime ("slaves", see updateFromConfig()).
+#ifndef INVERTER_SLAVES
+#define INVERTER_SLAVES 0x01
+#endif
+
+#ifndef MAX_INVERTER_SLAVES
+#define MAX_INVERTER_SLAVES 4
+#endif
+
+// A slave that has not answered a single frame for this many cycles in a
+// row is only polled every 2, 4, ... up to SLAVE_MAX_SKIP_CYCLES cycles,
+// so a dead device stops spending timeouts on the shared bus
+#ifndef SLAVE_FAILS_BEFORE_SKIP
+#define SLAVE_FAILS_BEFORE_SKIP 3
+#endif
+
+#ifndef SLAVE_MAX_SKIP_CYCLES
+#define SLAVE_MAX_SKIP_CYCLES 32
+#endif
+
+// ================================================================
+// Inverters behind one gateway
+// - Each slave has its own request config, or follows the global
+//   requestSim (cloud "reg_read") when it has none.
+// - Slaves are addressed by index 0..count()-1 here; frames, buffered
+//   blocks and upload payloads carry the Modbus address instead.
+// ================================================================
+namespace SlaveRegistry {
+
+    static const uint8_t MAX_SLAVES = MAX_INVERTER_SLAVES;
+    static const uint8_t NO_SLAVE = 0xFF;
+
+    // Loads the INVERTER_SLAVES list (first slave = default device)
+    void begin();
+
+    uint8_t count();
+    uint8_t address(uint8_t index);
+    int indexOf(uint8_t address);          // -1 when not registered
+    uint8_t defaultAddress();              // first slave, for untagged requests
+
+    // Valid addresses are 1..247; false when full or already present
+    bool add(uint8_t address);
+    void clear();
+
+    // Registers read/written on slave `index` (its own config or requestSim)
+    const RequestSIM& request(uint8_t index);
+    void setRequest(uint8_t index, const RequestSIM& request);
+    void followDefaultRequest(uint8_t index);
+
+    // Parses the "slaves" array of the cloud config:
+    //   "slaves":[{"address":1},{"address":2,"reg_read":[1,1,0,...]}]
+    // Slaves without reg_read follow the global one. Absent or [] = keep the list.
+    void updateFromConfig(const String& json);
+
+    // --- Per-cycle health ---
+    // Slaves to poll this cycle (skipping ones that keep failing)
+    bool shouldPoll(uint8_t index);
+    void beginCycle(uint8_t index);
+    void recordResponse(uint8_t address);
+    void endCycle();
+
+    struct Stats {
+        uint32_t cycles;           // Cycles the slave was polled in
+        uint32_t silentCycles;     // Polled cycles without any response
+        uint32_t skippedCycles;    // Cycles left out while backing off
+        uint32_t responses;        // Frames answered
+    };
+    const Stats& stats(uint8_t index);
+    void printStats();
+
+}  // namespace SlaveRegistry
+
+#endif  // SLAVE_REGISTRY_H
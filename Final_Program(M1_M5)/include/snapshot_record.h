@@ -0,0 +1,62 @@
+#ifndef SNAPSHOT_RECORD_H
+#define SNAPSHOT_RECORD_H
+
+#include <Arduino.h>
+#include <time.h>
+#include "register_map.h"
+
+// One register snapshot as a fixed-size POD record (no heap):
+// raw register words as read from the inverter plus presence bits.
+// Scaling to engineering units happens only where values are shown
+// (formatScaled() in register_map.h).
+struct SnapshotRecord {
+    uint32_t epoch;                  // Unix time of the poll (0 = invalid frame)
+    uint16_t raw[REGISTER_COUNT];    // Unscaled register values
+    uint16_t present;                // Bit i set: raw[i] was read this cycle
+    uint16_t held;                   // Bit i set: raw[i] within its deadband (see Deadband)
+    uint16_t failed;                 // Bit i set: raw[i]'s frame timed out or was refused
+    uint8_t slave;                   // Modbus address of the inverter it came from
+
+    void clear() { memset(this, 0, sizeof(*this)); }
+
+    bool has(int reg) const    { return (present >> reg) & 1; }
+    bool isHeld(int reg) const { return (held >> reg) & 1; }
+    bool hasFailed(int reg) const { return (failed >> reg) & 1; }
+
+    void set(int reg, uint16_t value) {
+        raw[reg] = value;
+        present |= (uint16_t)(1u << reg);
+    }
+
+    // Requested this cycle but not delivered (see TemporaryBuffer::markFailed)
+    void fail(int reg) { failed |= (uint16_t)(1u << reg); }
+
+    // Keeps the register in the row but marks it "same as last reported"
+    void hold(int reg) { held |= (uint16_t)(1u << reg); }
+
+    void drop(int reg) {
+        present &= (uint16_t)~(1u << reg);
+        held &= (uint16_t)~(1u << reg);
+    }
+
+    // Writes raw[reg] in engineering units into buf
+    int formatValue(char* buf, size_t cap, int reg) const {
+        return formatScaled(buf, cap, reg, raw[reg]);
+    }
+
+    // Writes "YYYY-MM-DD HH:MM:SS" (local time) into buf
+    void formatTime(char* buf, size_t cap) const {
+        time_t t = (time_t)epoch;
+        struct tm* tm = localtime(&t);
+        snprintf(buf, cap, "%04d-%02d-%02d %02d:%02d:%02d",
+                 tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday,
+                 tm->tm_hour, tm->tm_min, tm->tm_sec);
+    }
+};
+
+static_assert(REGISTER_COUNT <= 16, "SnapshotRecord bitmasks hold 16 registers");
+
+// Enough for formatTime()
+static const size_t SNAPSHOT_TIME_CHARS = 20;
+
+#endif  // SNAPSHOT_RECORD_H
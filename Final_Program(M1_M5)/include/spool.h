@@ -0,0 +1,110 @@
+#ifndef SPOOL_H
+#define SPOOL_H
+
+#include <Arduino.h>
+#include <vector>
+
+// ================================================================
+// Flash store-and-forward spool (LittleFS)
+// - Upload packets (compressed + encrypted batches) that could not be
+//   sent are appended to segment files under SPOOL_DIR and drained
+//   oldest-first once the cloud is reachable again.
+// - Segments are append-only and deleted whole once drained or when
+//   the byte budget is exceeded (oldest first), so flash blocks are
+//   never rewritten in place. The index is rewritten only when a
+//   segment is sealed or deleted; the cursor once per drained batch.
+// - simulator/spool_tool.py reads the same layout from a directory.
+//
+// On-flash layout (all integers little-endian):
+//   SPOOL_DIR/XXXXXXXX.seg  segment, id in hex; records back to back:
+//       u16 magic 'SP' (0x5053)   u16 payload length
+//       u32 batch seq             (packet sequence number)
+//       u32 first epoch           u32 last epoch
+//       u16 flags (0)             u16 CRC-16/Modbus of bytes 0..17 + payload
+//       payload
+//   SPOOL_DIR/index          u32 magic 'SPIX', u16 version, u16 count,
+//                            then per sealed segment: u32 id, u32 bytes,
+//                            u32 first seq, u32 last seq,
+//                            u32 first epoch, u32 last epoch, u32 batches
+//   SPOOL_DIR/cursor         u32 segment id, u32 offset of the oldest
+//                            undelivered record, u16 CRC-16 of both
+// ================================================================
+
+#ifndef SPOOL_BUDGET_BYTES
+#define SPOOL_BUDGET_BYTES (128UL * 1024UL)   // flash spent on the spool at most
+#endif
+
+#ifndef SPOOL_SEGMENT_BYTES
+#define SPOOL_SEGMENT_BYTES (16UL * 1024UL)   // rotate to a new file beyond this
+#endif
+
+#ifndef SPOOL_DRAIN_BATCHES_PER_CYCLE
+#define SPOOL_DRAIN_BATCHES_PER_CYCLE 4      // backlog uploads per upload cycle
+#endif
+
+namespace Spool {
+
+    static const char* const SPOOL_DIR = "/spool";
+    static const uint16_t RECORD_MAGIC = 0x5053;       // "SP"
+    static const uint32_t INDEX_MAGIC = 0x58495053;    // "SPIX"
+    static const uint16_t INDEX_VERSION = 1;
+    static const size_t RECORD_HEADER_BYTES = 20;
+    static const size_t MAX_SEGMENTS = 32;
+
+    // One spooled batch
+    struct BatchInfo {
+        uint32_t seq;
+        uint32_t firstEpoch;
+        uint32_t lastEpoch;
+        uint16_t length;
+    };
+
+    // Per-segment summary kept in RAM and in the index file
+    struct SegmentInfo {
+        uint32_t id;
+        uint32_t bytes;
+        uint32_t firstSeq;
+        uint32_t lastSeq;
+        uint32_t firstEpoch;
+        uint32_t lastEpoch;
+        uint32_t batches;
+    };
+
+    // Mounts LittleFS and rebuilds the spool state (index, cursor, and a
+    // scan of the open segment, which also drops a torn last record)
+    bool begin();
+    bool isReady();
+
+    bool isEmpty();
+    uint32_t pendingBatches();
+    uint32_t pendingBytes();
+
+    // Highest batch sequence number ever spooled (0 = none)
+    uint32_t highestSeq();
+
+    // Appends one packet; its first four bytes are the sequence number
+    bool append(const std::vector<uint8_t>& packet, uint32_t firstEpoch, uint32_t lastEpoch);
+
+    // Reads the oldest undelivered batch without consuming it
+    bool peekOldest(std::vector<uint8_t>& packet, BatchInfo* info = nullptr);
+
+    // Marks the batch returned by peekOldest() as delivered
+    void commitOldest();
+
+    // Drops everything on flash
+    void clear();
+
+    struct Stats {
+        uint32_t appended;         // Batches written
+        uint32_t delivered;        // Batches committed after upload
+        uint32_t dropped;          // Undelivered batches lost to the budget
+        uint32_t corrupt;          // Records skipped on CRC/format errors
+        uint32_t rotations;        // Segments sealed
+        uint32_t bytesWritten;     // Flash bytes appended
+    };
+    const Stats& stats();
+    void printStats();
+
+}  // namespace Spool
+
+#endif  // SPOOL_H
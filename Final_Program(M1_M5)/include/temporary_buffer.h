@@ -3,24 +3,52 @@
 
 #include <Arduino.h>
 #include <vector>
-#include "timed_snapshot.h"   // our new structure
+#include "snapshot_record.h"
 
 using namespace std;
 
+// ================================================================
+// Per-cycle snapshot assembler
+// - open() starts one empty record per polled slave, stamped once with
+//   the cycle's time. Every read response is scattered into its slave's
+//   record in place, so a cycle of several frames (read ranges, writes)
+//   ends up as one merged row per slave instead of the last frame only.
+// - present = registers that arrived; failed = registers whose frame
+//   timed out or was answered with an exception.
+// - commit() closes the cycle: records where nothing arrived are
+//   dropped, the rest is what getAll() hands to Buffer::appendFromTemporary().
+// ================================================================
 namespace TemporaryBuffer {
 
-    // Global buffer storage for snapshots
-    extern vector<TimedSnapshot> buffer;
+    // Global buffer storage: one record per slave of the running cycle
+    extern vector<SnapshotRecord> buffer;
 
-    // Add a new snapshot (replace or append)
-    void update(const TimedSnapshot& newSnapshot);
+    // Opens an empty record for the slave (kept if already open)
+    void open(uint8_t slave, uint32_t epoch);
 
-    // Retrieve all stored snapshots
-    const vector<TimedSnapshot>& getAll();
+    // The slave's record of this cycle; opens one stamped now if it has none
+    SnapshotRecord& record(uint8_t slave);
+
+    // Marks registers [startAddr, startAddr + quantity) of the slave as failed
+    void markFailed(uint8_t slave, uint16_t startAddr, uint16_t quantity);
+
+    // Closes the cycle; returns the number of records kept
+    size_t commit();
+
+    // Retrieve all stored snapshots (one per slave after commit())
+    const vector<SnapshotRecord>& getAll();
 
     // Clear buffer
     void clear();
 
+    struct Stats {
+        uint32_t complete;      // Committed records without failed registers
+        uint32_t partial;       // Committed records with some ranges failed
+        uint32_t empty;         // Opened records where nothing arrived
+    };
+    const Stats& stats();
+    void printStats();
+
 }  // namespace TemporaryBuffer
 
 #endif
@@ -0,0 +1,75 @@
+#ifndef TRANSACTION_ENGINE_H
+#define TRANSACTION_ENGINE_H
+
+#include <Arduino.h>
+#include "frame_pool.h"
+#include "frame_queue.h"
+
+// ================================================================
+// Non-blocking Modbus frame transactions
+// - Each frame runs as a small state machine advanced from loop():
+//     QUEUED → SENDING → AWAITING → VALIDATING → DONE
+//                           ↘ BACKOFF (retry after deadline) ↗ / FAILED
+// - Up to MAX_IN_FLIGHT frames are on the wire at once, one keep-alive
+//   session each; writes act as barriers so later frames to the same
+//   slave never overtake an earlier write.
+// - A reply is accepted only with a valid CRC and the request's slave
+//   address and function code (exception bit aside); others are retried.
+// - With several slaves queued, each keeps at most one frame on the
+//   wire, so a slow inverter only ever ties up one slot.
+// - Requests and responses live in FramePool slots and the queue is a
+//   fixed array, so a transaction costs no heap allocation.
+// ================================================================
+namespace TransactionEngine {
+
+    // Called once per frame when it completes, runs out of attempts or
+    // is dropped because the queue is full (response is empty then); both
+    // slots are released right after
+    typedef void (*CompletionCallback)(const FramePool::Frame& request,
+                                       const FramePool::Frame& response, bool success);
+
+    static const uint8_t MAX_IN_FLIGHT = 2;
+    static const size_t MAX_QUEUED = FrameQueue::CAPACITY;
+
+    // A full queue must still leave room for the responses it is waiting on
+    static_assert(FramePool::SLOTS >= MAX_QUEUED + 2 * MAX_IN_FLIGHT,
+                  "FRAME_POOL_SLOTS too small for a full queue plus responses");
+
+    struct Config {
+        uint8_t inFlight;              // Concurrent frames (1..MAX_IN_FLIGHT)
+        uint8_t maxAttempts;           // Attempts per frame
+        unsigned long timeoutMs;       // Per-attempt response deadline
+        unsigned long backoffMs;       // First retry delay, doubled per attempt
+    };
+
+    void begin(CompletionCallback onComplete);
+    void configure(const Config& config);
+    const Config& getConfig();
+
+    // Queue frames (false / fewer when the queue is full). front = true
+    // puts them ahead of everything already queued, in their given order.
+    // The engine takes over the handles (frames is left empty) and
+    // releases the ones it cannot queue.
+    bool submit(FramePool::Handle frame, bool front = false);
+    size_t submitAll(FrameQueue& frames, bool front = false);
+
+    // Advance every transaction; call from loop()
+    void handle();
+
+    // True when nothing is queued or in flight
+    bool idle();
+    size_t pending();
+
+    struct Stats {
+        uint32_t submitted;        // Frames queued
+        uint32_t dropped;          // Frames refused, queue full
+        uint32_t retries;          // Attempts after the first
+        uint32_t failed;           // Frames that ran out of attempts
+        uint32_t mismatched;       // Responses from another slave or function
+    };
+    const Stats& stats();
+    void printStats();
+
+}  // namespace TransactionEngine
+
+#endif  // TRANSACTION_ENGINE_H
@@ -0,0 +1,28 @@
+#ifndef WRITE_PLANNER_H
+#define WRITE_PLANNER_H
+
+#include <Arduino.h>
+#include <vector>
+#include "request_sim.h"
+
+using namespace std;
+
+// One run of adjacent registers written together
+struct WriteRange {
+    uint16_t startAddr;    // First register address in the run
+    uint16_t count;        // Number of adjacent registers to write
+};
+
+namespace WritePlanner {
+
+    static const uint16_t FC16_MAX_REGS = 123;   // Modbus spec limit for one FC16 write
+
+    // Fold adjacent RequestSIM::write[] entries into runs of at most
+    // maxRegsPerFrame registers. Gaps are never bridged: a write cannot
+    // touch registers that were not requested. Requests for registers the
+    // register map marks read-only are dropped and break the run.
+    vector<WriteRange> plan(const RequestSIM& input, uint16_t maxRegsPerFrame = FC16_MAX_REGS);
+
+}  // namespace WritePlanner
+
+#endif  // WRITE_PLANNER_H
@@ -0,0 +1,133 @@
+"""
+Side-by-side benchmark of the two inverter transports on a Linux host.
+
+Sends the same FC03 read frames over
+  - HTTP/JSON: POST {"frame":"<hex>"} on one keep-alive connection
+  - Modbus-TCP: MBAP + PDU on one persistent socket
+and reports bytes on the wire and round-trip latency per transaction.
+Wire bytes are counted the way the firmware counts them: everything
+written to and read from the socket (HTTP headers included).
+
+Usage:
+    python modbus_tcp_standin.py --port 5020 --http-port 8080 &
+    python bench_transports.py --http-port 8080 --modbus-port 5020 -n 500
+"""
+
+import argparse
+import http.client
+import io
+import socket
+import statistics
+import struct
+import time
+
+from inverter_standin import with_crc
+
+MBAP = struct.Struct(">HHHB")
+
+
+def fc03(slave: int, start: int, qty: int) -> bytes:
+    return with_crc(bytes([slave, 0x03, start >> 8, start & 0xFF, qty >> 8, qty & 0xFF]))
+
+
+class CountingSocket:
+    """Wraps a socket and counts bytes in each direction."""
+
+    def __init__(self, sock):
+        self.sock = sock
+        self.out = 0
+        self.inp = 0
+
+    def sendall(self, data):
+        self.out += len(data)
+        return self.sock.sendall(data)
+
+    def recv(self, n):
+        data = self.sock.recv(n)
+        self.inp += len(data)
+        return data
+
+    def recv_into(self, buf, n=0):
+        got = self.sock.recv_into(buf, n)
+        self.inp += got
+        return got
+
+    def makefile(self, *args, **kwargs):
+        return io.BufferedReader(socket.SocketIO(self, "rb"))
+
+    def __getattr__(self, name):
+        return getattr(self.sock, name)
+
+
+def bench_http(host: str, port: int, frames, api_key: str):
+    conn = http.client.HTTPConnection(host, port)
+    conn.connect()
+    conn.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)  # as the firmware does
+    counter = CountingSocket(conn.sock)
+    conn.sock = counter
+
+    times = []
+    for frame in frames:
+        path = "/api/inverter/read" if frame[1] == 0x03 else "/api/inverter/write"
+        body = '{"frame":"%s"}' % frame.hex().upper()
+        t0 = time.perf_counter()
+        conn.request("POST", path, body, {"Content-Type": "application/json",
+                                          "Authorization": api_key,
+                                          "Connection": "keep-alive"})
+        resp = conn.getresponse()
+        resp.read()
+        times.append(time.perf_counter() - t0)
+    conn.close()
+    return counter.out, counter.inp, times
+
+
+def bench_modbus_tcp(host: str, port: int, frames):
+    sock = socket.create_connection((host, port))
+    sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    out = inp = 0
+    times = []
+    for tid, frame in enumerate(frames, start=1):
+        unit_pdu = frame[:-2]
+        req = MBAP.pack(tid & 0xFFFF, 0, len(unit_pdu), unit_pdu[0]) + unit_pdu[1:]
+        t0 = time.perf_counter()
+        sock.sendall(req)
+        out += len(req)
+        header = b""
+        while len(header) < MBAP.size:
+            header += sock.recv(MBAP.size - len(header))
+        _, _, length, _ = MBAP.unpack(header)
+        body = b""
+        while len(body) < length - 1:
+            body += sock.recv(length - 1 - len(body))
+        inp += len(header) + len(body)
+        times.append(time.perf_counter() - t0)
+    sock.close()
+    return out, inp, times
+
+
+def report(name: str, out: int, inp: int, times):
+    n = len(times)
+    print(f"  {name:<11} {out / n:7.1f} B out  {inp / n:7.1f} B in  "
+          f"{(out + inp) / n:7.1f} B/tx  "
+          f"median {statistics.median(times) * 1e3:6.3f} ms  "
+          f"p95 {sorted(times)[int(n * 0.95) - 1] * 1e3:6.3f} ms")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="HTTP/JSON vs Modbus-TCP transport benchmark")
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--http-port", type=int, default=8080)
+    parser.add_argument("--modbus-port", type=int, default=5020)
+    parser.add_argument("-n", type=int, default=200, help="transactions per transport")
+    parser.add_argument("--qty", type=int, default=10, help="registers per FC03 read")
+    parser.add_argument("--api-key", default="x" * 70, help="Authorization header (size matters)")
+    args = parser.parse_args()
+
+    frames = [fc03(0x11, 0, args.qty)] * args.n
+    print(f"{args.n} x FC03 read of {args.qty} registers")
+    report("HTTP/JSON", *bench_http(args.host, args.http_port, frames, args.api_key))
+    report("Modbus-TCP", *bench_modbus_tcp(args.host, args.modbus_port, frames))
+
+
+if __name__ == "__main__":
+    main()
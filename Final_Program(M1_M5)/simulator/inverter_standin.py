@@ -0,0 +1,224 @@
+"""
+Local stand-in for the inverter simulator API.
+
+Serves the same endpoints the firmware calls:
+
+    POST /api/inverter/read    {"frame": "<hex Modbus RTU request>"}
+    POST /api/inverter/write   {"frame": "<hex Modbus RTU request>"}
+
+and answers with {"frame": "<hex Modbus RTU response>"}. Connections are
+HTTP/1.1 keep-alive, and the server counts TCP connections vs. requests
+so session reuse can be checked from the log.
+
+Supported function codes: 0x03, 0x06, 0x10 (disable 0x10 with --no-fc16
+to exercise the FC06 fallback).
+
+Several inverters can share the bus (--slaves 1,2,3), each with its own
+registers; frames to other addresses get no answer, like on RS-485.
+--slow 2:800 delays every answer of slave 2 by 800 ms.
+
+Usage:
+    python inverter_standin.py --port 8080 --slaves 1,2 --slow 2:800
+    # then build the firmware with
+    #   -D INVERTER_API_BASE_URL=\"http://<host-ip>:8080\"
+"""
+
+import argparse
+import json
+import random
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+REGISTER_COUNT = 10
+
+# Plausible raw values for R0..R9 (scaled like register_map.h)
+DEFAULT_REGISTERS = [2300, 52, 5000, 3600, 3550, 48, 47, 385, 100, 1200]
+
+
+def modbus_crc(data: bytes) -> int:
+    """Modbus RTU CRC16 (poly 0xA001, init 0xFFFF)."""
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0xA001 if crc & 1 else crc >> 1
+    return crc
+
+
+def with_crc(body: bytes) -> bytes:
+    crc = modbus_crc(body)
+    return body + bytes([crc & 0xFF, (crc >> 8) & 0xFF])
+
+
+def exception_frame(slave: int, func: int, code: int) -> bytes:
+    return with_crc(bytes([slave, func | 0x80, code]))
+
+
+class RegisterBank:
+    """Holding registers of one simulated inverter."""
+
+    def __init__(self, count: int = REGISTER_COUNT):
+        self.values = (DEFAULT_REGISTERS + [0] * count)[:count]
+        self.lock = threading.Lock()
+
+    def jitter(self) -> None:
+        """Small random walk so consecutive polls differ."""
+        with self.lock:
+            for i in (0, 1, 2, 9):
+                self.values[i] = max(0, self.values[i] + random.randint(-3, 3))
+
+    def read(self, start: int, qty: int):
+        with self.lock:
+            if qty < 1 or start + qty > len(self.values):
+                return None
+            return self.values[start:start + qty]
+
+    def write(self, start: int, values) -> bool:
+        with self.lock:
+            if start + len(values) > len(self.values):
+                return False
+            self.values[start:start + len(values)] = values
+            return True
+
+
+def handle_rtu(req: bytes, bank: RegisterBank, allow_fc16: bool = True) -> bytes:
+    """Answer one Modbus RTU request frame (CRC included)."""
+    if len(req) < 4 or modbus_crc(req[:-2]) != (req[-2] | (req[-1] << 8)):
+        return b""  # real devices stay silent on CRC errors
+    slave, func = req[0], req[1]
+
+    if func == 0x03 and len(req) == 8:
+        start = (req[2] << 8) | req[3]
+        qty = (req[4] << 8) | req[5]
+        values = bank.read(start, qty)
+        if values is None:
+            return exception_frame(slave, func, 0x02)
+        body = bytearray([slave, func, qty * 2])
+        for v in values:
+            body += bytes([(v >> 8) & 0xFF, v & 0xFF])
+        return with_crc(bytes(body))
+
+    if func == 0x06 and len(req) == 8:
+        addr = (req[2] << 8) | req[3]
+        value = (req[4] << 8) | req[5]
+        if not bank.write(addr, [value]):
+            return exception_frame(slave, func, 0x02)
+        return req  # echo
+
+    if func == 0x10 and allow_fc16 and len(req) >= 11:
+        start = (req[2] << 8) | req[3]
+        qty = (req[4] << 8) | req[5]
+        count = req[6]
+        if count != qty * 2 or len(req) != 9 + count:
+            return exception_frame(slave, func, 0x03)
+        values = [(req[7 + i * 2] << 8) | req[8 + i * 2] for i in range(qty)]
+        if not bank.write(start, values):
+            return exception_frame(slave, func, 0x02)
+        return with_crc(req[:6])
+
+    return exception_frame(slave, func, 0x01)
+
+
+class SlaveBus:
+    """Inverters sharing one bus, by Modbus address; others stay silent."""
+
+    def __init__(self, addresses=(1,), slow=None):
+        self.banks = {address: RegisterBank() for address in addresses}
+        self.slow = dict(slow or {})   # address -> extra ms per answer
+
+    def respond(self, req: bytes, allow_fc16: bool = True) -> bytes:
+        bank = self.banks.get(req[0]) if req else None
+        if bank is None:
+            return b""
+        delay = self.slow.get(req[0], 0)
+        if delay:
+            time.sleep(delay / 1000.0)
+        bank.jitter()
+        return handle_rtu(req, bank, allow_fc16)
+
+
+def parse_slow(specs):
+    """["2:800", ...] -> {2: 800}"""
+    slow = {}
+    for spec in specs:
+        address, ms = spec.split(":")
+        slow[int(address)] = int(ms)
+    return slow
+
+
+class Stats:
+    def __init__(self):
+        self.connections = 0
+        self.requests = 0
+        self.lock = threading.Lock()
+
+
+def make_handler(bus: SlaveBus, stats: Stats, allow_fc16: bool, latency_ms: int):
+    class Handler(BaseHTTPRequestHandler):
+        protocol_version = "HTTP/1.1"  # keep-alive by default
+        disable_nagle_algorithm = True  # headers and body are written separately
+
+        def setup(self):
+            super().setup()
+            with stats.lock:
+                stats.connections += 1
+
+        def do_POST(self):
+            if self.path not in ("/api/inverter/read", "/api/inverter/write"):
+                self.send_error(404)
+                return
+            length = int(self.headers.get("Content-Length", 0))
+            try:
+                payload = json.loads(self.rfile.read(length) or b"{}")
+                req = bytes.fromhex(payload.get("frame", ""))
+            except ValueError:
+                self.send_error(400, "invalid frame")
+                return
+
+            if latency_ms:
+                time.sleep(latency_ms / 1000.0)
+            resp = bus.respond(req, allow_fc16)
+
+            body = json.dumps({"frame": resp.hex().upper()}, separators=(",", ":")).encode()
+            self.send_response(200)
+            self.send_header("Content-Type", "application/json")
+            self.send_header("Content-Length", str(len(body)))
+            self.end_headers()
+            self.wfile.write(body)
+
+            with stats.lock:
+                stats.requests += 1
+                print(f"[standin] {self.path} {req.hex().upper()} -> {resp.hex().upper()} "
+                      f"(requests={stats.requests}, connections={stats.connections})")
+
+        def log_message(self, fmt, *args):
+            pass
+
+    return Handler
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Inverter simulator API stand-in")
+    parser.add_argument("--host", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--no-fc16", action="store_true", help="reject Write Multiple (0x10)")
+    parser.add_argument("--latency-ms", type=int, default=0, help="extra delay per request")
+    parser.add_argument("--slaves", default="1", help="Modbus addresses on the bus, e.g. 1,2,3")
+    parser.add_argument("--slow", action="append", default=[], metavar="ADDR:MS",
+                        help="extra delay for one slave's answers (repeatable)")
+    args = parser.parse_args()
+
+    bus = SlaveBus([int(a) for a in args.slaves.split(",")], parse_slow(args.slow))
+    stats = Stats()
+    server = ThreadingHTTPServer((args.host, args.port),
+                                 make_handler(bus, stats, not args.no_fc16, args.latency_ms))
+    print(f"[standin] Listening on http://{args.host}:{args.port} (slaves {args.slaves})")
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,123 @@
+"""
+Local Modbus-TCP stand-in for the inverter gateway.
+
+Speaks Modbus-TCP on a plain TCP socket: every request is an MBAP header
+(transaction id, protocol 0, length, unit id) followed by the PDU, and
+the reply echoes the transaction id. Requests are answered by the same
+register model as inverter_standin.py, so both transports see the same
+devices; the unit id picks the inverter (--slaves, --slow as there).
+Connections stay open; the log counts requests vs. connections.
+
+With --http-port the HTTP/JSON stand-in is started as well, sharing the
+register bank, so the firmware (or bench_transports.py) can compare both
+transports against one device.
+
+Usage:
+    python modbus_tcp_standin.py --port 5020 --http-port 8080
+    # then build the firmware with
+    #   -D INVERTER_TRANSPORT=1
+    #   -D INVERTER_MODBUS_TCP_HOST=\"<host-ip>\" -D INVERTER_MODBUS_TCP_PORT=5020
+"""
+
+import argparse
+import socketserver
+import struct
+import threading
+import time
+from http.server import ThreadingHTTPServer
+
+from inverter_standin import SlaveBus, Stats, make_handler, parse_slow, with_crc
+
+MBAP = struct.Struct(">HHHB")   # transaction id, protocol id, length, unit id
+
+
+def recv_exact(sock, n: int) -> bytes:
+    data = b""
+    while len(data) < n:
+        chunk = sock.recv(n - len(data))
+        if not chunk:
+            return b""
+        data += chunk
+    return data
+
+
+def handle_mbap(request: bytes, bus: SlaveBus, allow_fc16: bool) -> bytes:
+    """Answer one MBAP request (header + PDU) via the RTU handler."""
+    tid, proto, length, unit = MBAP.unpack(request[:MBAP.size])
+    pdu = request[MBAP.size:]
+    rtu = bus.respond(with_crc(bytes([unit]) + pdu), allow_fc16)
+    if not rtu:
+        return b""
+    body = rtu[1:-2]  # drop unit id and CRC
+    return MBAP.pack(tid, proto, len(body) + 1, unit) + body
+
+
+def make_tcp_handler(bus: SlaveBus, stats: Stats, allow_fc16: bool, latency_ms: int):
+    class Handler(socketserver.BaseRequestHandler):
+        def handle(self):
+            with stats.lock:
+                stats.connections += 1
+            sock = self.request
+            while True:
+                header = recv_exact(sock, MBAP.size)
+                if not header:
+                    return
+                tid, proto, length, unit = MBAP.unpack(header)
+                if proto != 0 or length < 2:
+                    return  # not Modbus: drop the connection
+                pdu = recv_exact(sock, length - 1)
+                if not pdu and length > 1:
+                    return
+
+                if latency_ms:
+                    time.sleep(latency_ms / 1000.0)
+                reply = handle_mbap(header + pdu, bus, allow_fc16)
+                if reply:
+                    sock.sendall(reply)
+
+                with stats.lock:
+                    stats.requests += 1
+                    print(f"[modbus-tcp] tid={tid} {pdu.hex().upper()} -> {reply[MBAP.size:].hex().upper()} "
+                          f"(requests={stats.requests}, connections={stats.connections})")
+
+    return Handler
+
+
+class ThreadingTCPServer(socketserver.ThreadingMixIn, socketserver.TCPServer):
+    allow_reuse_address = True
+    daemon_threads = True
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Modbus-TCP inverter stand-in")
+    parser.add_argument("--host", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=5020)
+    parser.add_argument("--http-port", type=int, default=0,
+                        help="also serve the HTTP/JSON API on this port (same registers)")
+    parser.add_argument("--no-fc16", action="store_true", help="reject Write Multiple (0x10)")
+    parser.add_argument("--latency-ms", type=int, default=0, help="extra delay per request")
+    parser.add_argument("--slaves", default="1", help="Modbus addresses on the bus, e.g. 1,2,3")
+    parser.add_argument("--slow", action="append", default=[], metavar="ADDR:MS",
+                        help="extra delay for one slave's answers (repeatable)")
+    args = parser.parse_args()
+
+    bus = SlaveBus([int(a) for a in args.slaves.split(",")], parse_slow(args.slow))
+    allow_fc16 = not args.no_fc16
+
+    if args.http_port:
+        http = ThreadingHTTPServer((args.host, args.http_port),
+                                   make_handler(bus, Stats(), allow_fc16, args.latency_ms))
+        threading.Thread(target=http.serve_forever, daemon=True).start()
+        print(f"[standin] Listening on http://{args.host}:{args.http_port}")
+
+    server = ThreadingTCPServer((args.host, args.port),
+                                make_tcp_handler(bus, Stats(), allow_fc16, args.latency_ms))
+    print(f"[modbus-tcp] Listening on {args.host}:{args.port}")
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,244 @@
+"""
+Host reader for the firmware's flash upload spool (include/spool.h).
+
+Works on a directory holding the spool files, e.g. a LittleFS image
+unpacked with `mklittlefs -u`, or a directory written by a host build:
+
+    <dir>/XXXXXXXX.seg   segments of spooled upload packets
+    <dir>/index          summary of sealed segments
+    <dir>/cursor         oldest undelivered record
+
+Usage:
+    python spool_tool.py list    <dir>            # segments, index, cursor
+    python spool_tool.py dump    <dir>            # one line per batch
+    python spool_tool.py verify  <dir>            # exit 1 on any bad record
+    python spool_tool.py extract <dir> SEQ -o packet.bin
+    python spool_tool.py replay  <dir> --url http://host:5000/data [--all]
+
+`replay` POSTs the undelivered packets oldest-first, exactly as the
+firmware would drain them.
+"""
+
+import argparse
+import os
+import struct
+import sys
+import urllib.error
+import urllib.request
+from datetime import datetime, timezone
+
+from inverter_standin import modbus_crc
+
+RECORD_MAGIC = 0x5053      # "SP"
+INDEX_MAGIC = 0x58495053   # "SPIX"
+INDEX_VERSION = 1
+HEADER = struct.Struct("<HHIIIHH")     # magic, len, seq, first, last, flags, crc
+INDEX_HEAD = struct.Struct("<IHH")     # magic, version, count
+INDEX_ENTRY = struct.Struct("<IIIIIII")  # id, bytes, first/last seq, first/last epoch, batches
+CURSOR = struct.Struct("<IIH")         # segment id, offset, crc
+
+
+class Record:
+    def __init__(self, segment, offset, seq, first_epoch, last_epoch, payload, ok):
+        self.segment = segment
+        self.offset = offset
+        self.seq = seq
+        self.first_epoch = first_epoch
+        self.last_epoch = last_epoch
+        self.payload = payload
+        self.ok = ok
+
+
+def read_segment(path: str, seg_id: int):
+    """Yields the records of one segment; stops at a torn or corrupt header."""
+    with open(path, "rb") as f:
+        data = f.read()
+    pos = 0
+    while pos + HEADER.size <= len(data):
+        magic, length, seq, first, last, _flags, crc = HEADER.unpack_from(data, pos)
+        if magic != RECORD_MAGIC or length == 0 or pos + HEADER.size + length > len(data):
+            break
+        payload = data[pos + HEADER.size:pos + HEADER.size + length]
+        ok = modbus_crc(data[pos:pos + HEADER.size - 2] + payload) == crc
+        yield Record(seg_id, pos, seq, first, last, payload, ok)
+        pos += HEADER.size + length
+    if pos < len(data):
+        yield Record(seg_id, pos, None, 0, 0, b"", False)   # trailing garbage
+
+
+def segment_ids(spool_dir: str):
+    ids = []
+    for name in os.listdir(spool_dir):
+        if name.endswith(".seg"):
+            try:
+                ids.append(int(name[:-4], 16))
+            except ValueError:
+                pass
+    return sorted(ids)
+
+
+def segment_path(spool_dir: str, seg_id: int) -> str:
+    return os.path.join(spool_dir, "%08X.seg" % seg_id)
+
+
+def read_index(spool_dir: str):
+    path = os.path.join(spool_dir, "index")
+    if not os.path.exists(path):
+        return None
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) < INDEX_HEAD.size:
+        return None
+    magic, version, count = INDEX_HEAD.unpack_from(data, 0)
+    if magic != INDEX_MAGIC or version != INDEX_VERSION:
+        return None
+    entries = []
+    for i in range(count):
+        off = INDEX_HEAD.size + i * INDEX_ENTRY.size
+        if off + INDEX_ENTRY.size > len(data):
+            break
+        entries.append(dict(zip(
+            ("id", "bytes", "first_seq", "last_seq", "first_epoch", "last_epoch", "batches"),
+            INDEX_ENTRY.unpack_from(data, off))))
+    return entries
+
+
+def read_cursor(spool_dir: str):
+    path = os.path.join(spool_dir, "cursor")
+    if not os.path.exists(path):
+        return None
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) != CURSOR.size:
+        return None
+    seg_id, offset, crc = CURSOR.unpack(data)
+    if modbus_crc(data[:8]) != crc:
+        return None
+    return seg_id, offset
+
+
+def all_records(spool_dir: str):
+    for seg_id in segment_ids(spool_dir):
+        yield from read_segment(segment_path(spool_dir, seg_id), seg_id)
+
+
+def pending_records(spool_dir: str):
+    """Undelivered records, applying the cursor the way Spool::begin() does."""
+    ids = segment_ids(spool_dir)
+    cursor = read_cursor(spool_dir)
+    for seg_id in ids:
+        start = cursor[1] if cursor and seg_id == ids[0] and cursor[0] == seg_id else 0
+        for rec in read_segment(segment_path(spool_dir, seg_id), seg_id):
+            if rec.offset >= start and rec.ok:
+                yield rec
+
+
+def fmt_time(epoch: int) -> str:
+    return datetime.fromtimestamp(epoch, timezone.utc).strftime("%Y-%m-%d %H:%M:%S") if epoch else "-"
+
+
+def cmd_list(args):
+    ids = segment_ids(args.dir)
+    index = {e["id"]: e for e in (read_index(args.dir) or [])}
+    cursor = read_cursor(args.dir)
+    print(f"{len(ids)} segment(s), cursor: "
+          + (f"segment {cursor[0]:08X} @ {cursor[1]}" if cursor else "none (start of oldest)"))
+    for seg_id in ids:
+        recs = [r for r in read_segment(segment_path(args.dir, seg_id), seg_id) if r.seq is not None]
+        size = os.path.getsize(segment_path(args.dir, seg_id))
+        state = "sealed" if seg_id in index else "open"
+        if recs:
+            print(f"  {seg_id:08X}  {size:6d} B  {len(recs):4d} batch(es)  "
+                  f"seq {recs[0].seq}..{recs[-1].seq}  "
+                  f"{fmt_time(recs[0].first_epoch)} .. {fmt_time(recs[-1].last_epoch)}  {state}")
+        else:
+            print(f"  {seg_id:08X}  {size:6d} B  empty  {state}")
+        if seg_id in index and index[seg_id]["bytes"] != size:
+            print(f"    index says {index[seg_id]['bytes']} B (rescanned on boot)")
+    pending = list(pending_records(args.dir))
+    print(f"pending: {len(pending)} batch(es), {sum(len(r.payload) for r in pending)} B payload")
+    return 0
+
+
+def cmd_dump(args):
+    for rec in all_records(args.dir):
+        if rec.seq is None:
+            print(f"  {rec.segment:08X}+{rec.offset}: trailing bytes (torn write)")
+            continue
+        print(f"  {rec.segment:08X}+{rec.offset:<6d} seq {rec.seq:<8d} {len(rec.payload):5d} B  "
+              f"{fmt_time(rec.first_epoch)} .. {fmt_time(rec.last_epoch)}  "
+              f"{'ok' if rec.ok else 'CRC ERROR'}")
+    return 0
+
+
+def cmd_verify(args):
+    bad = 0
+    count = 0
+    last_seq = None
+    for rec in all_records(args.dir):
+        count += 1
+        if not rec.ok:
+            bad += 1
+            print(f"  bad record in {rec.segment:08X} at {rec.offset}")
+        elif last_seq is not None and rec.seq <= last_seq:
+            bad += 1
+            print(f"  seq {rec.seq} after {last_seq} in {rec.segment:08X} (out of order)")
+        if rec.ok:
+            last_seq = rec.seq
+    print(f"{count} record(s), {bad} problem(s)")
+    return 1 if bad else 0
+
+
+def cmd_extract(args):
+    for rec in all_records(args.dir):
+        if rec.ok and rec.seq == args.seq:
+            with open(args.output, "wb") as f:
+                f.write(rec.payload)
+            print(f"seq {rec.seq}: {len(rec.payload)} B → {args.output}")
+            return 0
+    print(f"seq {args.seq} not found", file=sys.stderr)
+    return 1
+
+
+def cmd_replay(args):
+    records = all_records(args.dir) if args.all else pending_records(args.dir)
+    sent = 0
+    for rec in records:
+        if not rec.ok:
+            continue
+        req = urllib.request.Request(args.url, data=rec.payload, method="POST",
+                                     headers={"Content-Type": "application/octet-stream"})
+        try:
+            with urllib.request.urlopen(req, timeout=10) as resp:
+                status = resp.status
+        except urllib.error.HTTPError as e:
+            status = e.code
+        print(f"  seq {rec.seq}: HTTP {status}")
+        sent += 1
+    print(f"{sent} packet(s) replayed")
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Inspect or replay a firmware upload spool")
+    sub = parser.add_subparsers(dest="cmd", required=True)
+    for name in ("list", "dump", "verify"):
+        p = sub.add_parser(name)
+        p.add_argument("dir")
+    p = sub.add_parser("extract")
+    p.add_argument("dir")
+    p.add_argument("seq", type=int)
+    p.add_argument("-o", "--output", required=True)
+    p = sub.add_parser("replay")
+    p.add_argument("dir")
+    p.add_argument("--url", required=True)
+    p.add_argument("--all", action="store_true", help="ignore the cursor, send every record")
+    args = parser.parse_args()
+
+    handlers = {"list": cmd_list, "dump": cmd_dump, "verify": cmd_verify,
+                "extract": cmd_extract, "replay": cmd_replay}
+    sys.exit(handlers[args.cmd](args))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,177 @@
+"""
+Multi-slave polling against a local stand-in bus.
+
+Starts inverter_standin.py with three inverters (slave 2 slow) on a free
+port and polls them the way the firmware does:
+  - frames interleaved round-robin by slave (ProtocolAdapter::interleaveBySlave)
+  - MAX_IN_FLIGHT keep-alive sessions, and a slave keeps at most one frame
+    on the wire while another slave's frame waits (TransactionEngine)
+A slave that is not on the bus (address 9) gets no answer. The fast slaves
+must finish long before the slow one, and the polled rows travel to the
+cloud decoder as v6 payloads tagged with their device, each delta coded
+against that device's own previous batch.
+
+Usage:
+    python test_multi_slave.py
+"""
+
+import http.client
+import importlib.util
+import json
+import os
+import threading
+import time
+from collections import deque
+from concurrent.futures import FIRST_COMPLETED, ThreadPoolExecutor, wait
+from http.server import ThreadingHTTPServer
+
+from inverter_standin import REGISTER_COUNT, SlaveBus, Stats, make_handler, modbus_crc, with_crc
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+MAX_IN_FLIGHT = 2
+SLOW_MS = 300
+CYCLES = 3
+
+# The cloud decoder, without importing the Flask app around it
+_spec = importlib.util.spec_from_file_location(
+    "compressor", os.path.join(HERE, "..", "cloud", "app", "utils", "compressor.py"))
+compressor = importlib.util.module_from_spec(_spec)
+_spec.loader.exec_module(compressor)
+
+
+def fc03(slave: int, start: int, qty: int) -> bytes:
+    return with_crc(bytes([slave, 0x03, start >> 8, start & 0xFF, qty >> 8, qty & 0xFF]))
+
+
+def interleave_by_slave(frames):
+    """Python port of ProtocolAdapter::interleaveBySlave."""
+    queues = {}
+    for frame in frames:
+        queues.setdefault(frame[0] if frame else 0, deque()).append(frame)
+    out = []
+    while any(queues.values()):
+        for q in queues.values():
+            if q:
+                out.append(q.popleft())
+    return out
+
+
+class Session:
+    """One keep-alive connection, like an InverterTransport slot."""
+
+    def __init__(self, port: int):
+        self.conn = http.client.HTTPConnection("127.0.0.1", port, timeout=5)
+
+    def transact(self, frame: bytes) -> bytes:
+        body = json.dumps({"frame": frame.hex().upper()})
+        self.conn.request("POST", "/api/inverter/read", body, {"Content-Type": "application/json"})
+        return bytes.fromhex(json.loads(self.conn.getresponse().read())["frame"])
+
+
+def run_cycle(port: int, frames):
+    """Runs one polling cycle; returns {frame: (response, done_at)} and the
+    most frames one slave had on the wire while another slave waited."""
+    queue = list(interleave_by_slave(frames))
+    sessions = [Session(port) for _ in range(MAX_IN_FLIGHT)]
+    free = list(range(MAX_IN_FLIGHT))
+    in_flight = {}   # future -> (slot, frame)
+    results = {}
+    peak_while_waiting = 0
+    start = time.monotonic()
+
+    def holds_slot(frame):
+        on_wire = any(f[0] == frame[0] for _, f in in_flight.values())
+        other_waiting = any(f[0] != frame[0] for f in queue)
+        return on_wire and other_waiting
+
+    with ThreadPoolExecutor(MAX_IN_FLIGHT) as pool:
+        while queue or in_flight:
+            for frame in list(queue):
+                if not free:
+                    break
+                if holds_slot(frame):
+                    continue
+                queue.remove(frame)
+                slot = free.pop()
+                in_flight[pool.submit(sessions[slot].transact, frame)] = (slot, frame)
+                if any(f[0] != frame[0] for f in queue):
+                    on_wire = sum(f[0] == frame[0] for _, f in in_flight.values())
+                    peak_while_waiting = max(peak_while_waiting, on_wire)
+
+            done, _ = wait(list(in_flight), return_when=FIRST_COMPLETED)
+            for future in done:
+                slot, frame = in_flight.pop(future)
+                free.append(slot)
+                results[frame] = (future.result(), time.monotonic() - start)
+    return results, peak_while_waiting
+
+
+def decode_rows(response: bytes):
+    assert len(response) >= 5 and modbus_crc(response[:-2]) == (response[-2] | (response[-1] << 8))
+    return [(response[3 + 2 * i] << 8) | response[4 + 2 * i] for i in range(response[2] // 2)]
+
+
+def test_round_robin(port: int):
+    """Fast slaves are not held up by the slow one, the missing one stays silent"""
+    slaves = (1, 2, 3, 9)
+    rows = {s: [] for s in slaves if s != 9}
+    fast_done = slow_done = 0.0
+    for cycle in range(CYCLES):
+        # Two read ranges per slave, queued slave by slave like decodeRequestStruct
+        frames = [fc03(s, start, 5) for s in slaves for start in (0, 5)]
+        results, peak = run_cycle(port, frames)
+        assert len(results) == len(frames)
+        assert peak == 1, f"a slave held {peak} slots while others waited"
+
+        for s in rows:
+            row = []
+            for start in (0, 5):
+                response, done_at = results[fc03(s, start, 5)]
+                assert response[0] == s, f"answer from slave {response[0]} to slave {s}"
+                row += decode_rows(response)
+                if s == 2:
+                    slow_done = max(slow_done, done_at)
+                else:
+                    fast_done = max(fast_done, done_at)
+            rows[s].append(row)
+        assert all(not results[fc03(9, start, 5)][0] for start in (0, 5)), "slave 9 must stay silent"
+
+    # The slow slave needs at least SLOW_MS per cycle; everyone else is done early
+    assert fast_done < slow_done / 2, f"fast slaves done at {fast_done:.3f}s, slow at {slow_done:.3f}s"
+    print(f"✓ Round robin: slaves 1/3 done in {fast_done * 1000:.0f} ms, "
+          f"slow slave 2 in {slow_done * 1000:.0f} ms, slave 9 silent")
+    return rows
+
+
+def test_device_payloads(rows):
+    """Each device's rows arrive tagged with it, referenced against its own batch"""
+    compressor.reset_reference()
+    held = {}
+    epoch = 1760900000
+    for batch in range(2):
+        for device, device_rows in rows.items():
+            values = [v for row in device_rows for v in row]
+            epochs = [epoch + 10 * (batch * CYCLES + f) for f in range(len(device_rows))]
+            payload = compressor.build_upload_payload(epochs, values, REGISTER_COUNT,
+                                                      reference=held.get(device), device=device)
+            snaps = compressor.process_compressed_data(payload, REGISTER_COUNT, 0)
+            assert len(snaps) == len(device_rows) and all(s["device"] == device for s in snaps)
+            expected = [compressor.scale_value(v, j) for j, v in enumerate(device_rows[-1])]
+            assert snaps[-1]["registers"] == expected
+            held[device] = (epochs[-1], values[-REGISTER_COUNT:])
+    compressor.reset_reference()
+    print(f"✓ Device payloads: {len(rows)} inverters, referenced batches decoded per device")
+    return True
+
+
+if __name__ == "__main__":
+    bus = SlaveBus((1, 2, 3), {2: SLOW_MS})
+    server = ThreadingHTTPServer(("127.0.0.1", 0), make_handler(bus, Stats(), True, 0))
+    server.daemon_threads = True
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    try:
+        rows = test_round_robin(server.server_address[1])
+        test_device_payloads(rows)
+        print("✓ All tests PASSED!")
+    finally:
+        server.shutdown()
@@ -3,72 +3,389 @@
 #include "debug_utils.h"
 #include "inverter_comm.h"
 #include "request_config.h"
+#include "deadband.h"
+#include "compression.h"
+#include "modbus_utils.h"
+#include "slave_registry.h"
+#include <math.h>
 
 
+namespace {
+    using Buffer::Block;
+    using Buffer::MAX_BLOCKS;
+
+    Block ring[MAX_BLOCKS];
+    size_t head = 0;            // slot of the oldest block
+    size_t stored = 0;          // blocks in the ring, open blocks included
+    uint32_t headSeq = 0;       // sequence number of ring[head]
+    bool bufferOverflow = false;
+    uint32_t evicted = 0;
+
+    // One open block per slave, each with its own encoders (their previous
+    // row is the only delta base kept). Blocks of different slaves sit in
+    // the ring in the order they were started.
+    struct Stream {
+        bool open;
+        uint32_t seq;                            // sequence number of its open block
+        Compression::TimeSeriesEncoder encoder;
+        Compression::EpochEncoder epochs;
+
+        // A held cell is only sent as held once its column has a value in
+        // the block, so every block decodes on its own
+        bool columnSent[REGISTER_COUNT];
+    };
+    Stream streams[SlaveRegistry::MAX_SLAVES];
+
+    inline size_t slot(size_t i) {
+        size_t s = head + i;
+        return s >= MAX_BLOCKS ? s - MAX_BLOCKS : s;
+    }
+
+    Block& blockAt(uint32_t seq) { return ring[slot(seq - headSeq)]; }
+
+    bool isOpen(uint32_t seq) {
+        for (const auto& st : streams) {
+            if (st.open && st.seq == seq) return true;
+        }
+        return false;
+    }
+
+    void dropOldest(size_t n) {
+        // An open block dropped with the oldest ones ends its stream
+        for (auto& st : streams) {
+            if (st.open && st.seq - headSeq < n) st.open = false;
+        }
+        head = slot(n);
+        stored -= n;
+        headSeq += n;
+    }
+
+    // Closes an open block; its register stream is repacked with
+    // run-length columns when that is smaller
+    void sealStream(Stream& st) {
+        Block& b = blockAt(st.seq);
+        if (b.rows > 1) b.length = (uint16_t)Compression::TimeSeriesCompressor::repack(b.data, b.length);
+        st.open = false;
+    }
+
+    // Stream of `slave`: its open one, else a free one. With more slaves
+    // than streams the one with the oldest open block is sealed and reused.
+    Stream& streamFor(uint8_t slave) {
+        Stream* spare = nullptr;
+        for (auto& st : streams) {
+            if (st.open && blockAt(st.seq).slave == slave) return st;
+            if (!st.open && !spare) spare = &st;
+        }
+        if (spare) return *spare;
+
+        Stream* oldest = &streams[0];
+        for (auto& st : streams) {
+            if (st.seq - headSeq < oldest->seq - headSeq) oldest = &st;
+        }
+        sealStream(*oldest);
+        return *oldest;
+    }
+
+    void startBlock(Stream& st, uint8_t slave) {
+        if (stored >= MAX_BLOCKS) {
+            bufferOverflow = true;     // mark overflow
+            evicted += ring[head].rows;
+            DEBUG_PRINTF("[Buffer] ⚠️ Full: overwriting block #%u (%u snapshots)\n",
+                         headSeq, ring[head].rows);
+            dropOldest(1);
+        }
+        st.seq = headSeq + stored;
+        Block& b = ring[slot(stored)];
+        stored++;
+        b.firstEpoch = b.lastEpoch = 0;
+        b.rows = 0;
+        b.length = 0;
+        b.timeLength = 0;
+        b.crc = Modbus::CRC_INIT;
+        b.slave = slave;
+        st.encoder.begin(b.data, Buffer::BLOCK_BYTES, Buffer::ROW_WORDS);
+        st.epochs.begin(b.data + Buffer::BLOCK_BYTES, Buffer::BLOCK_BYTES);
+        for (int i = 0; i < REGISTER_COUNT; i++) st.columnSent[i] = false;
+        st.open = true;
+    }
+
+    // Upload-stream row: raw register words (0xFFFF unread,
+    // Deadband::HELD_RAW held); the cloud applies the scale. A held cell
+    // at the start of a column carries the deadband's reported value, not
+    // the reading, since that is what the cloud keeps until the next report.
+    void buildRow(const SnapshotRecord& snap, bool* columnSent, uint16_t* row) {
+        for (int i = 0; i < REGISTER_COUNT; i++) {
+            if (!snap.has(i)) {
+                row[i] = 0xFFFF;
+            } else if (snap.isHeld(i) && columnSent[i]) {
+                row[i] = Deadband::HELD_RAW;
+            } else {
+                row[i] = snap.raw[i];
+                if (snap.isHeld(i)) Deadband::reported(snap.slave, i, row[i]);
+                columnSent[i] = true;
+            }
+        }
+    }
+
+    // Returns the block the row went into
+    Block& appendRow(const SnapshotRecord& snap) {
+        uint16_t row[Buffer::ROW_WORDS];
+        Stream& st = streamFor(snap.slave);
+        if (!st.open) startBlock(st, snap.slave);
+        buildRow(snap, st.columnSent, row);
+
+        // An open block always has room for a worst-case row (see below)
+        st.encoder.append(row);
+        st.epochs.append(snap.epoch);
+
+        Block& b = blockAt(st.seq);
+        if (b.rows == 0) b.firstEpoch = snap.epoch;
+        b.lastEpoch = snap.epoch;
+        b.rows++;
+        b.length = (uint16_t)st.encoder.size();
+        b.timeLength = (uint16_t)st.epochs.size();
+        b.crc = Buffer::rowCrc(b.crc, snap.epoch, row);
+        memcpy(b.lastRow, row, sizeof(b.lastRow));
+
+        // Seal now if a worst-case row would no longer fit
+        if (b.length + b.timeLength + st.encoder.maxRowBytes() +
+            Compression::EpochEncoder::MAX_VALUE_BYTES > Buffer::BLOCK_BYTES) {
+            sealStream(st);
+        }
+        return b;
+    }
+}
+
 namespace Buffer {
 
-    static std::vector<TimedSnapshot> mainBuffer;
-    static const size_t MAX_BUFFER_SIZE = 100;   // your limit
-    static bool bufferOverflow = false;          // flag
+    uint16_t rowCrc(uint16_t crc, uint32_t epoch, const uint16_t* row) {
+        uint8_t bytes[4 + ROW_WORDS * 2];
+        for (int k = 0; k < 4; k++) bytes[k] = (uint8_t)(epoch >> (8 * k));
+        for (int i = 0; i < ROW_WORDS; i++) {
+            bytes[4 + 2 * i] = (uint8_t)(row[i] & 0xFF);
+            bytes[5 + 2 * i] = (uint8_t)(row[i] >> 8);
+        }
+        return Modbus::crcUpdate(crc, bytes, sizeof(bytes));
+    }
 
     // --------------------------------------------------------------------
     // Append filtered snapshot(s) from TemporaryBuffer
     // --------------------------------------------------------------------
-    void appendFromTemporary(const RequestSIM& config) {
+    void appendFromTemporary(const RequestSIM& config, uint8_t slave) {
         const auto& tempData = TemporaryBuffer::getAll();
         if (tempData.empty()) {
             DEBUG_PRINTLN("[Buffer] ⚠️ Temporary buffer is empty, nothing to append.");
             return;
         }
 
-        // Process each snapshot stored in TemporaryBuffer
+        // Process each snapshot stored in TemporaryBuffer for this slave
         for (const auto& snapshot : tempData) {
+            if (snapshot.slave != slave) continue;
 
-        // --- Create filtered snapshot ---
-        TimedSnapshot filtered;
-        filtered.timestamp = snapshot.timestamp;
-        filtered.values.assign(NUM_REGISTERS, -1.0f);
-
-        for (size_t i = 0; i < snapshot.values.size() && i < NUM_REGISTERS; ++i) {
-            if (config.read[i]) {
-                filtered.values[i] = snapshot.values[i];
+            // --- Create filtered snapshot ---
+            SnapshotRecord filtered = snapshot;
+            for (int i = 0; i < NUM_REGISTERS; ++i) {
+                if (!config.read[i]) filtered.drop(i);
             }
-        }
 
-        // --- Enforce max buffer size ---
-        if (mainBuffer.size() >= MAX_BUFFER_SIZE) {
-            bufferOverflow = true;     // mark overflow
-            mainBuffer.erase(mainBuffer.begin());  // remove oldest
+            // --- Report-by-exception: keep only values that left their band ---
+            if (!Deadband::apply(filtered)) continue;
+
+            // --- Encode into the slave's open block ---
+#if DEBUG_ENABLED
+            const Block& b = appendRow(filtered);
+            DEBUG_PRINTF("[Buffer] Added slave %u snapshot @ %u → block (%u rows, %u B)\n",
+                         slave, filtered.epoch, b.rows, b.length + b.timeLength);
+#else
+            appendRow(filtered);
+#endif
         }
 
-        // --- Push newest snapshot ---
-        mainBuffer.push_back(filtered);
+        DEBUG_PRINTF("[Buffer] 📦 Main buffer now has %d snapshot(s) in %d block(s)\n",
+                     (int)size(), (int)stored);
+    }
 
-        DEBUG_PRINTF("[Buffer] Added snapshot @ %s (size=%d)\n",
-                    filtered.timestamp.c_str(), mainBuffer.size());
-        }
+    size_t size() {
+        size_t rows = 0;
+        for (size_t i = 0; i < stored; i++) rows += ring[slot(i)].rows;
+        return rows;
+    }
+
+    size_t blockCount() { return stored; }
+
+    bool isEmpty() { return stored == 0; }
 
+    void seal() {
+        for (auto& st : streams) {
+            if (!st.open) continue;
+            sealStream(st);
+#if DEBUG_ENABLED
+            const Block& b = blockAt(st.seq);
+            DEBUG_PRINTF("[Buffer] 🔒 Sealed block #%u of slave %u (%u rows, %u B)\n",
+                         st.seq, b.slave, b.rows, b.length + b.timeLength);
+#endif
+        }
+    }
 
-        DEBUG_PRINTF("[Buffer] 📦 Main buffer now has %d snapshot(s)\n",
-                     (int)mainBuffer.size());
+    const Block* get(uint32_t seq) {
+        uint32_t offset = seq - headSeq;   // wraps for evicted blocks
+        return offset < stored ? &ring[slot(offset)] : nullptr;
     }
 
+    uint32_t oldestSeq() { return headSeq; }
+
     // --------------------------------------------------------------------
-    // Retrieve all stored snapshots
+    // Batch access for the upload path
     // --------------------------------------------------------------------
-    const std::vector<TimedSnapshot>& getAll() {
-        return mainBuffer;
+    Batch peek(size_t maxCount) {
+        // Oldest blocks up to the first one still open
+        size_t sealed = 0;
+        while (sealed < stored && !isOpen(headSeq + sealed)) sealed++;
+        Batch batch = { headSeq, sealed < maxCount ? sealed : maxCount };
+        return batch;
+    }
+
+    size_t commit(const Batch& batch) {
+        // Blocks of the batch evicted during the upload are already gone
+        uint32_t end = batch.firstSeq + batch.count;
+        uint32_t done = end - headSeq;
+        if ((int32_t)done <= 0) return 0;
+        if (done > stored) done = stored;
+
+        dropOldest(done);
+        if (stored == 0) head = 0;
+        DEBUG_PRINTF("[Buffer] ✅ Committed %u block(s), %d left\n", done, (int)stored);
+        return done;
     }
 
     // --------------------------------------------------------------------
     // Clear main buffer
     // --------------------------------------------------------------------
     void clear() {
-        mainBuffer.clear();
+        headSeq += stored;
+        head = 0;
+        stored = 0;
+        for (auto& st : streams) st.open = false;
         DEBUG_PRINTLN("[Buffer] 🧹 Main buffer cleared.");
     }
     bool hasOverflowed() {
     return bufferOverflow;
     }
 
+    uint32_t evictedCount() { return evicted; }
+
+    // --------------------------------------------------------------------
+    // Memory used per snapshot, old layout vs compressed blocks
+    // --------------------------------------------------------------------
+    void printMemoryReport() {
+        size_t rows = size();
+        size_t bytes = 0;
+        for (size_t i = 0; i < stored; i++) bytes += ring[slot(i)].length + ring[slot(i)].timeLength;
+
+        Serial.printf("[Buffer] %u blocks x %u B in %u B (legacy: %u snapshots x ~%u B)\n",
+                      (unsigned)MAX_BLOCKS, (unsigned)BLOCK_BYTES, (unsigned)sizeof(ring),
+                      (unsigned)LEGACY_CAPACITY, (unsigned)LEGACY_SNAPSHOT_BYTES);
+        if (rows > 0) {
+            // Repacking shrinks payloads, not slots: capacity follows rows per block
+            float perRow = (float)bytes / rows;
+            Serial.printf("[Buffer] %u snapshots in %u B: %.1f B/snapshot → ~%u snapshots capacity\n",
+                          (unsigned)rows, (unsigned)bytes, perRow,
+                          (unsigned)(MAX_BLOCKS * rows / stored));
+        }
+    }
+
+    // --------------------------------------------------------------------
+    // CPU per sample on the acquisition path: frame decode, buffer append
+    // (row build, encoders, CRC), upload compression; plus the float
+    // scale/compare/cast work the raw pipeline no longer does
+    // --------------------------------------------------------------------
+    void printPipelineBenchmark(size_t samples) {
+        if (stored > 0) {
+            Serial.println("[Buffer] Pipeline benchmark skipped: buffer not empty");
+            return;
+        }
+
+        // FC03 responses for R0..R(n-1), values wandering around typical readings
+        vector<vector<uint8_t>> frames(samples);
+        for (size_t k = 0; k < samples; k++) {
+            vector<uint8_t>& f = frames[k];
+            f = { 0x11, 0x03, (uint8_t)(REGISTER_COUNT * 2) };
+            for (int i = 0; i < REGISTER_COUNT; i++) {
+                uint16_t v = (uint16_t)(registerMap[i].scale * (50 + 10 * i) + (k * 7 + i * 3) % 11);
+                f.push_back((uint8_t)(v >> 8));
+                f.push_back((uint8_t)(v & 0xFF));
+            }
+            uint16_t crc = Modbus::modbusCRC(f.data(), (int)f.size());
+            f.push_back((uint8_t)(crc & 0xFF));
+            f.push_back((uint8_t)(crc >> 8));
+        }
+
+        vector<SnapshotRecord> snaps(samples);
+        unsigned long t0 = micros();
+        for (size_t k = 0; k < samples; k++) {
+            snaps[k].clear();
+            InverterSim::decodeResponseFrame(frames[k].data(), frames[k].size(), 0, snaps[k]);
+        }
+        unsigned long t1 = micros();
+        for (size_t k = 0; k < samples; k++) {
+            snaps[k].epoch = 1760900000UL + 5 * k;
+            appendRow(snaps[k]);
+        }
+        seal();
+        unsigned long t2 = micros();
+
+        // What initiateCompression() does per sealed block
+        size_t payloadBytes = 0;
+        for (size_t b = 0; b < stored; b++) {
+            const Block& blk = ring[slot(b)];
+            vector<uint8_t> blob(blk.data, blk.data + blk.length);
+            auto values = Compression::TimeSeriesCompressor::decompress(blob, REGISTER_COUNT);
+            auto choice = Compression::selectCodec(values, REGISTER_COUNT);
+            payloadBytes += choice.codec->compress(values, REGISTER_COUNT, nullptr).size() + blk.timeLength;
+        }
+        unsigned long t3 = micros();
+        size_t blocks = stored;
+        clear();
+
+        // Removed per-sample work: scale to float, float band test, truncating cast
+        volatile uint16_t sink = 0;
+        float last[REGISTER_COUNT] = {};
+        for (size_t k = 0; k < samples; k++) {
+            for (int i = 0; i < REGISTER_COUNT; i++) {
+                float v = (float)snaps[k].raw[i] / registerMap[i].scale;
+                if (fabsf(v - last[i]) > 0.05f) last[i] = v;
+                sink = (uint16_t)v;
+            }
+        }
+        unsigned long t4 = micros();
+        uint16_t lastRaw[REGISTER_COUNT] = {};
+        for (size_t k = 0; k < samples; k++) {
+            for (int i = 0; i < REGISTER_COUNT; i++) {
+                uint16_t v = snaps[k].raw[i];
+                uint32_t d = v > lastRaw[i] ? v - lastRaw[i] : lastRaw[i] - v;
+                if (d * 256u > 1280u) lastRaw[i] = v;
+                sink = v;
+            }
+        }
+        unsigned long t5 = micros();
+        (void)sink;
+
+        struct Stage { const char* name; unsigned long us; };
+        const Stage stages[] = {
+            { "frame decode",        t1 - t0 },
+            { "buffer append",       t2 - t1 },
+            { "upload compress",     t3 - t2 },
+            { "float scale (old)",   t4 - t3 },
+            { "fixed-point (now)",   t5 - t4 },
+        };
+        uint32_t mhz = ESP.getCpuFreqMHz();
+        Serial.printf("[Buffer] Pipeline benchmark: %u samples x %d registers → %u blocks, %u B payload\n",
+                      (unsigned)samples, REGISTER_COUNT, (unsigned)blocks, (unsigned)payloadBytes);
+        Serial.println("  stage               µs/sample  cycles/sample");
+        for (const Stage& s : stages) {
+            float perSample = (float)s.us / samples;
+            Serial.printf("  %-18s %10.2f  %13.0f\n", s.name, perSample, perSample * mhz);
+        }
+    }
+
 }  // namespace Buffer
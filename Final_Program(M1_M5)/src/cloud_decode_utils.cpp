@@ -1,37 +1,35 @@
 #include "cloud_decode_utils.h"
+#include "compression.h"
+#include "initiate_compression.h"
+#include "buffer.h"
+#include "modbus_utils.h"
+#include "register_map.h"
+#include <time.h>
 
 std::vector<DecodedSnapshot> decodeDecompressedData(
-    const std::vector<uint16_t>& data, int regs)
+    const std::vector<uint32_t>& epochs, const std::vector<uint16_t>& data, int regs)
 {
     std::vector<DecodedSnapshot> result;
-    if (data.size() < (size_t)(regs + 6)) return result;
+    if (regs <= 0 || data.size() < (size_t)regs) return result;
 
-    size_t frameWords = regs + 6;
-    size_t frameCount = data.size() / frameWords;
+    size_t frameCount = min(data.size() / (size_t)regs, epochs.size());
+    result.reserve(frameCount);
 
     for (size_t f = 0; f < frameCount; ++f) {
-        size_t base = f * frameWords;
-
-        // Extract timestamp parts
-        uint16_t year   = data[base + 0];
-        uint16_t month  = data[base + 1];
-        uint16_t day    = data[base + 2];
-        uint16_t hour   = data[base + 3];
-        uint16_t minute = data[base + 4];
-        uint16_t second = data[base + 5];
+        size_t base = f * regs;
 
+        // Same wall-clock format the device used to send as six words
+        time_t t = (time_t)epochs[f];
+        struct tm* tm = localtime(&t);
         char buf[25];
-        snprintf(buf, sizeof(buf), "%04u-%02u-%02u %02u:%02u:%02u",
-                 year, month, day, hour, minute, second);
+        snprintf(buf, sizeof(buf), "%04d-%02d-%02d %02d:%02d:%02d",
+                 tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday,
+                 tm->tm_hour, tm->tm_min, tm->tm_sec);
 
         DecodedSnapshot snap;
+        snap.epoch = epochs[f];
         snap.timestamp = String(buf);
-        snap.registers.reserve(regs);
-
-        // Extract register values
-        for (int r = 0; r < regs; ++r) {
-            snap.registers.push_back(data[base + 6 + r]);
-        }
+        snap.registers.assign(data.begin() + base, data.begin() + base + regs);
 
         result.push_back(std::move(snap));
     }
@@ -39,6 +37,55 @@ std::vector<DecodedSnapshot> decodeDecompressedData(
     return result;
 }
 
+std::vector<DecodedSnapshot> decodeUploadPayload(const std::vector<uint8_t>& payload, int regs,
+                                                 const DecodedSnapshot* ref) {
+    if (payload.size() < 3 || regs <= 0) return {};
+
+    // v3: TimeSeriesCompressor rows, no codec fields
+    const Compression::Codec* codec = Compression::findCodec(Compression::CODEC_TIME_SERIES);
+    const uint16_t* refRow = nullptr;
+    size_t rowCount = 0;
+    size_t i = 1;
+    if (payload[0] == UPLOAD_PAYLOAD_VERSION || payload[0] == UPLOAD_PAYLOAD_V5 ||
+        payload[0] == UPLOAD_PAYLOAD_V4) {
+        // f = flags and device bytes: v5 has no device byte, v4 no flags either
+        size_t f = payload[0] == UPLOAD_PAYLOAD_VERSION ? 2 : payload[0] == UPLOAD_PAYLOAD_V5 ? 1 : 0;
+        if (payload.size() < UPLOAD_HEADER_BYTES - 2 + f) return {};
+        codec = Compression::findCodec(payload[1]);
+        uint8_t flags = f ? payload[2] : 0;
+        int cols = (payload[2 + f] << 8) | payload[3 + f];
+        rowCount = ((size_t)payload[4 + f] << 8) | payload[5 + f];
+        size_t paramBytes = payload[6 + f];
+        const uint8_t* params = &payload[7 + f];
+        i = 7 + f + paramBytes;
+        if (!codec || cols != regs || paramBytes != codec->paramBytes ||
+            payload.size() < i + 2 ||
+            (paramBytes && memcmp(params, codec->params, paramBytes) != 0)) return {};
+
+        if (flags & UPLOAD_FLAG_REFERENCED) {
+            if (!ref || ref->registers.size() != (size_t)regs ||
+                payload.size() < i + UPLOAD_REFERENCE_BYTES + 2) return {};
+            uint16_t check = (uint16_t)((payload[i] << 8) | payload[i + 1]);
+            if (Buffer::rowCrc(Modbus::CRC_INIT, ref->epoch, ref->registers.data()) != check) return {};
+            refRow = ref->registers.data();
+            i += UPLOAD_REFERENCE_BYTES;
+        }
+    } else if (payload[0] != UPLOAD_PAYLOAD_V3) {
+        return {};
+    }
+
+    size_t timeBytes = ((size_t)payload[i] << 8) | payload[i + 1];
+    i += 2;
+    if (payload.size() < i + timeBytes) return {};
+
+    std::vector<uint8_t> rows(payload.begin() + i + timeBytes, payload.end());
+    auto values = codec->decompress(rows, regs, refRow);
+    if (rowCount && values.size() != rowCount * (size_t)regs) return {};
+    auto epochs = Compression::EpochEncoder::decode(payload.data() + i, timeBytes,
+                                                    values.size() / (size_t)regs);
+    return decodeDecompressedData(epochs, values, regs);
+}
+
 void printDecodedSnapshots(const std::vector<DecodedSnapshot>& snapshots) {
     Serial.printf("[DecodedData] 🧩 Total snapshots: %d\n", (int)snapshots.size());
 
@@ -50,8 +97,14 @@ void printDecodedSnapshots(const std::vector<DecodedSnapshot>& snapshots) {
             uint16_t val = s.registers[r];
             if (val == 0xFFFF)
                 Serial.printf("    R%-2d = (unread)\n", (int)r);
-            else
-                Serial.printf("    R%-2d = %u\n", (int)r, val);
+            else if (val == 0xFFFE)
+                Serial.printf("    R%-2d = (held)\n", (int)r);
+            else {
+                // This firmware uploads raw words (UPLOAD_FLAG_RAW)
+                char value[SCALED_VALUE_CHARS];
+                formatScaled(value, sizeof(value), (int)r, val);
+                Serial.printf("    R%-2d = %s\n", (int)r, value);
+            }
         }
         Serial.println();
     }
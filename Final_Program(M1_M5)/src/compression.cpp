@@ -1,4 +1,6 @@
 #include "compression.h"
+#include "register_map.h"
+#include <string.h>
 
 using namespace Compression;
 
@@ -101,99 +103,713 @@ static inline int8_t unpack_s4(uint8_t nib) {
     return (nib & 0x8) ? (int8_t)(nib | 0xF0) : (int8_t)(nib & 0x0F);
 }
 
-vector<uint8_t> TimeSeriesCompressor::compress(const vector<uint16_t>& values, int regs) {
+static inline void put_header(uint8_t* o, int regs) {
+    o[0] = TimeSeriesCompressor::FORMAT_VERSION;
+    o[1] = (uint8_t)((regs >> 8) & 0xFF);
+    o[2] = (uint8_t)(regs & 0xFF);
+}
+
+static inline size_t varu_len(uint32_t v) {
+    size_t n = 1;
+    while (v >= 0x80) { v >>= 7; n++; }
+    return n;
+}
+
+// Delta rows of `regs` columns: first row absolute, then mask/nibbles/absolutes.
+// Without absoluteFirst the first row is a reference the decoder already has.
+static void put_delta_rows(vector<uint8_t>& out, const uint16_t* values, size_t frames, int regs,
+                           bool absoluteFirst = true) {
+    size_t mb = TimeSeriesCompressor::maskBytes(regs);
+    size_t nb = TimeSeriesCompressor::nibbleBytes(regs);
+
+    // first frame absolute
+    if (absoluteFirst)
+        for (int j = 0; j < regs; ++j)
+            put_u16_be(out, values[j]);
+
+    // subsequent frames: mask and nibbles are filled in place
+    for (size_t f = 1; f < frames; ++f) {
+        const uint16_t* prev = &values[(f - 1) * regs];
+        const uint16_t* curr = &values[f * regs];
+        size_t maskAt = out.size();
+        size_t nibAt = maskAt + mb;
+        out.resize(nibAt + nb, 0);
+
+        for (int j = 0; j < regs; ++j) {
+            int8_t s4 = clamp_s4((int32_t)curr[j] - (int32_t)prev[j]);
+            if (s4 == 127) out[maskAt + j / 8] |= (uint8_t)(1u << (j % 8));
+            else out[nibAt + j / 2] |= (j % 2 == 0) ? (uint8_t)(pack_s4(s4) << 4) : pack_s4(s4);
+        }
+
+        // absolutes for flagged regs
+        for (int j = 0; j < regs; ++j)
+            if (out[maskAt + j / 8] & (1u << (j % 8))) put_u16_be(out, curr[j]);
+    }
+}
+
+// Reads delta rows from blob[i..] into out (appended), at most maxFrames
+// (0 = until the end). The first row is taken from `first` when given
+// instead of the stream. Returns frames read, that row included.
+static size_t get_delta_rows(const vector<uint8_t>& blob, size_t& i, int cols,
+                             size_t maxFrames, vector<uint16_t>& out,
+                             const uint16_t* first = nullptr) {
+    size_t mb = TimeSeriesCompressor::maskBytes(cols);
+    size_t nb = TimeSeriesCompressor::nibbleBytes(cols);
+
+    // first frame absolute
+    if (first) {
+        out.insert(out.end(), first, first + cols);
+    } else {
+        if (i + (size_t)cols * 2 > blob.size()) return 0;
+        for (int j = 0; j < cols; ++j) {
+            out.push_back(get_u16_be(blob, i));
+            i += 2;
+        }
+    }
+    size_t frames = 1;
+
+    // subsequent frames, each against the row just written
+    while ((maxFrames == 0 || frames < maxFrames) && i + mb + nb <= blob.size()) {
+        size_t maskAt = i;
+        size_t nibAt = i + mb;
+        size_t at = nibAt + nb;
+        size_t base = out.size() - cols;
+
+        for (int j = 0; j < cols; ++j) {
+            uint16_t v;
+            if (blob[maskAt + j / 8] & (1u << (j % 8))) {
+                if (at + 1 >= blob.size()) { out.resize(base + cols); return frames; }
+                v = get_u16_be(blob, at);
+                at += 2;
+            } else {
+                uint8_t byte = blob[nibAt + j / 2];
+                uint8_t nib = (j % 2 == 0) ? ((byte >> 4) & 0x0F) : (byte & 0x0F);
+                v = (uint16_t)((out[base + j] + unpack_s4(nib)) & 0xFFFF);
+            }
+            out.push_back(v);
+        }
+        i = at;
+        frames++;
+    }
+    return frames;
+}
+
+// Run-length layout (v3) of the same rows; empty when no column gains.
+// With a reference row (values[0..regs)) only the runs include it.
+static vector<uint8_t> compress_runs(const vector<uint16_t>& values, size_t frames, int regs,
+                                     bool referenced = false) {
     vector<uint8_t> out;
-    if (regs <= 0 || values.empty()) return out;
+    vector<uint8_t> runMask(TimeSeriesCompressor::maskBytes(regs), 0);
+    int deltaCols = 0;
+
+    // Per column: run-length bytes vs. an estimate of its delta-row bits
+    for (int j = 0; j < regs; ++j) {
+        size_t runBytes = 0, runs = 0, escapes = 0, len = 1;
+        for (size_t f = 1; f <= frames; ++f) {
+            if (f < frames && values[f * regs + j] == values[(f - 1) * regs + j]) { len++; continue; }
+            runBytes += 2 + varu_len((uint32_t)len);
+            runs++;
+            len = 1;
+        }
+        runBytes += varu_len((uint32_t)runs);
+        for (size_t f = 1; f < frames; ++f)
+            if (clamp_s4((int32_t)values[f * regs + j] - (int32_t)values[(f - 1) * regs + j]) == 127)
+                escapes++;
+        size_t deltaBits = (referenced ? 0 : 16) + (frames - 1) * 5 + escapes * 16;   // nibble + mask bit per row
+
+        if (runBytes * 8 < deltaBits) runMask[j / 8] |= (uint8_t)(1u << (j % 8));
+        else deltaCols++;
+    }
+    if (deltaCols == regs) return out;
+
+    out.reserve(TimeSeriesCompressor::RUN_HEADER_BYTES + runMask.size() + values.size());
+    out.push_back((uint8_t)TimeSeriesCompressor::RUN_FORMAT_VERSION);
+    put_u16_be(out, (uint16_t)regs);
+    put_u16_be(out, (uint16_t)frames);
+    out.insert(out.end(), runMask.begin(), runMask.end());
+
+    // Runs of each run-length column: count, then (value, length) pairs
+    for (int j = 0; j < regs; ++j) {
+        if (!(runMask[j / 8] & (1u << (j % 8)))) continue;
+        uint32_t runs = 0;
+        size_t len = 1;
+        vector<uint8_t> body;
+        for (size_t f = 1; f <= frames; ++f) {
+            if (f < frames && values[f * regs + j] == values[(f - 1) * regs + j]) { len++; continue; }
+            put_u16_be(body, values[(f - 1) * regs + j]);
+            put_varu(body, (uint32_t)len);
+            runs++;
+            len = 1;
+        }
+        put_varu(out, runs);
+        out.insert(out.end(), body.begin(), body.end());
+    }
+
+    // Remaining columns as ordinary delta rows
+    if (deltaCols > 0) {
+        vector<uint16_t> rest;
+        rest.reserve(frames * deltaCols);
+        for (size_t f = 0; f < frames; ++f)
+            for (int j = 0; j < regs; ++j)
+                if (!(runMask[j / 8] & (1u << (j % 8)))) rest.push_back(values[f * regs + j]);
+        put_delta_rows(out, rest.data(), frames, deltaCols, !referenced);
+    }
+    return out;
+}
+
+// Reference row followed by the batch, for the referenced layouts
+static vector<uint16_t> with_reference(const vector<uint16_t>& values, int regs, const uint16_t* ref) {
+    vector<uint16_t> ext;
+    ext.reserve(values.size() + (size_t)regs);
+    ext.insert(ext.end(), ref, ref + regs);
+    ext.insert(ext.end(), values.begin(), values.end());
+    return ext;
+}
+
+vector<uint8_t> TimeSeriesCompressor::compress(const vector<uint16_t>& values, int regs,
+                                               const uint16_t* ref) {
+    vector<uint8_t> out;
+    if (regs <= 0 || regs > MAX_COLUMNS || values.empty()) return out;
 
     if (values.size() % (size_t)regs != 0) {
         // fallback to Delta16Var
         return Delta16VarCompressor::compress(values);
     }
+    if (ref) {
+        // Encoded as if the reference were the first row, which is not sent
+        vector<uint16_t> ext = with_reference(values, regs, ref);
+        size_t frames = ext.size() / (size_t)regs;
+        out.resize(HEADER_BYTES);
+        put_header(out.data(), regs);
+        put_delta_rows(out, ext.data(), frames, regs, false);
+        if (frames <= 0xFFFF) {
+            vector<uint8_t> runs = compress_runs(ext, frames, regs, true);
+            if (!runs.empty() && runs.size() < out.size()) return runs;
+        }
+        return out;
+    }
 
     size_t frames = values.size() / (size_t)regs;
-    out.reserve(values.size());
+    out.reserve(HEADER_BYTES + values.size());
+    out.resize(HEADER_BYTES);
+    put_header(out.data(), regs);
+    put_delta_rows(out, values.data(), frames, regs);
 
-    // first frame absolute
-    for (int j = 0; j < regs; ++j)
-        put_u16_be(out, values[j]);
+    // Run-length layout only when it actually comes out smaller
+    if (frames > 1 && frames <= 0xFFFF) {
+        vector<uint8_t> runs = compress_runs(values, frames, regs);
+        if (!runs.empty() && runs.size() < out.size()) return runs;
+    }
+    return out;
+}
 
-    // subsequent frames
-    for (size_t f = 1; f < frames; ++f) {
-        const uint16_t* prev = &values[(f - 1) * regs];
-        const uint16_t* curr = &values[f * regs];
-        uint16_t mask = 0;
-        uint8_t nibbles[32];
+int TimeSeriesCompressor::columns(const vector<uint8_t>& blob) {
+    if (blob.size() < HEADER_BYTES) return -1;
+    if (blob[0] != FORMAT_VERSION && blob[0] != RUN_FORMAT_VERSION) return -1;
+    int regs = get_u16_be(blob, 1);
+    return regs > 0 ? regs : -1;
+}
+
+// Rows of a v2/v3 stream, at most maxFrames of them (0 = all). With a
+// reference the stream's first row is that reference (not in the stream
+// for the delta columns) and is returned too.
+static vector<uint16_t> decode_rows(const vector<uint8_t>& blob, int cols, size_t maxFrames,
+                                    const uint16_t* ref = nullptr) {
+    vector<uint16_t> out;
+    if (blob[0] == TimeSeriesCompressor::FORMAT_VERSION) {
+        size_t i = TimeSeriesCompressor::HEADER_BYTES;
+        out.reserve(maxFrames ? maxFrames * (size_t)cols : blob.size());
+        get_delta_rows(blob, i, cols, maxFrames, out, ref);
+        return out;
+    }
+
+    // Run-length layout: rows are known up front
+    const size_t maskLen = TimeSeriesCompressor::maskBytes(cols);
+    if (blob.size() < TimeSeriesCompressor::RUN_HEADER_BYTES + maskLen) return out;
+    size_t frames = get_u16_be(blob, 3);
+    if (maxFrames && maxFrames < frames) frames = maxFrames;
+    const uint8_t* runMask = &blob[TimeSeriesCompressor::RUN_HEADER_BYTES];
+    size_t i = TimeSeriesCompressor::RUN_HEADER_BYTES + maskLen;
+    out.assign(frames * (size_t)cols, 0);
+
+    int deltaCols = 0;
+    for (int j = 0; j < cols; ++j) {
+        if (!(runMask[j / 8] & (1u << (j % 8)))) { deltaCols++; continue; }
+        uint32_t runs = get_varu(blob, i);
+        size_t f = 0;
+        for (uint32_t r = 0; r < runs; ++r) {
+            if (i + 2 > blob.size()) return {};
+            uint16_t v = get_u16_be(blob, i);
+            i += 2;
+            uint32_t len = get_varu(blob, i);
+            for (uint32_t k = 0; k < len && f < frames; ++k, ++f) out[f * cols + j] = v;
+        }
+        if (f != frames) return {};
+    }
+
+    if (deltaCols > 0) {
+        vector<uint16_t> rest, restRef;
+        rest.reserve(frames * deltaCols);
+        if (ref)
+            for (int j = 0; j < cols; ++j)
+                if (!(runMask[j / 8] & (1u << (j % 8)))) restRef.push_back(ref[j]);
+        if (get_delta_rows(blob, i, deltaCols, frames, rest,
+                           ref ? restRef.data() : nullptr) != frames) return {};
+        size_t k = 0;
+        for (size_t f = 0; f < frames; ++f)
+            for (int j = 0; j < cols; ++j)
+                if (!(runMask[j / 8] & (1u << (j % 8)))) out[f * cols + j] = rest[k++];
+    }
+    return out;
+}
+
+vector<uint16_t> TimeSeriesCompressor::decompress(const vector<uint8_t>& blob, int regs,
+                                                  const uint16_t* ref) {
+    int cols = columns(blob);
+    if (cols <= 0 || (regs > 0 && regs != cols)) return {};
+    vector<uint16_t> out = decode_rows(blob, cols, 0, ref);
+    if (ref) out.erase(out.begin(), out.begin() + min(out.size(), (size_t)cols));
+    return out;
+}
+
+vector<uint16_t> TimeSeriesCompressor::decompressPrefix(const vector<uint8_t>& blob, size_t rows) {
+    int cols = columns(blob);
+    if (cols <= 0 || rows == 0) return {};
+    return decode_rows(blob, cols, rows);
+}
+
+size_t TimeSeriesCompressor::repack(uint8_t* data, size_t len) {
+    vector<uint8_t> stream(data, data + len);
+    int cols = columns(stream);
+    if (cols <= 0 || stream[0] != FORMAT_VERSION) return len;
+
+    vector<uint8_t> packed = compress(decompress(stream, cols), cols);
+    if (packed.empty() || packed.size() >= len) return len;
+    memcpy(data, packed.data(), packed.size());
+    return packed.size();
+}
+
+BenchResult TimeSeriesCompressor::benchmark(const vector<uint16_t>& values, int regs) {
+    BenchResult br{};
+    br.mode = name();
+    br.samples = values.size();
+    br.origBytes = values.size() * 2;
+
+    unsigned long t0 = micros();
+    auto c = compress(values, regs);
+    unsigned long t1 = micros();
+    auto r = decompress(c, regs);
+    unsigned long t2 = micros();
+
+    br.compBytes = c.size();
+    br.tCompressUs = t1 - t0;
+    br.tDecompressUs = t2 - t1;
+    br.lossless = (r == values);
+    return br;
+}
+
+// ================================================================
+// ➕ TimeSeriesEncoder Implementation
+// ================================================================
+bool TimeSeriesEncoder::begin(uint8_t* buf, size_t capacity, int regs) {
+    _buf = buf;
+    _cap = capacity;
+    _len = 0;
+    _rows = 0;
+    _regs = 0;
+    if (regs <= 0 || regs > TimeSeriesCompressor::MAX_COLUMNS ||
+        capacity < TimeSeriesCompressor::HEADER_BYTES) return false;
+
+    _regs = regs;
+    if (_prev.size() != (size_t)regs) _prev.assign(regs, 0);
+    put_header(_buf, regs);
+    _len = TimeSeriesCompressor::HEADER_BYTES;
+    return true;
+}
+
+size_t TimeSeriesEncoder::maxRowBytes() const {
+    if (_rows == 0) return (size_t)_regs * 2;
+    return TimeSeriesCompressor::maskBytes(_regs) + TimeSeriesCompressor::nibbleBytes(_regs) +
+           (size_t)_regs * 2;
+}
+
+bool TimeSeriesEncoder::append(const uint16_t* row) {
+    if (_regs == 0) return false;
+
+    // First row absolute
+    if (_rows == 0) {
+        if (_len + (size_t)_regs * 2 > _cap) return false;
+        for (int j = 0; j < _regs; ++j) {
+            _buf[_len++] = (uint8_t)(row[j] >> 8);
+            _buf[_len++] = (uint8_t)(row[j] & 0xFF);
+            _prev[j] = row[j];
+        }
+        _rows = 1;
+        return true;
+    }
+
+    // Size the row before touching the buffer
+    int absolutes = 0;
+    for (int j = 0; j < _regs; ++j)
+        if (clamp_s4((int32_t)row[j] - (int32_t)_prev[j]) == 127) absolutes++;
+
+    size_t mb = TimeSeriesCompressor::maskBytes(_regs);
+    size_t nb = TimeSeriesCompressor::nibbleBytes(_regs);
+    if (_len + mb + nb + (size_t)absolutes * 2 > _cap) return false;
+
+    uint8_t* mask = _buf + _len;
+    uint8_t* nib = mask + mb;
+    memset(mask, 0, mb + nb);
+    _len += mb + nb;
+
+    for (int j = 0; j < _regs; ++j) {
+        int8_t s4 = clamp_s4((int32_t)row[j] - (int32_t)_prev[j]);
+        if (s4 == 127) mask[j / 8] |= (uint8_t)(1u << (j % 8));
+        else nib[j / 2] |= (j % 2 == 0) ? (uint8_t)(pack_s4(s4) << 4) : pack_s4(s4);
+    }
+
+    // absolutes for flagged regs
+    for (int j = 0; j < _regs; ++j) {
+        if (mask[j / 8] & (1u << (j % 8))) {
+            _buf[_len++] = (uint8_t)(row[j] >> 8);
+            _buf[_len++] = (uint8_t)(row[j] & 0xFF);
+        }
+        _prev[j] = row[j];
+    }
+    _rows++;
+    return true;
+}
+
+// ================================================================
+// ⏱️ EpochEncoder Implementation
+// ================================================================
+void EpochEncoder::begin(uint8_t* end, size_t capacity) {
+    _end = end;
+    _cap = capacity;
+    _bits = 0;
+    _count = 0;
+    _prev = 0;
+    _prevDelta = 0;
+}
+
+void EpochEncoder::putBits(uint32_t v, int n) {
+    for (int k = n - 1; k >= 0; --k, ++_bits) {
+        uint8_t& byte = _end[-1 - (ptrdiff_t)(_bits / 8)];
+        if ((_bits & 7) == 0) byte = 0;
+        if ((v >> k) & 1) byte |= (uint8_t)(0x80 >> (_bits & 7));
+    }
+}
+
+bool EpochEncoder::append(uint32_t epoch) {
+    if (!_end || (_bits + 7) / 8 + MAX_VALUE_BYTES > _cap) return false;
+
+    if (_count == 0) {
+        putBits(epoch, 32);
+    } else {
+        // Wrapping arithmetic; the decoder undoes it the same way
+        uint32_t delta = epoch - _prev;
+        uint32_t zz = zigzag32((int32_t)(delta - _prevDelta));
+        if (zz == 0)          putBits(0, 1);
+        else if (zz < 128)    { putBits(0x2, 2); putBits(zz, 7); }
+        else if (zz < 512)    { putBits(0x6, 3); putBits(zz, 9); }
+        else if (zz < 4096)   { putBits(0xE, 4); putBits(zz, 12); }
+        else                  { putBits(0xF, 4); putBits(zz, 32); }
+        _prevDelta = delta;
+    }
+    _prev = epoch;
+    _count++;
+    return true;
+}
+
+void EpochEncoder::copyTo(uint8_t* out) const {
+    for (size_t k = 0; k < size(); ++k) out[k] = _end[-1 - (ptrdiff_t)k];
+}
+
+vector<uint32_t> EpochEncoder::decode(const uint8_t* data, size_t len, size_t count) {
+    vector<uint32_t> out;
+    size_t bit = 0;
+    size_t total = len * 8;
+    auto get = [&](int n, uint32_t& v) {
+        if (bit + (size_t)n > total) return false;
+        v = 0;
+        for (int k = 0; k < n; ++k, ++bit)
+            v = (v << 1) | ((data[bit / 8] >> (7 - (bit & 7))) & 1);
+        return true;
+    };
+
+    uint32_t prev, delta = 0;
+    if (count == 0 || !get(32, prev)) return out;
+    out.reserve(count);
+    out.push_back(prev);
+
+    while (out.size() < count) {
+        int ones = 0;
+        uint32_t b;
+        while (ones < 4) {
+            if (!get(1, b)) return out;
+            if (!b) break;
+            ones++;
+        }
+        static const int WIDTH[] = {0, 7, 9, 12, 32};
+        uint32_t zz = 0;
+        if (ones > 0 && !get(WIDTH[ones], zz)) return out;
+        delta += (uint32_t)unzigzag32(zz);
+        prev += delta;
+        out.push_back(prev);
+    }
+    return out;
+}
+
+// ================================================================
+// 📐 ForPackCompressor Implementation
+// ================================================================
+static inline uint16_t zigzag16(uint16_t curr, uint16_t prev) {
+    int16_t d = (int16_t)(uint16_t)(curr - prev);
+    return (uint16_t)(((uint16_t)d << 1) ^ (uint16_t)(d >> 15));
+}
+static inline uint16_t unzigzag16(uint16_t z) {
+    return (uint16_t)((z >> 1) ^ (uint16_t)-(int16_t)(z & 1));
+}
+static inline int bit_length(uint32_t v) { return v ? 32 - __builtin_clz(v) : 0; }
+
+namespace {
+    // Word-at-a-time bit writer/reader. The word is stored with memcpy, so
+    // the bit order is little-endian (ESP8266 and hosts are LE).
+    struct BitWriter {
+        uint8_t* p;
+        uint64_t acc = 0;
+        int bits = 0;
+
+        explicit BitWriter(uint8_t* out) : p(out) {}
+
+        inline void put(uint32_t v, int n) {
+            acc |= (uint64_t)v << bits;
+            bits += n;
+            if (bits >= 32) {
+                uint32_t w = (uint32_t)acc;
+                memcpy(p, &w, 4);
+                p += 4;
+                acc >>= 32;
+                bits -= 32;
+            }
+        }
+
+        // Flushes the partial word, padded to a byte
+        uint8_t* finish() {
+            while (bits > 0) { *p++ = (uint8_t)acc; acc >>= 8; bits -= 8; }
+            acc = 0;
+            bits = 0;
+            return p;
+        }
+    };
+
+    struct BitReader {
+        const uint8_t* p;
+        const uint8_t* end;
+        uint64_t acc = 0;
+        int bits = 0;
+
+        BitReader(const uint8_t* from, const uint8_t* to) : p(from), end(to) {}
+
+        inline uint32_t get(int n) {
+            if (bits < n) {
+                if (end - p >= 4) {
+                    uint32_t w;
+                    memcpy(&w, p, 4);
+                    p += 4;
+                    acc |= (uint64_t)w << bits;
+                    bits += 32;
+                } else {
+                    while (p < end) { acc |= (uint64_t)*p++ << bits; bits += 8; }
+                    if (bits < n) bits = n;   // past the end reads zeros
+                }
+            }
+            uint32_t v = (uint32_t)acc & ((1u << n) - 1);
+            acc >>= n;
+            bits -= n;
+            return v;
+        }
+    };
+
+    // Cheapest width for one column of a block, given how many deltas
+    // need each bit length
+    int chooseWidth(const uint8_t* lengthCount, int rows, int& exceptions) {
+        int best = 16, bestExc = 0;
+        long bestCost = (long)rows * 16;
+        int above = 0;                     // deltas longer than b
+        for (int b = 16; b >= 0; --b) {
+            if (b < 16) above += lengthCount[b + 1];
+            long cost = (long)rows * b + (long)above * ForPackCompressor::EXCEPTION_BITS;
+            if (cost <= bestCost && above < 256) { best = b; bestCost = cost; bestExc = above; }
+        }
+        exceptions = bestExc;
+        return best;
+    }
+}
+
+size_t ForPackCompressor::maxCompressedSize(size_t rows, int regs) {
+    if (rows == 0 || regs <= 0) return HEADER_BYTES;
+    size_t deltaRows = rows - 1;
+    size_t blocks = (deltaRows + BLOCK_ROWS - 1) / BLOCK_ROWS;
+    // Widths never exceed 16 bits with no exceptions, or what they replace
+    return HEADER_BYTES + (size_t)regs * 2 + blocks * ((size_t)regs * 2 + 1) +
+           deltaRows * (size_t)regs * 2 + 4;
+}
 
+vector<uint8_t> ForPackCompressor::compress(const vector<uint16_t>& batch, int regs,
+                                            const uint16_t* ref) {
+    vector<uint8_t> out;
+    if (regs <= 0 || regs > 0xFFFF || batch.empty() || batch.size() % (size_t)regs != 0) return out;
+
+    // Referenced: encoded as if the reference were the first row, which is not sent
+    vector<uint16_t> ext;
+    if (ref) ext = with_reference(batch, regs, ref);
+    const vector<uint16_t>& values = ref ? ext : batch;
+    size_t rows = values.size() / (size_t)regs;
+    if (rows > 0xFFFF) return out;
+
+    out.resize(maxCompressedSize(rows, regs));
+    uint8_t* o = out.data();
+
+    *o++ = FORMAT_VERSION;
+    *o++ = (uint8_t)(regs >> 8);  *o++ = (uint8_t)regs;
+    *o++ = (uint8_t)(rows >> 8);  *o++ = (uint8_t)rows;
+
+    // first row absolute
+    for (int j = 0; j < regs && !ref; ++j) {
+        *o++ = (uint8_t)(values[j] >> 8);
+        *o++ = (uint8_t)values[j];
+    }
+
+    vector<uint8_t> widths(regs);
+    vector<uint8_t> excCount(regs);
+    uint16_t zz[BLOCK_ROWS];
+
+    for (size_t start = 1; start < rows; start += BLOCK_ROWS) {
+        int n = (int)min((size_t)BLOCK_ROWS, rows - start);
+
+        // Column headers: width and exception count
         for (int j = 0; j < regs; ++j) {
-            int8_t s4 = clamp_s4((int32_t)curr[j] - (int32_t)prev[j]);
-            if (s4 == 127) { mask |= (1u << j); nibbles[j] = 0; }
-            else nibbles[j] = pack_s4(s4);
+            uint8_t lengthCount[17] = {0};
+            for (int r = 0; r < n; ++r) {
+                size_t f = start + r;
+                lengthCount[bit_length(zigzag16(values[f * regs + j], values[(f - 1) * regs + j]))]++;
+            }
+            int exc;
+            widths[j] = (uint8_t)chooseWidth(lengthCount, n, exc);
+            excCount[j] = (uint8_t)exc;
+            *o++ = (uint8_t)(widths[j] | (exc ? 0x80 : 0));
+            if (exc) *o++ = (uint8_t)exc;
         }
 
-        // mask (LE)
-        out.push_back((uint8_t)(mask & 0xFF));
-        out.push_back((uint8_t)((mask >> 8) & 0xFF));
+        // Packed low bits, column-major
+        BitWriter bw(o);
+        for (int j = 0; j < regs; ++j) {
+            int b = widths[j];
+            if (b == 0) continue;
+            uint32_t lowMask = (1u << b) - 1;
+            for (int r = 0; r < n; ++r) {
+                size_t f = start + r;
+                bw.put(zigzag16(values[f * regs + j], values[(f - 1) * regs + j]) & lowMask, b);
+            }
+        }
+        o = bw.finish();
 
-        // packed nibbles
-        for (int j = 0; j < regs; j += 2) {
-            uint8_t b = (uint8_t)((nibbles[j] << 4) |
-                                  ((j + 1 < regs) ? (nibbles[j + 1] & 0x0F) : 0));
-            out.push_back(b);
+        // Exceptions: high bits of the deltas that did not fit
+        for (int j = 0; j < regs; ++j) {
+            if (!excCount[j]) continue;
+            int b = widths[j];
+            for (int r = 0; r < n; ++r) {
+                size_t f = start + r;
+                zz[r] = zigzag16(values[f * regs + j], values[(f - 1) * regs + j]);
+            }
+            for (int r = 0; r < n; ++r) {
+                if (bit_length(zz[r]) <= b) continue;
+                uint16_t high = (uint16_t)(zz[r] >> b);
+                *o++ = (uint8_t)r;
+                *o++ = (uint8_t)(high >> 8);
+                *o++ = (uint8_t)high;
+            }
         }
+    }
 
-        // absolutes for flagged regs
-        for (int j = 0; j < regs; ++j)
-            if (mask & (1u << j)) put_u16_be(out, curr[j]);
+    out.resize(o - out.data());
+    return out;
+}
+
+vector<uint16_t> ForPackCompressor::decompress(const vector<uint8_t>& blob, const uint16_t* ref) {
+    vector<uint16_t> out = decodeRows(blob, ref);
+    if (ref && blob.size() >= HEADER_BYTES) {
+        size_t regs = ((size_t)blob[1] << 8) | blob[2];
+        out.erase(out.begin(), out.begin() + min(out.size(), regs));
     }
     return out;
 }
 
-vector<uint16_t> TimeSeriesCompressor::decompress(const vector<uint8_t>& blob, int regs) {
+vector<uint16_t> ForPackCompressor::decodeRows(const vector<uint8_t>& blob, const uint16_t* ref) {
     vector<uint16_t> out;
-    if (regs <= 0 || blob.size() < (size_t)(regs * 2)) return out;
+    if (blob.size() < HEADER_BYTES || blob[0] != FORMAT_VERSION) return out;
+    int regs = (blob[1] << 8) | blob[2];
+    size_t rows = ((size_t)blob[3] << 8) | blob[4];
+    size_t firstBytes = ref ? 0 : (size_t)regs * 2;
+    if (regs == 0 || rows == 0 || blob.size() < HEADER_BYTES + firstBytes) return out;
 
-    out.reserve(blob.size());
-    size_t i = 0;
+    const uint8_t* p = blob.data() + HEADER_BYTES;
+    const uint8_t* end = blob.data() + blob.size();
 
-    // first frame absolute
-    vector<uint16_t> prev(regs);
-    for (int j = 0; j < regs; ++j) {
-        prev[j] = get_u16_be(blob, i);
-        i += 2;
-        out.push_back(prev[j]);
+    out.resize(rows * (size_t)regs);
+    if (ref) {
+        for (int j = 0; j < regs; ++j) out[j] = ref[j];
+    } else {
+        for (int j = 0; j < regs; ++j, p += 2) out[j] = (uint16_t)((p[0] << 8) | p[1]);
     }
 
-    // subsequent frames
-    while (i < blob.size()) {
-        size_t need = 2 + (size_t)((regs + 1) / 2);
-        if (i + need > blob.size()) break;
+    vector<uint8_t> widths(regs);
+    vector<uint8_t> excCount(regs);
+    uint16_t zz[BLOCK_ROWS];
 
-        uint16_t mask = (uint16_t)(blob[i] | (blob[i + 1] << 8)); i += 2;
-        uint8_t nb = (uint8_t)((regs + 1) / 2);
-        uint8_t packed[32];
-        for (int k = 0; k < nb; ++k) packed[k] = blob[i++];
+    for (size_t start = 1; start < rows; start += BLOCK_ROWS) {
+        int n = (int)min((size_t)BLOCK_ROWS, rows - start);
 
-        vector<uint16_t> curr = prev;
+        size_t packedBits = 0;
         for (int j = 0; j < regs; ++j) {
-            uint8_t byte = packed[j / 2];
-            uint8_t nib = (j % 2 == 0) ? ((byte >> 4) & 0x0F) : (byte & 0x0F);
-            if (mask & (1u << j)) {
-                if (i + 1 >= blob.size()) return out;
-                curr[j] = get_u16_be(blob, i);
-                i += 2;
-            } else {
-                curr[j] = (uint16_t)((curr[j] + unpack_s4(nib)) & 0xFFFF);
+            if (p >= end) { out.resize(start * regs); return out; }
+            uint8_t h = *p++;
+            widths[j] = h & 0x1F;
+            excCount[j] = 0;
+            if (h & 0x80) {
+                if (p >= end) { out.resize(start * regs); return out; }
+                excCount[j] = *p++;
             }
+            if (widths[j] > 16) { out.resize(start * regs); return out; }
+            packedBits += (size_t)n * widths[j];
         }
+        size_t packedBytes = (packedBits + 7) / 8;
+        if ((size_t)(end - p) < packedBytes) { out.resize(start * regs); return out; }
+
+        // Rows are rebuilt column by column; exceptions follow the packed bits
+        BitReader br(p, p + packedBytes);
+        const uint8_t* exc = p + packedBytes;
         for (int j = 0; j < regs; ++j) {
-            out.push_back(curr[j]);
-            prev[j] = curr[j];
+            int b = widths[j];
+            for (int r = 0; r < n; ++r) zz[r] = b ? (uint16_t)br.get(b) : 0;
+            for (int e = 0; e < excCount[j]; ++e) {
+                if (end - exc < 3) { out.resize(start * regs); return out; }
+                int r = exc[0];
+                if (r < n) zz[r] |= (uint16_t)(((exc[1] << 8) | exc[2]) << b);
+                exc += 3;
+            }
+            for (int r = 0; r < n; ++r) {
+                size_t f = start + r;
+                out[f * regs + j] = (uint16_t)(out[(f - 1) * regs + j] + unzigzag16(zz[r]));
+            }
         }
+        p = exc;
     }
     return out;
 }
 
-BenchResult TimeSeriesCompressor::benchmark(const vector<uint16_t>& values, int regs) {
+BenchResult ForPackCompressor::benchmark(const vector<uint16_t>& values, int regs) {
     BenchResult br{};
     br.mode = name();
     br.samples = values.size();
@@ -202,7 +818,7 @@ BenchResult TimeSeriesCompressor::benchmark(const vector<uint16_t>& values, int
     unsigned long t0 = micros();
     auto c = compress(values, regs);
     unsigned long t1 = micros();
-    auto r = decompress(c, regs);
+    auto r = decompress(c);
     unsigned long t2 = micros();
 
     br.compBytes = c.size();
@@ -211,3 +827,296 @@ BenchResult TimeSeriesCompressor::benchmark(const vector<uint16_t>& values, int
     br.lossless = (r == values);
     return br;
 }
+
+// ================================================================
+// 🗂️ Codec registry
+// ================================================================
+namespace Compression {
+
+    // Referenced: the chain starts at the last word of the reference row,
+    // whose u16 is left out of the stream
+    static vector<uint8_t> deltaVarCompress(const vector<uint16_t>& values, int regs,
+                                            const uint16_t* ref) {
+        if (!ref || regs <= 0 || values.empty()) return Delta16VarCompressor::compress(values);
+        vector<uint16_t> ext;
+        ext.reserve(values.size() + 1);
+        ext.push_back(ref[regs - 1]);
+        ext.insert(ext.end(), values.begin(), values.end());
+        vector<uint8_t> out = Delta16VarCompressor::compress(ext);
+        out.erase(out.begin(), out.begin() + 2);
+        return out;
+    }
+
+    static vector<uint16_t> deltaVarDecompress(const vector<uint8_t>& blob, int regs,
+                                               const uint16_t* ref) {
+        vector<uint16_t> out;
+        if (ref && regs > 0) {
+            vector<uint8_t> ext;
+            ext.reserve(blob.size() + 2);
+            put_u16_be(ext, ref[regs - 1]);
+            ext.insert(ext.end(), blob.begin(), blob.end());
+            out = Delta16VarCompressor::decompress(ext);
+            if (!out.empty()) out.erase(out.begin());
+        } else {
+            out = Delta16VarCompressor::decompress(blob);
+        }
+        if (regs > 0 && out.size() % (size_t)regs != 0) out.clear();
+        return out;
+    }
+
+    static vector<uint16_t> forPackDecompress(const vector<uint8_t>& blob, int regs,
+                                              const uint16_t* ref) {
+        if (regs > 0 && (blob.size() < 3 || ((blob[1] << 8) | blob[2]) != regs)) return {};
+        return ForPackCompressor::decompress(blob, ref);
+    }
+
+    // Compressed size of the sample, with the delta rows scaled to the
+    // batch; the header and absolute first row are counted once
+    template <vector<uint8_t> (*Compress)(const vector<uint16_t>&, int, const uint16_t*)>
+    static size_t sampledEstimate(const vector<uint16_t>& sample, int regs, size_t rows) {
+        size_t sampleRows = regs > 0 ? sample.size() / (size_t)regs : 0;
+        if (sampleRows == 0 || rows == 0) return 0;
+        size_t bytes = Compress(sample, regs, nullptr).size();
+        if (sampleRows == 1 || rows == sampleRows) return bytes;
+
+        vector<uint16_t> first(sample.begin(), sample.begin() + regs);
+        size_t fixed = min(Compress(first, regs, nullptr).size(), bytes);
+        return fixed + ((bytes - fixed) * (rows - 1) + sampleRows - 2) / (sampleRows - 1);
+    }
+
+    static const uint8_t FOR_PACK_PARAMS[] = { (uint8_t)ForPackCompressor::BLOCK_ROWS };
+
+    static const Codec CODECS[] = {
+        { CODEC_TIME_SERIES, TimeSeriesCompressor::name(), nullptr, 0,
+          TimeSeriesCompressor::compress, TimeSeriesCompressor::decompress,
+          sampledEstimate<TimeSeriesCompressor::compress> },
+        { CODEC_FOR_PACK, ForPackCompressor::name(), FOR_PACK_PARAMS, sizeof(FOR_PACK_PARAMS),
+          ForPackCompressor::compress, forPackDecompress,
+          sampledEstimate<ForPackCompressor::compress> },
+        { CODEC_DELTA_VAR, Delta16VarCompressor::name(), nullptr, 0,
+          deltaVarCompress, deltaVarDecompress,
+          sampledEstimate<deltaVarCompress> },
+    };
+
+    const Codec* codecs(size_t& count) {
+        count = sizeof(CODECS) / sizeof(CODECS[0]);
+        return CODECS;
+    }
+
+    const Codec* findCodec(uint8_t id) {
+        for (const Codec& c : CODECS)
+            if (c.id == id) return &c;
+        return nullptr;
+    }
+
+    CodecChoice selectCodec(const vector<uint16_t>& values, int regs,
+                            unsigned long budgetUs, size_t sampleRows) {
+        size_t rows = regs > 0 ? values.size() / (size_t)regs : 0;
+        if (rows == 0) return CodecChoice{ &CODECS[0], 0, 0, 0 };
+
+        size_t n = min(max(sampleRows, (size_t)2), rows);
+        vector<uint16_t> sample(values.begin(), values.begin() + n * (size_t)regs);
+        return selectCodecFromSample(sample, regs, rows, budgetUs);
+    }
+
+    CodecChoice selectCodecFromSample(const vector<uint16_t>& sample, int regs,
+                                      size_t rows, unsigned long budgetUs) {
+        CodecChoice best{ &CODECS[0], 0, 0, 0 };
+        size_t n = regs > 0 ? sample.size() / (size_t)regs : 0;
+        if (n == 0 || rows < n) return best;
+
+        for (const Codec& c : CODECS) {
+            unsigned long t0 = micros();
+            size_t est = c.estimate(sample, regs, rows);
+            unsigned long dt = micros() - t0;
+            unsigned long projected = (unsigned long)((uint64_t)dt * rows / n);
+            best.spentUs += dt;
+
+            bool fits = best.spentUs + projected <= budgetUs;
+            if (&c == &CODECS[0] || (fits && est < best.estimatedBytes)) {
+                best.codec = &c;
+                best.estimatedBytes = est;
+                best.projectedUs = projected;
+            }
+            if (best.spentUs >= budgetUs) break;
+            yield();
+        }
+        return best;
+    }
+
+}  // namespace Compression
+
+// ================================================================
+// 📊 Column-count benchmark
+// ================================================================
+namespace Compression {
+
+    // Random walk with a mix of column behaviours: flat, ±3 noise,
+    // ±20 steps, and small noise with ~1 in 8 cells jumping
+    static vector<uint16_t> syntheticSeries(int columns, size_t rows) {
+        vector<uint16_t> values(rows * (size_t)columns);
+        for (int j = 0; j < columns; ++j) values[j] = (uint16_t)random(0, 4000);
+        for (size_t f = 1; f < rows; ++f) {
+            for (int j = 0; j < columns; ++j) {
+                long step = 0;
+                switch (j % 4) {
+                    case 1: step = random(-3, 4); break;
+                    case 2: step = random(-20, 21); break;
+                    case 3: step = (random(0, 8) == 0) ? random(-500, 500) : random(-3, 4); break;
+                }
+                values[f * columns + j] = (uint16_t)(values[(f - 1) * columns + j] + step);
+            }
+            if ((f & 15) == 0) yield();
+        }
+        return values;
+    }
+
+    // Upload rows as the poller produces them: registers in readMask drift
+    // slowly, unread ones stay 0xFFFF
+    static vector<uint16_t> registerSeries(uint32_t readMask, size_t rows) {
+        vector<uint16_t> values(rows * REGISTER_COUNT);
+        for (int j = 0; j < REGISTER_COUNT; ++j)
+            values[j] = (readMask & (1u << j)) ? (uint16_t)random(100, 2400) : 0xFFFF;
+        for (size_t f = 1; f < rows; ++f)
+            for (int j = 0; j < REGISTER_COUNT; ++j) {
+                uint16_t prev = values[(f - 1) * REGISTER_COUNT + j];
+                values[f * REGISTER_COUNT + j] =
+                    (readMask & (1u << j)) ? (uint16_t)(prev + random(-3, 4)) : prev;
+            }
+        return values;
+    }
+
+    ColumnBenchResult benchmarkColumns(int columns, size_t rows) {
+        ColumnBenchResult br{};
+        br.columns = columns;
+        br.rows = rows;
+        if (columns <= 0 || rows == 0) return br;
+
+        vector<uint16_t> values = syntheticSeries(columns, rows);
+        br.origBytes = values.size() * 2;
+
+        unsigned long t0 = micros();
+        auto c = TimeSeriesCompressor::compress(values, columns);
+        unsigned long t1 = micros();
+        auto r = TimeSeriesCompressor::decompress(c, columns);
+        unsigned long t2 = micros();
+
+        // The encoder writes v2; sealing repacks it the way compress() does
+        vector<uint8_t> buf(TimeSeriesCompressor::HEADER_BYTES + values.size() * 3);
+        TimeSeriesEncoder enc;
+        unsigned long t3 = micros();
+        enc.begin(buf.data(), buf.size(), columns);
+        for (size_t f = 0; f < rows; ++f) enc.append(&values[f * columns]);
+        unsigned long t4 = micros();
+        size_t sealed = TimeSeriesCompressor::repack(buf.data(), enc.size());
+
+        br.compBytes = c.size();
+        br.tCompressUs = t1 - t0;
+        br.tDecompressUs = t2 - t1;
+        br.tEncoderUs = t4 - t3;
+        br.lossless = (r == values);
+        br.encoderMatches = sealed == c.size() && memcmp(buf.data(), c.data(), c.size()) == 0;
+        return br;
+    }
+
+    void printColumnBenchmark(size_t rows) {
+        static const int COLUMN_COUNTS[] = {16, 32, 64};
+        Serial.printf("[Compression] %s benchmark: %u rows per run\n",
+                      TimeSeriesCompressor::name(), (unsigned)rows);
+        Serial.println("  cols   orig B   comp B   comp µs  decomp µs  enc µs  comp kB/s  lossless");
+        for (int cols : COLUMN_COUNTS) {
+            ColumnBenchResult r = benchmarkColumns(cols, rows);
+            float kbps = r.tCompressUs ? (float)r.origBytes * 1000000.0f / 1024.0f / r.tCompressUs : 0.0f;
+            Serial.printf("  %4d  %7u  %7u  %8lu  %9lu  %6lu  %9.1f  %s\n",
+                          r.columns, (unsigned)r.origBytes, (unsigned)r.compBytes,
+                          r.tCompressUs, r.tDecompressUs, r.tEncoderUs, kbps,
+                          (r.lossless && r.encoderMatches) ? "✅ YES" : "❌ NO");
+            yield();
+        }
+    }
+
+    void printCodecBenchmark(int columns, size_t rows) {
+        vector<uint16_t> values = syntheticSeries(columns, rows);
+        BenchResult results[] = {
+            Delta16VarCompressor::benchmark(values),
+            TimeSeriesCompressor::benchmark(values, columns),
+            ForPackCompressor::benchmark(values, columns),
+        };
+
+        Serial.printf("[Compression] Codec benchmark: %d columns x %u rows (%u B raw)\n",
+                      columns, (unsigned)rows, (unsigned)(values.size() * 2));
+        Serial.println("  codec          comp B  ratio  comp µs/sample  decomp µs/sample  lossless");
+        for (const BenchResult& r : results) {
+            float n = r.samples ? (float)r.samples : 1.0f;
+            Serial.printf("  %-13s %7u  %5.2f  %14.3f  %16.3f  %s\n",
+                          r.mode.c_str(), (unsigned)r.compBytes,
+                          r.compBytes ? (float)r.origBytes / r.compBytes : 0.0f,
+                          r.tCompressUs / n, r.tDecompressUs / n,
+                          r.lossless ? "✅ YES" : "❌ NO");
+            yield();
+        }
+    }
+
+    void printRunLengthBenchmark(size_t rows) {
+        struct Case { const char* label; uint32_t readMask; };
+        const Case cases[] = {
+            { "default (R2, R8)", (1u << 2) | (1u << 8) },
+            { "all registers",    (1u << REGISTER_COUNT) - 1 },
+        };
+
+        Serial.printf("[Compression] Run-length columns: %d registers x %u rows\n",
+                      REGISTER_COUNT, (unsigned)rows);
+        Serial.println("  config             v2 B  auto B  layout  B/row   µs");
+        for (const Case& c : cases) {
+            vector<uint16_t> values = registerSeries(c.readMask, rows);
+
+            vector<uint8_t> v2(TimeSeriesCompressor::HEADER_BYTES + values.size() * 3);
+            TimeSeriesEncoder enc;
+            enc.begin(v2.data(), v2.size(), REGISTER_COUNT);
+            for (size_t f = 0; f < rows; ++f) enc.append(&values[f * REGISTER_COUNT]);
+
+            unsigned long t0 = micros();
+            auto packed = TimeSeriesCompressor::compress(values, REGISTER_COUNT);
+            unsigned long t1 = micros();
+            bool lossless = TimeSeriesCompressor::decompress(packed, REGISTER_COUNT) == values;
+
+            Serial.printf("  %-17s %5u  %6u      v%u  %5.2f  %4lu  %s\n",
+                          c.label, (unsigned)enc.size(), (unsigned)packed.size(),
+                          packed.empty() ? 0 : packed[0], (float)packed.size() / rows,
+                          t1 - t0, lossless ? "✅" : "❌");
+            yield();
+        }
+    }
+
+    void printCodecSelectionBenchmark(size_t rows) {
+        struct Shape { const char* label; vector<uint16_t> values; };
+        vector<uint16_t> counter(rows * REGISTER_COUNT, 0xFFFF);
+        for (size_t f = 0; f < rows; ++f) counter[f * REGISTER_COUNT] = (uint16_t)(f * 40);
+        Shape shapes[] = {
+            { "default (R2, R8)", registerSeries((1u << 2) | (1u << 8), rows) },
+            { "all registers",    registerSeries((1u << REGISTER_COUNT) - 1, rows) },
+            { "mixed walk",       syntheticSeries(REGISTER_COUNT, rows) },
+            { "energy counter",   counter },
+        };
+
+        size_t count;
+        const Codec* all = codecs(count);
+        Serial.printf("[Compression] Codec selection: %d registers x %u rows, %u-row sample, budget %lu µs\n",
+                      REGISTER_COUNT, (unsigned)rows, (unsigned)CODEC_SAMPLE_ROWS,
+                      (unsigned long)CODEC_SELECT_BUDGET_US);
+        for (const Shape& sh : shapes) {
+            CodecChoice pick = selectCodec(sh.values, REGISTER_COUNT);
+            Serial.printf("  %-17s pick %-12s (%lu µs)", sh.label, pick.codec->name, pick.spentUs);
+            for (size_t k = 0; k < count; ++k) {
+                size_t n = min((size_t)CODEC_SAMPLE_ROWS, rows) * REGISTER_COUNT;
+                vector<uint16_t> sample(sh.values.begin(), sh.values.begin() + n);
+                size_t est = all[k].estimate(sample, REGISTER_COUNT, rows);
+                size_t actual = all[k].compress(sh.values, REGISTER_COUNT, nullptr).size();
+                Serial.printf("  %s %u/%u", all[k].name, (unsigned)est, (unsigned)actual);
+            }
+            Serial.println(" B est/actual");
+            yield();
+        }
+    }
+
+}  // namespace Compression
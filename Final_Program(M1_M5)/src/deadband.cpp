@@ -0,0 +1,243 @@
+#include "deadband.h"
+#include "register_map.h"
+#include "debug_utils.h"
+#include "slave_registry.h"
+#include <math.h>
+#include <string.h>
+
+namespace {
+    bool enabled = false;
+    uint16_t keyframeEvery = Deadband::DEFAULT_KEYFRAME_EVERY;
+
+    Deadband::Band bands[NUM_REGISTERS];
+    bool bandsReady = false;
+
+    // Bands in raw register units, 8 fractional bits: absolute widths are
+    // width * scale, percentages are the percentage itself (scale cancels)
+    uint32_t limitQ8[NUM_REGISTERS];
+
+    // What each slave last reported; bands are shared
+    struct SlaveState {
+        bool used;
+        uint8_t slave;
+        uint16_t cyclesSinceKeyframe;
+        uint16_t reported[NUM_REGISTERS];    // last raw value sent for each register
+        bool hasReported[NUM_REGISTERS];
+    };
+    SlaveState states[SlaveRegistry::MAX_SLAVES];
+
+    // A slave beyond the table takes over the last slot, starting from a keyframe
+    SlaveState& stateFor(uint8_t slave) {
+        for (auto& st : states) {
+            if (st.used && st.slave == slave) return st;
+        }
+        SlaveState* st = &states[SlaveRegistry::MAX_SLAVES - 1];
+        for (auto& free : states) {
+            if (!free.used) { st = &free; break; }
+        }
+        memset(st, 0, sizeof(*st));
+        st->used = true;
+        st->slave = slave;
+        return *st;
+    }
+
+    Deadband::Stats dbStats = {};
+
+    // Float only here, when a band changes; apply() compares integers
+    void updateLimit(int reg) {
+        const Deadband::Band& b = bands[reg];
+        float units = b.width * 256.0f;
+        if (b.type == Deadband::BAND_ABSOLUTE) units *= registerMap[reg].scale;
+        // Wider bands hold every value anyway; the cap keeps compares in 32 bits
+        float cap = b.type == Deadband::BAND_ABSOLUTE ? 16777216.0f : 65535.0f;
+        limitQ8[reg] = (uint32_t)lroundf(units < cap ? units : cap);
+    }
+
+    void ensureBands() {
+        if (bandsReady) return;
+        for (int i = 0; i < NUM_REGISTERS; i++) {
+            bands[i] = Deadband::defaultBand(i);
+            updateLimit(i);
+        }
+        bandsReady = true;
+    }
+
+    bool outsideBand(int reg, uint16_t value, const SlaveState& st) {
+        uint32_t last = st.reported[reg];
+        uint32_t diff = value > last ? value - last : last - value;
+        if (bands[reg].type == Deadband::BAND_PERCENT) {
+            return diff * 25600u > last * limitQ8[reg];
+        }
+        return diff * 256u > limitQ8[reg];
+    }
+}
+
+namespace Deadband {
+
+    void setEnabled(bool on) {
+        if (on && !enabled) forceKeyframe();
+        enabled = on;
+    }
+
+    bool isEnabled() { return enabled; }
+
+    void setKeyframeEvery(uint16_t cycles) { keyframeEvery = cycles ? cycles : 1; }
+    uint16_t getKeyframeEvery() { return keyframeEvery; }
+
+    // Typical measurement noise per unit; anything else reports every
+    // change of one scaled LSB
+    Band defaultBand(int reg) {
+        Band b = { BAND_ABSOLUTE, 0.0f };
+        if (reg < 0 || reg >= REGISTER_COUNT) return b;
+
+        const RegisterInfo& info = registerMap[reg];
+        switch (info.unit) {
+            case UNIT_VOLT:    b.width = 1.0f;  break;
+            case UNIT_AMP:     b.width = 0.2f;  break;
+            case UNIT_HERTZ:   b.width = 0.05f; break;
+            case UNIT_CELSIUS: b.width = 1.0f;  break;
+            case UNIT_PERCENT: b.width = 1.0f;  break;
+            case UNIT_WATT:    b.type = BAND_PERCENT; b.width = 2.0f; break;
+            default:           b.width = 1.0f / info.scale; break;
+        }
+        return b;
+    }
+
+    void setBand(int reg, BandType type, float width) {
+        if (reg < 0 || reg >= NUM_REGISTERS) return;
+        ensureBands();
+        bands[reg].type = type;
+        bands[reg].width = width < 0 ? 0 : width;
+        updateLimit(reg);
+    }
+
+    Band getBand(int reg) {
+        ensureBands();
+        return (reg >= 0 && reg < NUM_REGISTERS) ? bands[reg] : defaultBand(reg);
+    }
+
+    void resetBands() {
+        bandsReady = false;
+        ensureBands();
+    }
+
+    void updateFromConfig(const String& json) {
+        int key = json.indexOf("\"deadband\"");
+        if (key == -1) return;
+        int objStart = json.indexOf('{', key);
+        int objEnd = json.indexOf('}', objStart);
+        if (objStart == -1 || objEnd == -1) {
+            Serial.println("[Deadband] ⚠️ Invalid deadband object in config");
+            return;
+        }
+        String obj = json.substring(objStart, objEnd + 1);
+
+        int kf = obj.indexOf("\"keyframe_every\"");
+        if (kf != -1) {
+            int colon = obj.indexOf(':', kf);
+            long v = obj.substring(colon + 1).toInt();
+            if (v > 0) setKeyframeEvery((uint16_t)min(v, 65535L));
+        }
+
+        int arr = obj.indexOf("\"bands\"");
+        if (arr != -1) {
+            int arrayStart = obj.indexOf('[', arr);
+            int arrayEnd = obj.indexOf(']', arrayStart);
+            if (arrayStart != -1 && arrayEnd != -1) {
+                resetBands();
+                int idx = 0;
+                int lastPos = arrayStart + 1;
+                while (idx < NUM_REGISTERS && lastPos < arrayEnd) {
+                    int comma = obj.indexOf(',', lastPos);
+                    if (comma == -1 || comma > arrayEnd) comma = arrayEnd;
+                    String token = obj.substring(lastPos, comma);
+                    token.replace("\"", "");
+                    token.trim();
+
+                    bool percent = token.endsWith("%");
+                    if (percent) token.remove(token.length() - 1);
+                    float width = token.toFloat();
+                    if (width > 0) setBand(idx, percent ? BAND_PERCENT : BAND_ABSOLUTE, width);
+
+                    idx++;
+                    lastPos = comma + 1;
+                }
+            }
+        }
+
+        int en = obj.indexOf("\"enabled\"");
+        if (en != -1) {
+            int colon = obj.indexOf(':', en);
+            String rest = obj.substring(colon + 1);
+            rest.trim();
+            setEnabled(rest.startsWith("true") || rest.startsWith("1"));
+        }
+
+        Serial.printf("[Deadband] %s, keyframe every %u cycles\n",
+                      enabled ? "✅ Report-by-exception ON" : "Report-by-exception OFF", keyframeEvery);
+    }
+
+    void forceKeyframe() {
+        for (auto& st : states) {
+            for (int i = 0; i < NUM_REGISTERS; i++) st.hasReported[i] = false;
+            st.cyclesSinceKeyframe = 0;
+        }
+    }
+
+    bool apply(SnapshotRecord& row) {
+        if (!enabled) return true;
+        ensureBands();
+
+        SlaveState& st = stateFor(row.slave);
+        if (st.cyclesSinceKeyframe >= keyframeEvery) {
+            for (int i = 0; i < NUM_REGISTERS; i++) st.hasReported[i] = false;
+            st.cyclesSinceKeyframe = 0;
+        }
+        if (st.cyclesSinceKeyframe == 0) dbStats.keyframes++;
+        st.cyclesSinceKeyframe++;
+        dbStats.rows++;
+
+        int reportedCells = 0;
+        for (int i = 0; i < NUM_REGISTERS; i++) {
+            if (!row.has(i)) continue;   // unread this cycle
+            uint16_t v = row.raw[i];
+
+            if (!st.hasReported[i] || outsideBand(i, v, st)) {
+                st.reported[i] = v;
+                st.hasReported[i] = true;
+                reportedCells++;
+            } else {
+                row.hold(i);
+                dbStats.cellsHeld++;
+            }
+        }
+        dbStats.cellsReported += reportedCells;
+
+        if (reportedCells == 0) {
+            dbStats.rowsDropped++;
+            DEBUG_PRINTF("[Deadband] Row @ %u within band, not stored\n", row.epoch);
+            return false;
+        }
+        return true;
+    }
+
+    bool reported(uint8_t slave, int reg, uint16_t& value) {
+        if (reg < 0 || reg >= NUM_REGISTERS) return false;
+        for (const auto& st : states) {
+            if (!st.used || st.slave != slave || !st.hasReported[reg]) continue;
+            value = st.reported[reg];
+            return true;
+        }
+        return false;
+    }
+
+    const Stats& stats() { return dbStats; }
+
+    void printStats() {
+        if (!enabled) return;
+        Serial.printf("[Deadband] rows=%u dropped=%u keyframes=%u | cells reported=%u held=%u\n",
+                      dbStats.rows, dbStats.rowsDropped, dbStats.keyframes,
+                      dbStats.cellsReported, dbStats.cellsHeld);
+    }
+
+}  // namespace Deadband
@@ -0,0 +1,63 @@
+#include "frame_pool.h"
+#include "debug_utils.h"
+
+namespace {
+    FramePool::Frame slots[FramePool::SLOTS];
+    bool used[FramePool::SLOTS] = {false};
+    FramePool::Frame emptyFrame;          // what get(NONE) hands out
+    FramePool::Stats counters = {};
+}
+
+namespace FramePool {
+
+    Handle acquire() {
+        for (uint8_t i = 0; i < SLOTS; i++) {
+            if (used[i]) continue;
+            used[i] = true;
+            slots[i].len = 0;
+            counters.acquires++;
+            counters.inUse++;
+            if (counters.inUse > counters.highWater) counters.highWater = counters.inUse;
+            return i;
+        }
+        counters.exhausted++;
+        DEBUG_PRINTF("[FramePool] ⚠️ All %d slots in use, frame dropped.\n", SLOTS);
+        return NONE;
+    }
+
+    Handle copy(const uint8_t* data, size_t len) {
+        if (len > SLOT_BYTES) {
+            counters.oversized++;
+            DEBUG_PRINTF("[FramePool] ⚠️ %d-byte frame exceeds a %d-byte slot.\n", (int)len, (int)SLOT_BYTES);
+            return NONE;
+        }
+        Handle h = acquire();
+        if (h == NONE) return NONE;
+        memcpy(slots[h].bytes, data, len);
+        slots[h].len = (uint16_t)len;
+        return h;
+    }
+
+    void release(Handle h) {
+        if (h >= SLOTS || !used[h]) return;
+        used[h] = false;
+        counters.inUse--;
+    }
+
+    Frame& get(Handle h) {
+        if (h >= SLOTS) {
+            emptyFrame.len = 0;
+            return emptyFrame;
+        }
+        return slots[h];
+    }
+
+    const Stats& stats() { return counters; }
+
+    void printStats() {
+        DEBUG_PRINTF("[FramePool] Slots: %u/%u in use, high water %u, %u acquired, %u exhausted, %u oversized\n",
+                     counters.inUse, SLOTS, counters.highWater, counters.acquires,
+                     counters.exhausted, counters.oversized);
+    }
+
+}  // namespace FramePool
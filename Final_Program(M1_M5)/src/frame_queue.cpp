@@ -1,4 +1,26 @@
 #include "frame_queue.h"
 
 // Define the global frame queue
-std::vector<std::vector<uint8_t>> frameQueue;
+FrameQueue frameQueue;
+
+bool FrameQueue::push(FramePool::Handle h) {
+    if (h == FramePool::NONE) return false;
+    if (count >= CAPACITY) {
+        FramePool::release(h);
+        return false;
+    }
+    handles[count++] = h;
+    return true;
+}
+
+uint8_t FrameQueue::take(FramePool::Handle* out) {
+    uint8_t n = count;
+    memcpy(out, handles, n);
+    count = 0;
+    return n;
+}
+
+void FrameQueue::clear() {
+    for (uint8_t i = 0; i < count; i++) FramePool::release(handles[i]);
+    count = 0;
+}
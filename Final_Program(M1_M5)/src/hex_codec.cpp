@@ -0,0 +1,215 @@
+#include "hex_codec.h"
+#include "modbus_utils.h"
+#include "debug_utils.h"
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <string.h>
+
+#if HEX_CODEC_COUNT_ALLOCS
+// Linker-wrapped allocator entry points (see HEX_CODEC_COUNT_ALLOCS)
+extern "C" {
+    void* __real_malloc(size_t size);
+    void* __real_realloc(void* ptr, size_t size);
+    void __real_free(void* ptr);
+
+    static volatile uint32_t heapAllocs = 0;
+
+    void* __wrap_malloc(size_t size) {
+        heapAllocs++;
+        return __real_malloc(size);
+    }
+    void* __wrap_realloc(void* ptr, size_t size) {
+        heapAllocs++;
+        return __real_realloc(ptr, size);
+    }
+    void __wrap_free(void* ptr) {
+        __real_free(ptr);
+    }
+}
+#endif
+
+namespace {
+
+    const char HEX_DIGITS[] = "0123456789ABCDEF";
+    const char FRAME_KEY[] = "\"frame\"";
+
+    inline int nibble(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    }
+
+    inline bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    uint32_t allocCount() {
+#if HEX_CODEC_COUNT_ALLOCS
+        return heapAllocs;
+#else
+        return 0;
+#endif
+    }
+
+    // Previous InverterUtils conversions, kept for the benchmark
+    String legacyFrameToJson(const std::vector<uint8_t>& frame) {
+        std::ostringstream oss;
+        oss << std::uppercase << std::hex << std::setfill('0');
+        for (size_t i = 0; i < frame.size(); i++) {
+            oss << std::setw(2) << (int)frame[i];
+        }
+        String hexFrame = String(oss.str().c_str());
+        return "{\"frame\":\"" + hexFrame + "\"}";
+    }
+
+    std::vector<uint8_t> legacyJsonToFrame(const String& response) {
+        int startIdx = response.indexOf("\"frame\":\"");
+        if (startIdx == -1) return {};
+        startIdx += 9;
+        int endIdx = response.indexOf("\"", startIdx);
+        if (endIdx == -1) return {};
+
+        String hexString = response.substring(startIdx, endIdx);
+        std::vector<uint8_t> frame;
+        for (int i = 0; i < (int)hexString.length(); i += 2) {
+            String byteStr = hexString.substring(i, i + 2);
+            frame.push_back((uint8_t)strtol(byteStr.c_str(), nullptr, 16));
+        }
+        return frame;
+    }
+}
+
+namespace HexCodec {
+
+    size_t encode(const uint8_t* src, size_t len, char* dst, size_t cap) {
+        if (cap < 2 * len + 1) return 0;
+        char* out = dst;
+        for (size_t i = 0; i < len; i++) {
+            *out++ = HEX_DIGITS[src[i] >> 4];
+            *out++ = HEX_DIGITS[src[i] & 0x0F];
+        }
+        *out = '\0';
+        return 2 * len;
+    }
+
+    int decode(const char* hex, size_t len, uint8_t* dst, size_t cap) {
+        if ((len & 1) || len / 2 > cap) return -1;
+        for (size_t i = 0; i < len; i += 2) {
+            int hi = nibble(hex[i]);
+            int lo = nibble(hex[i + 1]);
+            if (hi < 0 || lo < 0) return -1;
+            dst[i / 2] = (uint8_t)((hi << 4) | lo);
+        }
+        return (int)(len / 2);
+    }
+
+    size_t writeFrameJson(const uint8_t* frame, size_t len, char* dst, size_t cap) {
+        size_t total = JSON_ENVELOPE_CHARS + 2 * len;
+        if (cap < total + 1) return 0;
+
+        memcpy(dst, "{\"frame\":\"", 10);
+        encode(frame, len, dst + 10, cap - 10);
+        dst[10 + 2 * len] = '"';
+        dst[11 + 2 * len] = '}';
+        dst[total] = '\0';
+        return total;
+    }
+
+    int readFrameJson(const char* json, size_t len, uint8_t* dst, size_t cap) {
+        const size_t keyLen = sizeof(FRAME_KEY) - 1;
+        if (len < keyLen) return -1;
+
+        for (size_t i = 0; i + keyLen <= len; i++) {
+            if (json[i] != '"' || memcmp(json + i, FRAME_KEY, keyLen) != 0) continue;
+
+            size_t p = i + keyLen;
+            while (p < len && isSpace(json[p])) p++;
+            if (p >= len || json[p] != ':') continue;
+            p++;
+            while (p < len && isSpace(json[p])) p++;
+            if (p >= len || json[p] != '"') return -1;
+            p++;
+
+            size_t start = p;
+            while (p < len && json[p] != '"') p++;
+            if (p >= len) {
+                DEBUG_PRINTLN("[HexCodec] Error: unterminated frame string.");
+                return -1;
+            }
+            return decode(json + start, p - start, dst, cap);
+        }
+
+        DEBUG_PRINTLN("[HexCodec] Error: 'frame' key not found.");
+        return -1;
+    }
+
+    AllocBenchResult benchmarkAllocations(size_t transactions) {
+        AllocBenchResult br{};
+        br.transactions = transactions;
+        br.counted = HEX_CODEC_COUNT_ALLOCS;
+        br.identical = true;
+
+        uint32_t legacyCount = 0, codecCount = 0;
+        std::vector<uint8_t> request, response;
+        char json[MAX_JSON_CHARS];
+        uint8_t frame[MAX_FRAME_BYTES];
+
+        for (size_t t = 0; t < transactions; t++) {
+            // FC03 request and a matching response with random register values
+            uint16_t start = (uint16_t)random(0, 100);
+            uint8_t qty = (uint8_t)random(1, 64);
+            request = { 0x11, 0x03, (uint8_t)(start >> 8), (uint8_t)start, 0x00, qty };
+            Modbus::appendCRC(request);
+            response = { 0x11, 0x03, (uint8_t)(qty * 2) };
+            for (int i = 0; i < qty * 2; i++) response.push_back((uint8_t)random(0, 256));
+            Modbus::appendCRC(response);
+            String responseJson = legacyFrameToJson(response);
+
+            // Old path: ostringstream + String concatenation, substring per byte
+            uint32_t a0 = allocCount();
+            unsigned long t0 = micros();
+            String oldJson = legacyFrameToJson(request);
+            std::vector<uint8_t> oldFrame = legacyJsonToFrame(responseJson);
+            unsigned long t1 = micros();
+            uint32_t a1 = allocCount();
+
+            // New path: fixed buffers on the stack
+            size_t jsonLen = writeFrameJson(request.data(), request.size(), json, sizeof(json));
+            int n = readFrameJson(responseJson.c_str(), responseJson.length(), frame, sizeof(frame));
+            unsigned long t2 = micros();
+            uint32_t a2 = allocCount();
+
+            legacyCount += a1 - a0;
+            codecCount  += a2 - a1;
+            br.legacyUs += t1 - t0;
+            br.codecUs  += t2 - t1;
+
+            if (jsonLen != oldJson.length() || memcmp(json, oldJson.c_str(), jsonLen) != 0 ||
+                n != (int)oldFrame.size() || memcmp(frame, oldFrame.data(), n) != 0) {
+                br.identical = false;
+            }
+            if ((t & 15) == 0) yield();
+        }
+
+        if (transactions > 0) {
+            br.legacyAllocs = (float)legacyCount / transactions;
+            br.codecAllocs  = (float)codecCount / transactions;
+        }
+        return br;
+    }
+
+    void printAllocBenchmark(const AllocBenchResult& r) {
+        Serial.printf("[HexCodec] Frame/JSON conversion benchmark: %u transactions\n",
+                      (unsigned)r.transactions);
+        if (r.counted) {
+            Serial.printf("  Allocs/tx : legacy %.1f → codec %.1f\n", r.legacyAllocs, r.codecAllocs);
+        } else {
+            Serial.println("  Allocs/tx : not counted (build env:nodemcuv2_allocbench)");
+        }
+        Serial.printf("  Legacy    : %lu µs\n", r.legacyUs);
+        Serial.printf("  Codec     : %lu µs\n", r.codecUs);
+        Serial.printf("  Identical : %s\n", r.identical ? "✅ YES" : "❌ NO");
+    }
+}
@@ -0,0 +1,49 @@
+#include "http_json_transport.h"
+#include "inverterSIM_utils.h"
+#include "debug_utils.h"
+
+HttpJsonTransport::HttpJsonTransport(InverterSession* session)
+    : _session(session), _ownsSession(session == nullptr) {
+    if (_ownsSession) _session = new InverterSession(INVERTER_API_BASE_URL, INVERTER_API_KEY);
+}
+
+HttpJsonTransport::~HttpJsonTransport() {
+    if (_ownsSession) delete _session;
+}
+
+bool HttpJsonTransport::begin(const uint8_t* frame, size_t len) {
+    char json[HexCodec::MAX_JSON_CHARS];
+    size_t jsonLen = HexCodec::writeFrameJson(frame, len, json, sizeof(json));
+    if (jsonLen == 0) return false;
+
+    const char* path = (len > 1 && frame[1] == 0x03) ? "/api/inverter/read"
+                                                     : "/api/inverter/write";
+    return _session->beginPost(path, json, jsonLen);
+}
+
+InverterTransport::Status HttpJsonTransport::poll(uint8_t* response, size_t cap, size_t& len) {
+    InverterSession::PollStatus st = _session->poll(_response);
+    if (st == InverterSession::POLL_PENDING) return PENDING;
+    if (st == InverterSession::POLL_FAILED) return FAILED;
+
+    int n = HexCodec::readFrameJson(_response.c_str(), _response.length(), response, cap);
+    if (n < 0) {
+        DEBUG_PRINTLN("[HttpJsonTransport] Response has no valid frame.");
+        return FAILED;
+    }
+    len = (size_t)n;
+    return DONE;
+}
+
+InverterTransport::Stats HttpJsonTransport::stats() const {
+    const InverterSession::Stats& s = _session->stats();
+    Stats out{};
+    out.requests = s.requests;
+    out.failures = s.failures;
+    out.connects = s.connects;
+    out.bytesOut = s.bytesOut;
+    out.bytesIn  = s.bytesIn;
+    out.maxUs    = s.maxUs;
+    out.totalUs  = s.totalUs;
+    return out;
+}
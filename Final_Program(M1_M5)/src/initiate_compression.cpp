@@ -4,63 +4,198 @@
 #include "buffer.h"
 #include "upload_manager.h"
 #include "cloud_decode_utils.h"
+#include "modbus_utils.h"
+#include "slave_registry.h"
 #include <Arduino.h>
 #include <vector>
-#include "power_estimator.h"
 
-std::vector<uint8_t> initiateCompression() {
-    const auto& currentBuffer = Buffer::getAll();
+namespace {
+    CompressionStats compStats = {};
 
-    if (currentBuffer.empty()) {
-        DEBUG_PRINTLN("[UploadManager] ⚠️ No data in buffer to upload.");
-        return {}; // return empty vector
+    // Last row of a batch, as the reference for the next one
+    struct Reference {
+        bool valid;
+        uint8_t device;
+        uint32_t epoch;
+        uint16_t row[REGISTER_COUNT];
+        uint16_t crc;               // Buffer::rowCrc() of epoch + row
+    };
+
+    // Per device: the last row the server holds
+    struct DeviceReference {
+        Reference acked;
+        uint16_t sinceKeyframe;     // referenced payloads since the last keyframe
+    };
+    DeviceReference devices[SlaveRegistry::MAX_SLAVES] = {};
+    Reference pending = {};         // last row of the payload built last
+
+    // A device beyond the table takes over the last entry (keyframe next)
+    DeviceReference& referenceFor(uint8_t device) {
+        DeviceReference* spare = nullptr;
+        for (auto& d : devices) {
+            if (d.acked.device == device) return d;
+            if (!d.acked.valid && !spare) spare = &d;
+        }
+        if (!spare) spare = &devices[SlaveRegistry::MAX_SLAVES - 1];
+        *spare = DeviceReference{};
+        spare->acked.device = device;
+        return *spare;
     }
 
-    std::vector<uint16_t> rawValues;
-
-    // 🔹 Flatten the buffer
-    for (const auto& snap : currentBuffer) {
-        int year, month, day, hour, minute, second;
-
-        if (sscanf(snap.timestamp.c_str(), "%d-%d-%d %d:%d:%d",
-                   &year, &month, &day, &hour, &minute, &second) == 6) {
-            rawValues.push_back(year);
-            rawValues.push_back(month);
-            rawValues.push_back(day);
-            rawValues.push_back(hour);
-            rawValues.push_back(minute);
-            rawValues.push_back(second);
-        } else {
-            rawValues.insert(rawValues.end(), {0, 0, 0, 0, 0, 0});
+    // Upload payload header, epoch column and register rows (layout in
+    // initiate_compression.h)
+    void layoutPayload(std::vector<uint8_t>& out, const Buffer::Block& block,
+                       const Compression::Codec& codec, const Reference* ref,
+                       const uint8_t* rows, size_t rowBytes) {
+        out.resize(UPLOAD_HEADER_BYTES + codec.paramBytes + (ref ? UPLOAD_REFERENCE_BYTES : 0) +
+                   block.timeLength + rowBytes);
+        uint8_t* o = out.data();
+        *o++ = UPLOAD_PAYLOAD_VERSION;
+        *o++ = codec.id;
+        *o++ = UPLOAD_FLAG_RAW | (ref ? UPLOAD_FLAG_REFERENCED : 0);
+        *o++ = block.slave;
+        *o++ = (uint8_t)(REGISTER_COUNT >> 8);
+        *o++ = (uint8_t)(REGISTER_COUNT & 0xFF);
+        *o++ = (uint8_t)(block.rows >> 8);
+        *o++ = (uint8_t)(block.rows & 0xFF);
+        *o++ = codec.paramBytes;
+        for (uint8_t k = 0; k < codec.paramBytes; k++) *o++ = codec.params[k];
+        if (ref) {
+            *o++ = (uint8_t)(ref->crc >> 8);
+            *o++ = (uint8_t)(ref->crc & 0xFF);
         }
+        *o++ = (uint8_t)(block.timeLength >> 8);
+        *o++ = (uint8_t)(block.timeLength & 0xFF);
+        // Epoch column is stored backwards from the end of the block
+        for (size_t k = 0; k < block.timeLength; k++)
+            *o++ = block.data[Buffer::BLOCK_BYTES - 1 - k];
+        memcpy(o, rows, rowBytes);
+    }
+
+    // Decodes the payload and compares the CRC of its rows with the one
+    // the buffer kept while appending them
+    bool verifyPayload(const std::vector<uint8_t>& payload, const Buffer::Block& block,
+                       const Reference* ref, std::vector<DecodedSnapshot>* decodedOut) {
+        DecodedSnapshot refRow;
+        if (ref) {
+            refRow.epoch = ref->epoch;
+            refRow.registers.assign(ref->row, ref->row + REGISTER_COUNT);
+        }
+        auto decoded = decodeUploadPayload(payload, REGISTER_COUNT, ref ? &refRow : nullptr);
+        uint16_t crc = Modbus::CRC_INIT;
+        for (const auto& snap : decoded) crc = Buffer::rowCrc(crc, snap.epoch, snap.registers.data());
 
-        for (float v : snap.values) {
-            rawValues.push_back((v < 0.0f) ? 0xFFFF : static_cast<uint16_t>(v));
+        bool ok = decoded.size() == block.rows && crc == block.crc;
+        compStats.verified++;
+        if (!ok) {
+            compStats.verifyFailures++;
+            Serial.printf("[UploadManager] ❌ Payload verify failed: %u/%u rows, CRC %04X/%04X\n",
+                          (unsigned)decoded.size(), block.rows, crc, block.crc);
         }
+        if (decodedOut) decodedOut->swap(decoded);
+        return ok;
+    }
+}
+
+std::vector<uint8_t> initiateCompression(const Buffer::Block& block, bool keyframe, bool rebuild) {
+    if (block.rows == 0) {
+        DEBUG_PRINTLN("[UploadManager] ⚠️ No data in buffer to upload.");
+        return {}; // return empty vector
     }
 
-    DEBUG_PRINTF("[UploadManager] 📦 Flattened %d values for compression\n",
-                 (int)rawValues.size());
+    unsigned long t0 = micros();
+    const Compression::Codec* buffered = Compression::findCodec(Compression::CODEC_TIME_SERIES);
+    const Compression::Codec* codec = buffered;
+    std::vector<uint8_t> stored(block.data, block.data + block.length);
+    std::vector<uint16_t> values;     // whole batch, only when needed
+
+    // 🔹 The block kept its last row, which may become the next reference
+    const Reference* ref = nullptr;
+    DeviceReference& device = referenceFor(block.slave);
+    pending.device = block.slave;
+    pending.valid = true;
+    pending.epoch = block.lastEpoch;
+    memcpy(pending.row, block.lastRow, sizeof(pending.row));
+    pending.crc = Buffer::rowCrc(Modbus::CRC_INIT, pending.epoch, pending.row);
+#if UPLOAD_CROSS_BATCH_DELTA
+    bool keyframeDue = UPLOAD_KEYFRAME_EVERY > 0 && device.sinceKeyframe + 1 >= UPLOAD_KEYFRAME_EVERY;
+    if (!keyframe && !keyframeDue && device.acked.valid) ref = &device.acked;
+#endif
+
+    // 🔹 Rows were compressed while buffering; estimate the other codecs
+    // from a decoded prefix, and only recompress when one should win
+    std::vector<uint16_t> sample = Compression::TimeSeriesCompressor::decompressPrefix(stored, CODEC_SAMPLE_ROWS);
+    Compression::CodecChoice choice =
+        Compression::selectCodecFromSample(sample, REGISTER_COUNT, block.rows);
 
-    Serial.println("[DEBUG] RawValues (uint16_t) before compression:");
-    size_t rawLimit = min(rawValues.size(), (size_t)50);  // Limit to 50 values
-    for (size_t i = 0; i < rawLimit; i++) {
-        Serial.printf("%u ", rawValues[i]);
-        if ((i + 1) % 10 == 0) { Serial.print(" | "); yield(); }  // Separator every 10 values
+    // 🔹 A referenced payload re-encodes the whole batch against the
+    // reference; that full decode + encode is counted separately
+    std::vector<uint8_t> alt;
+    bool recode = ref || (choice.codec != buffered && choice.estimatedBytes < block.length);
+    if (recode) {
+        unsigned long r0 = micros();
+        values = Compression::TimeSeriesCompressor::decompress(stored, REGISTER_COUNT);
+        bool whole = values.size() == (size_t)block.rows * REGISTER_COUNT;
+        if (ref) {
+            if (whole) alt = choice.codec->compress(values, REGISTER_COUNT, ref->row);
+            if (alt.empty()) ref = nullptr;
+            else codec = choice.codec;
+        }
+        if (!ref && whole && choice.codec != buffered && choice.estimatedBytes < block.length) {
+            alt = choice.codec->compress(values, REGISTER_COUNT, nullptr);
+            if (!alt.empty() && alt.size() < block.length) codec = choice.codec;
+        }
+        compStats.fullDecodes++;
+        compStats.reencodeUs += micros() - r0;
     }
-    if (rawValues.size() > 50) Serial.printf("... (%d more)", rawValues.size() - 50);
-    Serial.println();
-    Serial.flush();
 
-    // 🔹 Compress and benchmark
-    auto result = Compression::TimeSeriesCompressor::benchmark(rawValues, REGISTER_COUNT + 6);
-    
-    // ===== Power Estimator: add compression CPU time =====
-    pe_addCpuMs(result.tCompressUs / 1000UL);
+    // 🔹 Lay out the payload once
+    std::vector<uint8_t> compressed;
+    if (codec == buffered && !ref) layoutPayload(compressed, block, *codec, nullptr, block.data, block.length);
+    else                           layoutPayload(compressed, block, *codec, ref, alt.data(), alt.size());
+    unsigned long encodeUs = micros() - t0;
+
+    if (!rebuild) compStats.batches++;
 
+    // 🔹 Sampled lossless check; a recompressed payload that fails it is
+    // sent with the buffered rows instead
+#if COMPRESSION_DIAGNOSTICS
+    bool verify = true;
+#elif UPLOAD_VERIFY_EVERY > 0
+    bool verify = (compStats.batches - 1) % UPLOAD_VERIFY_EVERY == 0;
+#else
+    bool verify = false;
+#endif
+    std::vector<DecodedSnapshot> decoded;
+    bool decodes = true;
+    if (verify) {
+        decodes = verifyPayload(compressed, block, ref, COMPRESSION_DIAGNOSTICS ? &decoded : nullptr);
+        if (!decodes && (codec != buffered || ref)) {
+            codec = buffered;
+            ref = nullptr;
+            layoutPayload(compressed, block, *codec, nullptr, block.data, block.length);
+        }
+    }
+    device.sinceKeyframe = ref ? device.sinceKeyframe + 1 : 0;
 
-    std::vector<uint8_t> compressed = Compression::TimeSeriesCompressor::compress(rawValues, REGISTER_COUNT + 6);
+    // Against the old layout: six date/time words + registers per row
+    size_t origBytes = (size_t)block.rows * (6 + Buffer::ROW_WORDS) * 2;
+    if (!rebuild) {
+        compStats.rows += block.rows;
+        compStats.rawBytes += origBytes;
+        compStats.payloadBytes += compressed.size();
+        compStats.encodeUs += encodeUs;
+        if (codec != buffered) compStats.recompressed++;
+        if (ref) compStats.referenced++;
+    }
+
+#if COMPRESSION_DIAGNOSTICS || DEBUG_ENABLED
+    float ratio = (origBytes > 0)
+                    ? (100.0f * (origBytes - compressed.size()) / origBytes)
+                    : 0.0f;
+#endif
 
+#if COMPRESSION_DIAGNOSTICS
     Serial.printf("[DEBUG] Compressed bytes:\n");
     size_t compLimit = min(compressed.size(), (size_t)64);
     for (size_t i = 0; i < compLimit; i++) {
@@ -71,33 +206,56 @@ std::vector<uint8_t> initiateCompression() {
     Serial.println();
     Serial.flush();
 
-    // 🔹 Verify decompression and decoding
-    auto decompressed = Compression::TimeSeriesCompressor::decompress(compressed, REGISTER_COUNT + 6);
-    auto decoded = decodeDecompressedData(decompressed, REGISTER_COUNT);
     printDecodedSnapshots(decoded);
 
-    Serial.println("[DEBUG] Decompressed values:");
-    size_t decomLimit = min(decompressed.size(), (size_t)50);
-    for (size_t i = 0; i < decomLimit; i++) {
-        Serial.printf("%u ", decompressed[i]);
-        if ((i + 1) % 10 == 0) { Serial.print(" | "); yield(); }
-    }
-    if (decompressed.size() > 50) Serial.printf("... (%d more)", decompressed.size() - 50);
-    Serial.println();
-    Serial.flush();
+    Serial.println("\n[UploadManager] 🗜️ Compression Summary:");
+    Serial.printf("  Device          : slave %u\n", block.slave);
+    Serial.printf("  Method          : %s%s\n", codec->name, ref ? " (referenced)" : "");
+    Serial.printf("  Codec Pick      : %s, est %u B in %lu µs\n",
+                  choice.codec->name, (unsigned)choice.estimatedBytes, choice.spentUs);
+    Serial.printf("  Samples         : %u\n", (unsigned)(origBytes / 2));
+    Serial.printf("  Original Size   : %u bytes\n", (unsigned)origBytes);
+    Serial.printf("  Compressed Size : %u bytes\n", (unsigned)compressed.size());
+    Serial.printf("  Reduction       : %.2f%%\n", ratio);
+    Serial.printf("  Encode Time     : %lu µs\n", encodeUs);
+    Serial.printf("  Decode Verify   : %s\n", decodes ? "✅ YES" : "❌ NO");
+#elif DEBUG_ENABLED
+    DEBUG_PRINTF("[UploadManager] 🗜️ Slave %u: %u rows → %u B (%s%s, -%.1f%%, %lu µs%s)\n",
+                 block.slave, block.rows, (unsigned)compressed.size(), codec->name, ref ? " ref" : "",
+                 ratio, encodeUs,
+                 verify ? (decodes ? ", verified" : ", VERIFY FAILED") : "");
+#endif
 
-    float ratio = (result.origBytes > 0)
-                    ? (100.0f * (result.origBytes - result.compBytes) / result.origBytes)
-                    : 0.0f;
+    return compressed;
+}
 
-    DEBUG_PRINTLN("\n[UploadManager] 🗜️ Compression Summary:");
-    DEBUG_PRINTF("  Method          : %s\n", result.mode.c_str());
-    DEBUG_PRINTF("  Samples         : %u\n", result.samples);
-    DEBUG_PRINTF("  Original Size   : %u bytes\n", result.origBytes);
-    DEBUG_PRINTF("  Compressed Size : %u bytes\n", result.compBytes);
-    DEBUG_PRINTF("  Reduction       : %.2f%%\n", ratio);
-    DEBUG_PRINTF("  CPU Time        : %lu µs\n", result.tCompressUs);
-    DEBUG_PRINTF("  Lossless Verify : %s\n", result.lossless ? "✅ YES" : "❌ NO");
+bool isReferencedPayload(const std::vector<uint8_t>& payload) {
+    return payload.size() > 2 && payload[0] == UPLOAD_PAYLOAD_VERSION &&
+           (payload[2] & UPLOAD_FLAG_REFERENCED);
+}
 
-    return compressed;
+uint8_t payloadDevice(const std::vector<uint8_t>& payload) {
+    if (payload.size() > 3 && payload[0] == UPLOAD_PAYLOAD_VERSION) return payload[3];
+    return UPLOAD_LEGACY_DEVICE;
+}
+
+void acknowledgeUpload() {
+    referenceFor(pending.device).acked = pending;
+}
+
+void dropUploadReference() {
+    referenceFor(pending.device).acked.valid = false;
+}
+
+const CompressionStats& compressionStats() { return compStats; }
+
+void printCompressionStats() {
+    const CompressionStats& s = compStats;
+    float ratio = s.payloadBytes ? (float)s.rawBytes / s.payloadBytes : 0.0f;
+    Serial.printf("[Compression] batches=%u rows=%u %u→%u B (x%.2f) recompressed=%u referenced=%u "
+                  "avg %lu µs | full decodes=%u (%lu µs) | verified=%u failed=%u\n",
+                  s.batches, s.rows, s.rawBytes, s.payloadBytes, ratio, s.recompressed, s.referenced,
+                  s.batches ? (unsigned long)(s.encodeUs / s.batches) : 0UL,
+                  s.fullDecodes, (unsigned long)s.reencodeUs,
+                  s.verified, s.verifyFailures);
 }
@@ -1,111 +1,69 @@
 #include "inverterSIM_utils.h"
-#include <sstream>
-#include <iomanip>
-#include <ESP8266HTTPClient.h>
-#include <WiFiClient.h>
+#include "hex_codec.h"
 #include "debug_utils.h"
 
 namespace InverterUtils {
 
     ////////////////////// Convert Modbus Frame → JSON //////////////////////
     String frameToJson(const vector<uint8_t>& frame) {
-        std::ostringstream oss;
-        oss << std::uppercase << std::hex << std::setfill('0');
-        for (size_t i = 0; i < frame.size(); i++) {
-            oss << std::setw(2) << (int)frame[i];
+        char json[HexCodec::MAX_JSON_CHARS];
+        if (HexCodec::writeFrameJson(frame.data(), frame.size(), json, sizeof(json)) == 0) {
+            DEBUG_PRINTLN("[InverterUtils] Error: frame too long for JSON buffer.");
+            return "";
         }
 
-        String hexFrame = String(oss.str().c_str());
-        String jsonFrame = "{\"frame\":\"" + hexFrame + "\"}";
-
         DEBUG_PRINTLN("[InverterUtils] Frame converted to JSON:");
-        DEBUG_PRINTLN(jsonFrame);
-        return jsonFrame;
+        DEBUG_PRINTLN(json);
+        return String(json);
     }
 
     ////////////////////// Convert JSON → Modbus Frame //////////////////////
     vector<uint8_t> jsonToFrame(const String& response) {
-        int startIdx = response.indexOf("\"frame\":\"");
-        if (startIdx == -1) {
-            DEBUG_PRINTLN("[InverterUtils] Error: 'frame' key not found.");
-            return {};
-        }
-        startIdx += 9;
-        int endIdx = response.indexOf("\"", startIdx);
-        if (endIdx == -1) {
+        uint8_t buf[HexCodec::MAX_FRAME_BYTES];
+        int len = HexCodec::readFrameJson(response.c_str(), response.length(), buf, sizeof(buf));
+        if (len < 0) {
             DEBUG_PRINTLN("[InverterUtils] Error: Invalid JSON format.");
             return {};
         }
 
-        String hexString = response.substring(startIdx, endIdx);
-        vector<uint8_t> frame;
-
-        for (int i = 0; i < hexString.length(); i += 2) {
-            String byteStr = hexString.substring(i, i + 2);
-            uint8_t byteVal = (uint8_t) strtol(byteStr.c_str(), nullptr, 16);
-            frame.push_back(byteVal);
-        }
-
         DEBUG_PRINTLN("[InverterUtils] JSON converted to Modbus frame.");
-        return frame;
+        return vector<uint8_t>(buf, buf + len);
+    }
+
+    ////////////////////// Shared keep-alive session //////////////////////
+    InverterSession& getSession() {
+        static InverterSession session(INVERTER_API_BASE_URL, INVERTER_API_KEY);
+        return session;
     }
 
     ////////////////////// Cloud API: Read //////////////////////
     String readAPI(const String& jsonFrame, const String& apiKey) {
-        WiFiClient client;
-        HTTPClient http;
-        String response;
-        String url = "http://20.15.114.131:8080/api/inverter/read";
-
         DEBUG_PRINTLN("[InverterUtils] Sending READ request...");
-        DEBUG_PRINTF("URL: %s\n", url.c_str());
-
-        if (http.begin(client, url)) {
-            http.addHeader("Content-Type", "application/json");
-            http.addHeader("Authorization", apiKey);
-
-            int httpCode = http.POST(jsonFrame);
-            DEBUG_PRINTF("[InverterUtils] HTTP Response Code: %d\n", httpCode);
-
-            if (httpCode > 0) {
-                response = http.getString();
-                DEBUG_PRINTLN("[InverterUtils] Response:");
-                DEBUG_PRINTLN(response);
-            } else {
-                DEBUG_PRINTLN("[InverterUtils] HTTP POST failed!");
-            }
-
-            http.end();
+        InverterSession& session = getSession();
+        session.setApiKey(apiKey);
+        String response = session.post("/api/inverter/read", jsonFrame);
+
+        if (response.length() > 0) {
+            DEBUG_PRINTLN("[InverterUtils] Response:");
+            DEBUG_PRINTLN(response);
+        } else {
+            DEBUG_PRINTLN("[InverterUtils] HTTP POST failed!");
         }
         return response;
     }
 
     ////////////////////// Cloud API: Write //////////////////////
     String writeAPI(const String& jsonFrame, const String& apiKey) {
-        WiFiClient client;
-        HTTPClient http;
-        String response;
-        String url = "http://20.15.114.131:8080/api/inverter/write";
-
         DEBUG_PRINTLN("[InverterUtils] Sending WRITE request...");
-        DEBUG_PRINTF("URL: %s\n", url.c_str());
-
-        if (http.begin(client, url)) {
-            http.addHeader("Content-Type", "application/json");
-            http.addHeader("Authorization", apiKey);
-
-            int httpCode = http.POST(jsonFrame);
-            DEBUG_PRINTF("[InverterUtils] HTTP Response Code: %d\n", httpCode);
-
-            if (httpCode > 0) {
-                response = http.getString();
-                DEBUG_PRINTLN("[InverterUtils] Response:");
-                DEBUG_PRINTLN(response);
-            } else {
-                DEBUG_PRINTLN("[InverterUtils] HTTP POST failed!");
-            }
-
-            http.end();
+        InverterSession& session = getSession();
+        session.setApiKey(apiKey);
+        String response = session.post("/api/inverter/write", jsonFrame);
+
+        if (response.length() > 0) {
+            DEBUG_PRINTLN("[InverterUtils] Response:");
+            DEBUG_PRINTLN(response);
+        } else {
+            DEBUG_PRINTLN("[InverterUtils] HTTP POST failed!");
         }
         return response;
     }
@@ -7,69 +7,136 @@
 #include "modbus_utils.h"
 #include "register_map.h"
 #include "inverterSIM_utils.h"
+#include "protocol_adapter.h"
+#include "transaction_engine.h"
+#include "hex_codec.h"
+#include "slave_registry.h"
 
 
+namespace {
+    uint8_t lastExceptionCode = 0;   // exception code of the last response (0 = none)
+
+    InverterTransport::Kind transportKind = (InverterTransport::Kind)INVERTER_TRANSPORT;
+    InverterTransport* transports[TransactionEngine::MAX_IN_FLIGHT] = {nullptr};
+}
+
 namespace InverterSim {
 
-    //////////////////// Retry logic for queued frames ////////////////////
-    void processFrameQueue(const vector<vector<uint8_t>>& frames) {
-        DEBUG_PRINTF("[InverterSim] Processing %d frame(s)...\n", (int)frames.size());
-
-        int frameIndex = 0;
-        for (const auto& frame : frames) {
-            frameIndex++;
-            DEBUG_PRINTF("[InverterSim] Sending frame #%d...\n", frameIndex);
-
-            int attempt = 0;
-            bool success = false;
-
-            while (attempt < 3 && !success) {
-                DEBUG_PRINTF("Attempt %d for frame #%d...\n", attempt + 1, frameIndex);
-                success = sendFrameToInverter(frame);
-                attempt++;
-                if (!success) {
-                    DEBUG_PRINTLN("[InverterSim] Retry in 400ms...");
-                    delay(400);
-                }
-            }
+    //////////////////// Queue frames on the transaction engine ////////////////////
+    // Non-blocking: frames are sent, awaited and retried from loop() by
+    // TransactionEngine::handle(), and decoded in onTransactionComplete()
+    void processFrameQueue(FrameQueue& frames) {
+        DEBUG_PRINTF("[InverterSim] Queuing %d frame(s)...\n", (int)frames.size());
+        TransactionEngine::submitAll(frames);
+    }
 
-            if (!success) {
-                DEBUG_PRINTF("[InverterSim] Frame #%d FAILED after 3 attempts.\n", frameIndex);
-                // TODO: log or queue for retry later
-            } else {
-                DEBUG_PRINTF("[InverterSim] Frame #%d SUCCESS.\n", frameIndex);
-            }
+    //////////////////// Transport selection ////////////////////
+    void setTransport(InverterTransport::Kind kind) {
+        if (kind == transportKind) return;
+        for (uint8_t s = 0; s < TransactionEngine::MAX_IN_FLIGHT; s++) {
+            delete transports[s];
+            transports[s] = nullptr;
+        }
+        transportKind = kind;
+        TransactionEngine::configure(TransactionEngine::getConfig());   // re-applies timeouts
+        DEBUG_PRINTF("[InverterSim] Transport → %s\n", InverterTransport::kindName(kind));
+    }
+
+    InverterTransport::Kind getTransportKind() { return transportKind; }
+
+    InverterTransport& getTransport(uint8_t slot) {
+        if (slot >= TransactionEngine::MAX_IN_FLIGHT) slot = 0;
+        if (!transports[slot]) {
+            // Slot 0 over HTTP keeps using the readAPI/writeAPI session
+            InverterSession* shared = (slot == 0) ? &InverterUtils::getSession() : nullptr;
+            transports[slot] = InverterTransport::create(transportKind, shared);
+        }
+        return *transports[slot];
+    }
+
+    void printTransportStats() {
+        for (uint8_t s = 0; s < TransactionEngine::MAX_IN_FLIGHT; s++) {
+            if (transports[s]) transports[s]->printStats();
+        }
+    }
+
+    //////////////////// Transaction completion → decoder ////////////////////
+    void onTransactionComplete(const FramePool::Frame& request, const FramePool::Frame& response, bool success) {
+        uint8_t funcCode = request[1];
+        uint16_t startAddr = (request[2] << 8) | request[3];
+        uint16_t quantity  = (request[4] << 8) | request[5];
+
+        if (!success) {
+            DEBUG_PRINTF("[InverterSim] Slave %u frame FC=0x%02X R%d FAILED.\n", request[0], funcCode, startAddr);
+            if (funcCode == 0x03) TemporaryBuffer::markFailed(request[0], startAddr, quantity);
+            return;
+        }
+        SlaveRegistry::recordResponse(request[0]);
+
+        bool valid = processResponseFrame(response.bytes, response.len, startAddr, quantity);
+        if (funcCode == 0x03 && !valid) TemporaryBuffer::markFailed(request[0], startAddr, quantity);
+
+        // Device did not accept FC16 → resend as FC06 frames, and stop
+        // batching for good if it reported "Illegal Function"
+        if (funcCode == 0x10 && !valid) {
+            if (lastExceptionCode == 0x01) ProtocolAdapter::setWriteMultipleEnabled(false);
+            FrameQueue singles;
+            ProtocolAdapter::splitWriteMultiple(request, singles);
+            DEBUG_PRINTF("[InverterSim] FC16 rejected → retrying as %d FC06 frame(s)\n", (int)singles.size());
+            TransactionEngine::submitAll(singles, true);
         }
+    }
 
-        DEBUG_PRINTLN("[InverterSim] Frame queue processing complete.");
-    }   
+    //////////////////// FC06 fallback for FC16 frames ////////////////////
+    static bool sendAsSingleWrites(const uint8_t* frame, size_t len) {
+        FramePool::Handle fc16 = FramePool::copy(frame, len);
+        FrameQueue singles;
+        ProtocolAdapter::splitWriteMultiple(FramePool::get(fc16), singles);
+        FramePool::release(fc16);
+        DEBUG_PRINTF("[InverterSim] FC16 rejected → retrying as %d FC06 frame(s)\n", (int)singles.size());
+
+        bool allOk = !singles.empty();
+        for (size_t i = 0; i < singles.size(); i++) {
+            allOk = sendFrameToInverter(singles[i].bytes, singles[i].len) && allOk;
+        }
+        singles.clear();
+        return allOk;
+    }
 
     //////////////////// Main inverter send function ////////////////////
-    bool sendFrameToInverter(const vector<uint8_t>& frame) {
-        String jsonFrame = InverterUtils::frameToJson(frame);
-        String apiKey = "NjhhZWIwNDU1ZDdmMzg3MzNiMTQ5Yjg2OjY4YWViMDQ1NWQ3ZjM4NzMzYjE0OWI3Yw";
-        String response;
-    
+    bool sendFrameToInverter(const uint8_t* frame, size_t frameLen) {
+        if (frameLen < 6) return false;
         uint8_t funcCode = frame[1];
         uint16_t startAddr = (frame[2] << 8) | frame[3];   // ✅ extract address
+        uint16_t quantity  = (frame[4] << 8) | frame[5];   // register count for 0x03 / 0x10
     
         if (funcCode == 0x03) {
             DEBUG_PRINTLN("[InverterSim] Function Code 0x03 → READ operation");
-            response = InverterUtils::readAPI(jsonFrame, apiKey);
         } 
         else if (funcCode == 0x06) {
             DEBUG_PRINTLN("[InverterSim] Function Code 0x06 → WRITE operation");
-            response = InverterUtils::writeAPI(jsonFrame, apiKey);
+        } 
+        else if (funcCode == 0x10) {
+            DEBUG_PRINTLN("[InverterSim] Function Code 0x10 → WRITE MULTIPLE operation");
         } 
         else {
             DEBUG_PRINTF("[InverterSim] Unknown Function Code: 0x%02X\n", funcCode);
             return false;
         }
-    
-        bool success = response.length() > 0;
+
+        uint8_t buf[HexCodec::MAX_FRAME_BYTES];
+        size_t len = 0;
+        bool success = getTransport(0).exchange(frame, frameLen, buf, sizeof(buf), len);
         if (success) {
             DEBUG_PRINTLN("[InverterSim] Frame sent successfully.");
-            processResponseFrame(response, startAddr);   // ✅ pass address
+            bool valid = processResponseFrame(buf, len, startAddr, quantity);   // ✅ pass address
+
+            // Device did not accept FC16 → fall back to FC06 for this frame,
+            // and stop batching for good if it reported "Illegal Function"
+            if (funcCode == 0x10 && !valid) {
+                if (lastExceptionCode == 0x01) ProtocolAdapter::setWriteMultipleEnabled(false);
+                return sendAsSingleWrites(frame, frameLen);
+            }
         } 
         else {
             DEBUG_PRINTLN("[InverterSim] Frame send failed.");
@@ -79,11 +146,11 @@ namespace InverterSim {
     }
 
     ////////////////////////// CRC Validation //////////////////////////
-    bool validateCRC(const vector<uint8_t>& frame) {
-        if (frame.size() < 4) return false;  // too short to contain CRC
+    bool validateCRC(const uint8_t* frame, size_t len) {
+        if (len < 4) return false;  // too short to contain CRC
 
-        uint16_t receivedCRC = (frame[frame.size() - 1] << 8) | frame[frame.size() - 2];
-        uint16_t calcCRC = Modbus::modbusCRC((uint8_t*)frame.data(), frame.size() - 2);
+        uint16_t receivedCRC = (frame[len - 1] << 8) | frame[len - 2];
+        uint16_t calcCRC = Modbus::modbusCRC(frame, len - 2);
 
         if (receivedCRC == calcCRC) {
             DEBUG_PRINTLN("[InverterSim] CRC check passed.");
@@ -95,13 +162,13 @@ namespace InverterSim {
     }
 
     ////////////////////////// Validate Response //////////////////////////
-    bool ValidateResponseFrame(const vector<uint8_t>& responseFrame) {
-        if (responseFrame.empty()) {
+    bool ValidateResponseFrame(const uint8_t* responseFrame, size_t len) {
+        if (len == 0) {
             DEBUG_PRINTLN("[InverterSim] Empty or invalid response frame.");
             return false;
         }
 
-        if (!validateCRC(responseFrame)) {
+        if (!validateCRC(responseFrame, len)) {
             DEBUG_PRINTLN("[InverterSim] CRC validation failed.");
             return false;
         }
@@ -109,6 +176,7 @@ namespace InverterSim {
         uint8_t funcCode = responseFrame[1];
         if (funcCode & 0x80) {
             uint8_t exceptionCode = responseFrame[2];
+            lastExceptionCode = exceptionCode;
             DEBUG_PRINTF("[InverterSim] Modbus Exception: 0x%02X\n", exceptionCode);
             return false;
         }
@@ -117,65 +185,103 @@ namespace InverterSim {
         return true;
     }
 
+    ////////////////////// Validate FC16 Echo //////////////////////
+    // A Write Multiple response echoes start address and quantity
+    bool validateWriteMultipleEcho(const uint8_t* frame, size_t len, uint16_t startAddr, uint16_t quantity) {
+        if (len != 8) {
+            DEBUG_PRINTF("[InverterSim] FC16 response has %d bytes, expected 8.\n", (int)len);
+            return false;
+        }
+
+        uint16_t echoAddr = (frame[2] << 8) | frame[3];
+        uint16_t echoQty  = (frame[4] << 8) | frame[5];
+        if (echoAddr != startAddr || echoQty != quantity) {
+            DEBUG_PRINTF("[InverterSim] FC16 echo mismatch: R%d x%d, expected R%d x%d\n",
+                         echoAddr, echoQty, startAddr, quantity);
+            return false;
+        }
+        return true;
+    }
+
     //////////////////// Process Response Frames ////////////////////
-    void processResponseFrame(const String& response, uint16_t startAddr) {
+    bool processResponseFrame(const String& response, uint16_t startAddr, uint16_t quantity) {
+        // Convert JSON → binary Modbus frame
+        uint8_t frame[HexCodec::MAX_FRAME_BYTES];
+        int len = HexCodec::readFrameJson(response.c_str(), response.length(), frame, sizeof(frame));
+        if (len <= 0) {
+            DEBUG_PRINTLN("[InverterSim] JSON → Frame conversion failed.");
+            lastExceptionCode = 0;
+            return false;
+        }
+        return processResponseFrame(frame, (size_t)len, startAddr, quantity);
+    }
+
+    bool processResponseFrame(const uint8_t* frame, size_t len, uint16_t startAddr, uint16_t quantity) {
         DEBUG_PRINTLN("[InverterSim] === Processing Response Frame ===");
+        lastExceptionCode = 0;
     
-        // Step 1: Convert JSON → binary Modbus frame
-        auto frame = InverterUtils::jsonToFrame(response);
-        if (frame.empty()) {
-            DEBUG_PRINTLN("[InverterSim] JSON → Frame conversion failed.");
-            return;
+        if (len == 0) {
+            DEBUG_PRINTLN("[InverterSim] Empty response frame.");
+            return false;
         }
     
-        // Step 2: Validate CRC and Modbus error codes
-        if (!ValidateResponseFrame(frame)) {
+        // Step 1: Validate CRC and Modbus error codes
+        if (!ValidateResponseFrame(frame, len)) {
             DEBUG_PRINTLN("[InverterSim] Response frame validation failed.");
-            return;
+            return false;
         }
-    
-        // Step 3: Decode and display registers —  now with startAddr
-        auto snapshot = decodeResponseFrame(frame, startAddr);
 
-        // // 🧩 Store snapshot data in TemporaryBuffer
-        TemporaryBuffer::update(snapshot);
-
-        // 🔍 Print snapshot summary to Serial
-        Serial.printf("[TemporaryBuffer] ✅ Stored snapshot at %s\n", snapshot.timestamp.c_str());
-        for (size_t i = 0; i < snapshot.values.size(); ++i) {
-            if (snapshot.values[i] != -1.0f) {
-                Serial.printf("  R%-3d = %.2f\n", (int)i, snapshot.values[i]);
+        if (frame[1] == 0x10 && !validateWriteMultipleEcho(frame, len, startAddr, quantity)) {
+            DEBUG_PRINTLN("[InverterSim] FC16 response validation failed.");
+            return false;
+        }
+    
+        // Step 2: 🧩 Read responses scatter into the slave's record of this
+        //         cycle in TemporaryBuffer; write confirmations are only reported
+        if (frame[1] != 0x03) {
+            SnapshotRecord confirmation;
+            confirmation.clear();
+            decodeResponseFrame(frame, len, startAddr, confirmation);
+            DEBUG_PRINTLN("[InverterSim] === Response Frame Processing Complete ===");
+            return true;
+        }
+        SnapshotRecord& snapshot = TemporaryBuffer::record(frame[0]);
+        decodeResponseFrame(frame, len, startAddr, snapshot);
+
+#if DEBUG_ENABLED
+        // 🔍 Print the merged record so far (timestamps stay epochs otherwise)
+        char when[SNAPSHOT_TIME_CHARS];
+        snapshot.formatTime(when, sizeof(when));
+        Serial.printf("[TemporaryBuffer] ✅ Slave %u snapshot at %s (mask=0x%04X)\n",
+                      snapshot.slave, when, snapshot.present);
+        for (int i = 0; i < REGISTER_COUNT; ++i) {
+            if (snapshot.has(i)) {
+                char value[SCALED_VALUE_CHARS];
+                snapshot.formatValue(value, sizeof(value), i);
+                Serial.printf("  R%-3d = %s\n", i, value);
             } else {
-                Serial.printf("  R%-3d = (unread)\n", (int)i);
+                Serial.printf("  R%-3d = (unread)\n", i);
             }
             if (i % 5 == 0) yield();  // Prevent buffer overflow every 5 registers
         }
+#endif
         Serial.flush();
 
     
         DEBUG_PRINTLN("[InverterSim] === Response Frame Processing Complete ===");
+        return true;
     }
 
     ////////////////////////// Decode Response //////////////////////////
-    TimedSnapshot decodeResponseFrame(const vector<uint8_t>& frame, uint16_t startAddr) {
-        TimedSnapshot snapshot;
-        snapshot.values.assign(REGISTER_COUNT, -1.0f);  // initialize with -1 for unread registers
-
-        if (frame.size() < 5) {
-            snapshot.timestamp = "INVALID";
-            return snapshot;
+    // Scatters the words of a read response into `snapshot` in place; its
+    // epoch and slave are set by whoever opened it (TemporaryBuffer::open)
+    int decodeResponseFrame(const uint8_t* frame, size_t len, uint16_t startAddr, SnapshotRecord& snapshot) {
+        if (len < 5) {
+            return 0;
         }
 
-        // --- Generate timestamp ---
-        time_t now = time(nullptr);
-        struct tm* t = localtime(&now);
-        char buf[25];
-        snprintf(buf, sizeof(buf), "%04d-%02d-%02d %02d:%02d:%02d",
-                t->tm_year + 1900, t->tm_mon + 1, t->tm_mday,
-                t->tm_hour, t->tm_min, t->tm_sec);
-        snapshot.timestamp = String(buf);
-
         uint8_t funcCode = frame[1];
+        int mapped = 0;
 
         // ----------------------------------------------------------
         //      CHECK FOR MODBUS EXCEPTION RESPONSE
@@ -198,7 +304,7 @@ namespace InverterSim {
                 default:   exceptionText = "Unknown Exception Code"; break;
             }
             DEBUG_PRINTF("[InverterSim] ⚠ Modbus Exception: FC=0x%02X Code=0x%02X (%s)\n", funcCode, exceptionCode, exceptionText);
-            return snapshot;
+            return 0;
         }
         if (funcCode == 0x03) { // READ RESPONSE
             uint8_t byteCount = frame[2];
@@ -206,22 +312,31 @@ namespace InverterSim {
 
             DEBUG_PRINTF("[InverterSim] Decoding %d registers (starting at R%d):\n", numRegisters, startAddr);
 
+            // Register address = snapshot column (checked in register_map.h),
+            // so words go straight in without a map lookup per register
+            if (len < 3 + (size_t)numRegisters * 2) numRegisters = (len - 3) / 2;
+            mapped = startAddr < REGISTER_COUNT ? min((int)numRegisters, REGISTER_COUNT - startAddr) : 0;
+            const uint8_t* words = &frame[3];
+            for (int i = 0; i < mapped; i++) {
+                snapshot.set(startAddr + i, (uint16_t)((words[2 * i] << 8) | words[2 * i + 1]));
+            }
+
+#if DEBUG_ENABLED
             for (uint8_t i = 0; i < numRegisters; i++) {
                 uint16_t regAddr = startAddr + i;
-                uint16_t rawValue = (frame[3 + i * 2] << 8) | frame[4 + i * 2];
-
+                uint16_t rawValue = (words[2 * i] << 8) | words[2 * i + 1];
                 if (regAddr < REGISTER_COUNT) {
-                    const auto& reg = registerMap[regAddr];
-                    float scaled = (float)rawValue / reg.scale;
-
-                    snapshot.values[reg.index] = scaled;
-
-                    DEBUG_PRINTF("  R%-2d %-35s = %.2f %s (raw=%d)\n",
-                                reg.index, reg.name, scaled, reg.unit, rawValue);
+                    char name[RegisterMap::NAME_CHARS], unit[RegisterMap::UNIT_CHARS];
+                    char value[SCALED_VALUE_CHARS];
+                    formatScaled(value, sizeof(value), regAddr, rawValue);
+                    DEBUG_PRINTF("  R%-2d %-35s = %s %s (raw=%d)\n", regAddr,
+                                RegisterMap::name(regAddr, name, sizeof(name)), value,
+                                RegisterMap::unit(regAddr, unit, sizeof(unit)), rawValue);
                 } else {
                     DEBUG_PRINTF("  R%-2d (Unknown) = %d\n", regAddr, rawValue);
                 }
             }
+#endif
         }
 
         else if (funcCode == 0x06) { // WRITE CONFIRMATION
@@ -229,21 +344,43 @@ namespace InverterSim {
             uint16_t value = (frame[4] << 8) | frame[5];
 
             if (addr < REGISTER_COUNT) {
-                const auto& reg = registerMap[addr];
-                snapshot.values[reg.index] = (float)value / reg.scale;
-
-                DEBUG_PRINTF("[InverterSim] Write Confirmed: %s (R%d) = %.2f %s\n",
-                            reg.name, addr, (float)value / reg.scale, reg.unit);
+#if DEBUG_ENABLED
+                char name[RegisterMap::NAME_CHARS], unit[RegisterMap::UNIT_CHARS];
+                char shown[SCALED_VALUE_CHARS];
+                formatScaled(shown, sizeof(shown), addr, value);
+                DEBUG_PRINTF("[InverterSim] Write Confirmed: %s (R%d) = %s %s\n",
+                            RegisterMap::name(addr, name, sizeof(name)), addr, shown,
+                            RegisterMap::unit(addr, unit, sizeof(unit)));
+#endif
             } else {
                 DEBUG_PRINTF("[InverterSim] Write Confirmed: Unknown R%d = %d\n", addr, value);
             }
         }
 
+        else if (funcCode == 0x10) { // WRITE MULTIPLE CONFIRMATION
+            uint16_t addr = (frame[2] << 8) | frame[3];
+            uint16_t count = (frame[4] << 8) | frame[5];
+
+            // The echo carries no values; report the confirmed register span
+            for (uint16_t i = 0; i < count; i++) {
+                uint16_t regAddr = addr + i;
+                if (regAddr < REGISTER_COUNT) {
+#if DEBUG_ENABLED
+                    char name[RegisterMap::NAME_CHARS];
+                    DEBUG_PRINTF("[InverterSim] Write Confirmed: %s (R%d)\n",
+                                RegisterMap::name(regAddr, name, sizeof(name)), regAddr);
+#endif
+                } else {
+                    DEBUG_PRINTF("[InverterSim] Write Confirmed: Unknown R%d\n", regAddr);
+                }
+            }
+        }
+
         else {
             DEBUG_PRINTF("[InverterSim] Unsupported function code: 0x%02X\n", funcCode);
         }
 
-        return snapshot;
+        return mapped;
     }
 
 }  // namespace InverterSim
\ No newline at end of file
@@ -0,0 +1,258 @@
+#include "inverter_session.h"
+#include "debug_utils.h"
+#include "power_estimator.h"
+
+InverterSession::InverterSession(const String& baseUrl, const String& apiKey)
+    : _port(80), _apiKey(apiKey), _timeoutMs(5000), _stats{},
+      _busy(false), _reused(false), _resent(false), _path(""), _bodyLen(0),
+      _headerEnd(-1), _httpCode(0), _contentLength(-1),
+      _chunked(false), _keepAlive(true), _startUs(0), _startMs(0) {
+    setBaseUrl(baseUrl);
+}
+
+// "http://host:port" → host + port
+void InverterSession::setBaseUrl(const String& baseUrl) {
+    if (baseUrl == _baseUrl) return;
+    close();
+    _baseUrl = baseUrl;
+
+    int hostStart = _baseUrl.indexOf("://");
+    hostStart = (hostStart == -1) ? 0 : hostStart + 3;
+    int hostEnd = _baseUrl.indexOf('/', hostStart);
+    String hostPort = (hostEnd == -1) ? _baseUrl.substring(hostStart)
+                                      : _baseUrl.substring(hostStart, hostEnd);
+
+    int colon = hostPort.indexOf(':');
+    if (colon == -1) {
+        _host = hostPort;
+        _port = 80;
+    } else {
+        _host = hostPort.substring(0, colon);
+        _port = (uint16_t)hostPort.substring(colon + 1).toInt();
+    }
+}
+
+void InverterSession::close() {
+    _client.stop();
+    _busy = false;
+}
+
+void InverterSession::abort() {
+    if (_busy) finish(false);
+    else close();
+}
+
+void InverterSession::resetStats() {
+    _stats = Stats{};
+}
+
+bool InverterSession::connect() {
+    _stats.connects++;
+    DEBUG_PRINTF("[InverterSession] Opening connection to %s:%u\n", _host.c_str(), _port);
+    if (!_client.connect(_host.c_str(), _port)) {
+        DEBUG_PRINTLN("[InverterSession] TCP connect failed.");
+        return false;
+    }
+    _client.setNoDelay(true);
+    return true;
+}
+
+bool InverterSession::sendRequest() {
+    // Header and body go out in one write from a stack buffer
+    char req[256 + HexCodec::MAX_JSON_CHARS];
+    int n = snprintf(req, sizeof(req),
+                     "POST %s HTTP/1.1\r\nHost: %s\r\nAuthorization: %s\r\n"
+                     "Content-Type: application/json\r\nConnection: keep-alive\r\n"
+                     "Content-Length: %u\r\n\r\n",
+                     _path, _host.c_str(), _apiKey.c_str(), (unsigned)_bodyLen);
+    if (n < 0 || (size_t)n + _bodyLen > sizeof(req)) {
+        DEBUG_PRINTLN("[InverterSession] Request too large.");
+        return false;
+    }
+    memcpy(req + n, _body, _bodyLen);
+
+    size_t total = n + _bodyLen;
+    _stats.bytesOut += total;
+    return _client.write((const uint8_t*)req, total) == total;
+}
+
+bool InverterSession::beginPost(const char* path, const String& jsonBody) {
+    return beginPost(path, jsonBody.c_str(), jsonBody.length());
+}
+
+bool InverterSession::beginPost(const char* path, const char* jsonBody, size_t len) {
+    if (_busy) return false;
+    if (len >= sizeof(_body)) {
+        DEBUG_PRINTLN("[InverterSession] Body too large.");
+        return false;
+    }
+
+    _stats.requests++;
+    _startUs = micros();
+    _startMs = millis();
+    _path = path;
+    memcpy(_body, jsonBody, len);
+    _bodyLen = len;
+    _rx = "";
+    _rx.reserve(RX_RESERVE);      // grows once, then reused across requests
+    _headerEnd = -1;
+    _httpCode = 0;
+    _contentLength = -1;
+    _chunked = false;
+    _keepAlive = true;
+    _resent = false;
+
+    _reused = _client.connected();
+    if (!_reused && !connect()) {
+        finish(false);
+        return false;
+    }
+
+    if (!sendRequest()) {
+        // A kept-alive socket may have been closed by the server or the AP:
+        // drop it and retry once on a fresh connection
+        _client.stop();
+        if (!_reused) { finish(false); return false; }
+        _stats.reconnects++;
+        _reused = false;
+        if (!connect() || !sendRequest()) {
+            finish(false);
+            return false;
+        }
+    }
+
+    _busy = true;
+    return true;
+}
+
+void InverterSession::parseHeaders() {
+    String headers = _rx.substring(0, _headerEnd);
+    headers.toLowerCase();
+
+    // "HTTP/1.1 200 OK"
+    int space = headers.indexOf(' ');
+    _httpCode = (space == -1) ? 0 : (int)headers.substring(space + 1, space + 4).toInt();
+
+    int cl = headers.indexOf("content-length:");
+    if (cl != -1) {
+        int eol = headers.indexOf('\r', cl);
+        String val = headers.substring(cl + 15, eol);
+        val.trim();
+        _contentLength = val.toInt();
+    }
+    _chunked = headers.indexOf("transfer-encoding: chunked") != -1;
+    _keepAlive = headers.indexOf("connection: close") == -1;
+}
+
+bool InverterSession::bodyComplete() {
+    if (_contentLength >= 0) {
+        return (long)(_rx.length() - _headerEnd) >= _contentLength;
+    }
+    if (_chunked) {
+        return _rx.indexOf("\r\n0\r\n\r\n", _headerEnd - 2) != -1;
+    }
+    // No length: body ends when the server closes the socket
+    return !_client.connected() && _client.available() == 0;
+}
+
+String InverterSession::extractBody() {
+    if (!_chunked) {
+        if (_contentLength >= 0) return _rx.substring(_headerEnd, _headerEnd + _contentLength);
+        return _rx.substring(_headerEnd);
+    }
+
+    // De-chunk: <hex size>\r\n<data>\r\n ... 0\r\n\r\n
+    String body;
+    int pos = _headerEnd;
+    while (true) {
+        int eol = _rx.indexOf("\r\n", pos);
+        if (eol == -1) break;
+        long size = strtol(_rx.substring(pos, eol).c_str(), nullptr, 16);
+        if (size <= 0) break;
+        body += _rx.substring(eol + 2, eol + 2 + size);
+        pos = eol + 2 + size + 2;
+    }
+    return body;
+}
+
+InverterSession::PollStatus InverterSession::finish(bool ok) {
+    unsigned long dt = micros() - _startUs;
+    _stats.lastUs = dt;
+    _stats.totalUs += dt;
+    if (dt > _stats.maxUs) _stats.maxUs = dt;
+    pe_addWifiMs(dt / 1000UL);
+
+    DEBUG_PRINTF("[InverterSession] POST %s → %d in %lu µs\n", _path, ok ? _httpCode : -1, dt);
+
+    _busy = false;
+    if (!ok) {
+        _stats.failures++;
+        _client.stop();
+        return POLL_FAILED;
+    }
+    if (!_keepAlive) _client.stop();
+    return POLL_DONE;
+}
+
+InverterSession::PollStatus InverterSession::poll(String& response) {
+    if (!_busy) return POLL_FAILED;
+
+    // Drain whatever arrived since the last call
+    uint8_t chunk[128];
+    while (_client.available() > 0) {
+        int n = _client.read(chunk, sizeof(chunk));
+        if (n <= 0) break;
+        _stats.bytesIn += n;
+        _rx.concat((const char*)chunk, n);
+    }
+
+    if (_headerEnd < 0) {
+        int p = _rx.indexOf("\r\n\r\n");
+        if (p != -1) {
+            _headerEnd = p + 4;
+            parseHeaders();
+        }
+    }
+
+    if (_headerEnd >= 0 && bodyComplete()) {
+        response = extractBody();
+        return finish(_httpCode > 0);
+    }
+
+    if (!_client.connected() && _client.available() == 0) {
+        // Kept-alive socket closed before any reply: resend once
+        if (_rx.length() == 0 && _reused && !_resent) {
+            DEBUG_PRINTLN("[InverterSession] Connection dropped, reconnecting...");
+            _stats.reconnects++;
+            _resent = true;
+            _reused = false;
+            if (connect() && sendRequest()) return POLL_PENDING;
+        }
+        return finish(false);
+    }
+
+    if (millis() - _startMs > _timeoutMs) {
+        DEBUG_PRINTLN("[InverterSession] Response timeout.");
+        return finish(false);
+    }
+    return POLL_PENDING;
+}
+
+String InverterSession::post(const char* path, const String& jsonBody) {
+    if (!beginPost(path, jsonBody)) return "";
+
+    String response;
+    while (true) {
+        PollStatus st = poll(response);
+        if (st == POLL_DONE) return response;
+        if (st == POLL_FAILED) return "";
+        delay(1);   // yields to the Wi-Fi stack
+    }
+}
+
+void InverterSession::printStats() const {
+    unsigned long avgUs = _stats.requests ? _stats.totalUs / _stats.requests : 0;
+    Serial.printf("[InverterSession] req=%u fail=%u connects=%u reconnects=%u | last=%lu avg=%lu max=%lu µs\n",
+                  _stats.requests, _stats.failures, _stats.connects, _stats.reconnects,
+                  _stats.lastUs, avgUs, _stats.maxUs);
+}
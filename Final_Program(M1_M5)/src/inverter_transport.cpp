@@ -0,0 +1,34 @@
+#include "inverter_transport.h"
+#include "http_json_transport.h"
+#include "modbus_tcp_transport.h"
+
+bool InverterTransport::exchange(const uint8_t* frame, size_t len,
+                                 uint8_t* response, size_t cap, size_t& respLen) {
+    if (!begin(frame, len)) return false;
+    while (true) {
+        Status st = poll(response, cap, respLen);
+        if (st == DONE) return true;
+        if (st == FAILED) return false;
+        delay(1);   // yields to the Wi-Fi stack
+    }
+}
+
+void InverterTransport::printStats() const {
+    Stats s = stats();
+    unsigned long avgUs = s.requests ? s.totalUs / s.requests : 0;
+    unsigned long bytesPerTx = s.requests ? (s.bytesOut + s.bytesIn) / s.requests : 0;
+    Serial.printf("[Transport:%s] req=%u fail=%u connects=%u | out=%u in=%u B (%lu B/tx) | avg=%lu max=%lu µs\n",
+                  name(), s.requests, s.failures, s.connects, s.bytesOut, s.bytesIn,
+                  bytesPerTx, avgUs, s.maxUs);
+}
+
+InverterTransport* InverterTransport::create(Kind kind, InverterSession* session) {
+    if (kind == MODBUS_TCP) {
+        return new ModbusTcpTransport(INVERTER_MODBUS_TCP_HOST, INVERTER_MODBUS_TCP_PORT);
+    }
+    return new HttpJsonTransport(session);
+}
+
+const char* InverterTransport::kindName(Kind kind) {
+    return kind == MODBUS_TCP ? "Modbus-TCP" : "HTTP/JSON";
+}
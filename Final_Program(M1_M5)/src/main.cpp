@@ -10,6 +10,14 @@
 #include "firmware_rollback.h"
 #include "request_sim.h"
 #include "power_estimator.h"
+#include "transaction_engine.h"
+#include "hex_codec.h"
+#include "modbus_utils.h"
+#include "buffer.h"
+#include "compression.h"
+#include "spool.h"
+#include "slave_registry.h"
+#include "security_layer.h"
 
 const char* ssid     = "dinujaya";
 const char* password = "helloworld";
@@ -85,11 +93,42 @@ void setup() {
         ESP.restart();  // Restart to boot from previous OTA slot
     }
 
+#if HEX_CODEC_COUNT_ALLOCS
+    // 📊 Heap allocations per frame conversion, old vs fixed-buffer path
+    HexCodec::printAllocBenchmark(HexCodec::benchmarkAllocations());
+#endif
+
+#if MODBUS_CRC_BENCHMARK
+    // 🧮 CRC16 bitwise vs table vs slicing-by-4 on random frames
+    Modbus::printCrcBenchmark(Modbus::benchmarkCRC());
+#endif
+
+#if COMPRESSION_BENCHMARK
+    // 🗜️ Upload codec throughput vs column count
+    Compression::printColumnBenchmark();
+    Compression::printCodecBenchmark();
+    Compression::printRunLengthBenchmark();
+    Compression::printCodecSelectionBenchmark();
+    Buffer::printPipelineBenchmark();
+#endif
+
+    // 📦 Snapshot buffer footprint
+    Buffer::printMemoryReport();
+
     //Create the Configuration(default)
     requestSim = RequestConfig::buildRequestConfig();
     // 🌐 Connect to Wi-Fi and get real-world time
     connectToWiFiAndSyncTime();
 
+    // 🔁 Non-blocking inverter I/O: responses feed the decoder
+    TransactionEngine::begin(InverterSim::onTransactionComplete);
+
+    // 💾 Flash spool for upload outages; resume numbering after its backlog
+    if (Spool::begin()) ensureSequenceAbove(Spool::highestSeq());
+
+    // 🔌 Inverters on the bus (INVERTER_SLAVES until the cloud config lists them)
+    SlaveRegistry::begin();
+
     // 🕒 Initialize polling (every 10 seconds)
     PollingManager::begin(pollingInterval);
     UploadManager::begin("http://192.168.137.1:5000/data","http://192.168.137.1:5000/config","http://192.168.137.1:5000/commands");
@@ -103,7 +142,6 @@ void setup() {
 }
 
 void loop() {
-    unsigned long cycleStart = millis();
     // 🧭 Handle periodic polling cycle
     // inside loop(), as early as possible
     static unsigned long __pe_last = 0;
@@ -115,6 +153,7 @@ void loop() {
     // default assume dt is idle; other modules will add cpu/wifi on top
     pe_addIdleMs(__pe_dt);
 
+    TransactionEngine::handle();   // 📡 advance in-flight inverter frames
     PollingManager::handle();
     UploadManager::handle();  // 🔄 Includes firmware version check at start of upload cycle
     pe_tickAndMaybePrint();
@@ -128,14 +167,19 @@ void loop() {
         //printErrorLogs();
     }
 
-    unsigned long elapsed = millis() - cycleStart;
+    // Inverter frames in flight: keep loop() spinning instead of sleeping
+    if (!TransactionEngine::idle()) {
+        delay(2);
+        return;
+    }
 
-    // Polling interval taken from cloud config
-    unsigned long interval = pollingInterval;      
+    // Sleep until the next polling tick (ticks sit on a fixed time base,
+    // so the sleep shrinks by however long this pass took)
+    unsigned long untilPoll = PollingManager::msUntilNextPoll();
 
-    if (elapsed < interval) {
+    if (untilPoll > 0) {
 
-    unsigned long sleepMs = interval - elapsed;
+    unsigned long sleepMs = untilPoll;
     if (sleepMs > 1000) sleepMs -= 200;
 
     // Enable Wi-Fi modem sleep (safe mode)
@@ -0,0 +1,151 @@
+#include "modbus_tcp_transport.h"
+#include "modbus_utils.h"
+#include "debug_utils.h"
+#include "power_estimator.h"
+
+ModbusTcpTransport::ModbusTcpTransport(const char* host, uint16_t port)
+    : _host(host), _port(port), _timeoutMs(5000), _stats{},
+      _busy(false), _reused(false), _resent(false), _transactionId(0),
+      _txLen(0), _rxLen(0), _startUs(0), _startMs(0) {}
+
+void ModbusTcpTransport::close() {
+    _client.stop();
+    _busy = false;
+}
+
+void ModbusTcpTransport::abort() {
+    if (_busy) finish(false);
+    else close();
+}
+
+bool ModbusTcpTransport::connect() {
+    _stats.connects++;
+    DEBUG_PRINTF("[ModbusTcp] Opening connection to %s:%u\n", _host, _port);
+    if (!_client.connect(_host, _port)) {
+        DEBUG_PRINTLN("[ModbusTcp] TCP connect failed.");
+        return false;
+    }
+    _client.setNoDelay(true);
+    return true;
+}
+
+bool ModbusTcpTransport::sendRequest() {
+    _stats.bytesOut += _txLen;
+    return _client.write(_tx, _txLen) == _txLen;
+}
+
+bool ModbusTcpTransport::begin(const uint8_t* frame, size_t len) {
+    if (_busy) return false;
+
+    // RTU [slave][PDU...][crc lo][crc hi] → MBAP + [unit][PDU...]
+    if (len < 4 || len - 2 > HexCodec::MAX_FRAME_BYTES) return false;
+    size_t unitAndPdu = len - 2;
+
+    _stats.requests++;
+    _startUs = micros();
+    _startMs = millis();
+    _transactionId++;
+
+    _tx[0] = _transactionId >> 8;
+    _tx[1] = _transactionId & 0xFF;
+    _tx[2] = 0x00;                       // protocol id: Modbus
+    _tx[3] = 0x00;
+    _tx[4] = unitAndPdu >> 8;
+    _tx[5] = unitAndPdu & 0xFF;
+    memcpy(_tx + 6, frame, unitAndPdu);
+    _txLen = 6 + unitAndPdu;
+    _rxLen = 0;
+    _resent = false;
+
+    _reused = _client.connected();
+    if (!_reused && !connect()) {
+        finish(false);
+        return false;
+    }
+
+    if (!sendRequest()) {
+        // Kept-alive socket went away: retry once on a fresh connection
+        _client.stop();
+        if (!_reused) { finish(false); return false; }
+        _reused = false;
+        if (!connect() || !sendRequest()) {
+            finish(false);
+            return false;
+        }
+    }
+
+    _busy = true;
+    return true;
+}
+
+InverterTransport::Status ModbusTcpTransport::finish(bool ok) {
+    unsigned long dt = micros() - _startUs;
+    _stats.totalUs += dt;
+    if (dt > _stats.maxUs) _stats.maxUs = dt;
+    pe_addWifiMs(dt / 1000UL);
+
+    DEBUG_PRINTF("[ModbusTcp] Transaction %u → %s in %lu µs\n",
+                 _transactionId, ok ? "OK" : "FAILED", dt);
+
+    _busy = false;
+    if (!ok) {
+        _stats.failures++;
+        _client.stop();
+        return FAILED;
+    }
+    return DONE;
+}
+
+InverterTransport::Status ModbusTcpTransport::poll(uint8_t* response, size_t cap, size_t& len) {
+    if (!_busy) return FAILED;
+
+    while (_client.available() > 0 && _rxLen < sizeof(_rx)) {
+        int n = _client.read(_rx + _rxLen, sizeof(_rx) - _rxLen);
+        if (n <= 0) break;
+        _rxLen += n;
+        _stats.bytesIn += n;
+    }
+
+    if (_rxLen >= MBAP_HEADER_BYTES) {
+        uint16_t tid = (_rx[0] << 8) | _rx[1];
+        uint16_t proto = (_rx[2] << 8) | _rx[3];
+        size_t unitAndPdu = (_rx[4] << 8) | _rx[5];
+
+        if (proto != 0 || unitAndPdu < 2 || 6 + unitAndPdu > sizeof(_rx)) {
+            DEBUG_PRINTLN("[ModbusTcp] Malformed MBAP header.");
+            return finish(false);
+        }
+        if (_rxLen >= 6 + unitAndPdu) {
+            if (tid != _transactionId) {
+                DEBUG_PRINTF("[ModbusTcp] Transaction id %u, expected %u.\n", tid, _transactionId);
+                return finish(false);
+            }
+            if (unitAndPdu + 2 > cap) return finish(false);
+
+            // Back to RTU: [unit][PDU...] + CRC
+            memcpy(response, _rx + 6, unitAndPdu);
+            uint16_t crc = Modbus::modbusCRC(response, (int)unitAndPdu);
+            response[unitAndPdu] = crc & 0xFF;
+            response[unitAndPdu + 1] = crc >> 8;
+            len = unitAndPdu + 2;
+            return finish(true);
+        }
+    }
+
+    if (!_client.connected() && _client.available() == 0) {
+        // Kept-alive socket closed before any reply: resend once
+        if (_rxLen == 0 && _reused && !_resent) {
+            DEBUG_PRINTLN("[ModbusTcp] Connection dropped, reconnecting...");
+            _resent = true;
+            _reused = false;
+            if (connect() && sendRequest()) return PENDING;
+        }
+        return finish(false);
+    }
+
+    if (millis() - _startMs > _timeoutMs) {
+        DEBUG_PRINTLN("[ModbusTcp] Response timeout.");
+        return finish(false);
+    }
+    return PENDING;
+}
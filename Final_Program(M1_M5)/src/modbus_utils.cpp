@@ -2,11 +2,92 @@
 #include "debug_utils.h"
 #include <vector>
 
+namespace {
+
+    // 256-entry tables generated at compile time. tables[0] is the classic
+    // byte table; tables[k][b] is the CRC of byte b followed by k zero bytes.
+    struct CrcTables {
+#if MODBUS_CRC_SLICE4
+        uint16_t t[4][256];
+#else
+        uint16_t t[1][256];
+#endif
+    };
+
+    constexpr uint16_t crcByteBitwise(uint16_t crc) {
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+        }
+        return crc;
+    }
+
+    constexpr CrcTables makeCrcTables() {
+        CrcTables tables{};
+        for (int b = 0; b < 256; b++) {
+            tables.t[0][b] = crcByteBitwise((uint16_t)b);
+        }
+#if MODBUS_CRC_SLICE4
+        for (int k = 1; k < 4; k++) {
+            for (int b = 0; b < 256; b++) {
+                uint16_t prev = tables.t[k - 1][b];
+                tables.t[k][b] = (prev >> 8) ^ tables.t[0][prev & 0xFF];
+            }
+        }
+#endif
+        return tables;
+    }
+
+    // Lives in flash; read through pgm_read_word
+    const CrcTables CRC_TABLES PROGMEM = makeCrcTables();
+
+    inline uint16_t tableAt(int k, uint8_t idx) {
+        return pgm_read_word(&CRC_TABLES.t[k][idx]);
+    }
+}
+
 namespace Modbus {
 
-    uint16_t modbusCRC(uint8_t *buf, int len) {
-        uint16_t crc = 0xFFFF;
-        for (int pos = 0; pos < len; pos++) {
+    uint16_t modbusCRC(const uint8_t *buf, int len) {
+        if (len <= 0) return CRC_INIT;
+        return crcUpdate(CRC_INIT, buf, (size_t)len);
+    }
+
+    uint16_t crcUpdate(uint16_t crc, uint8_t byte) {
+        return (crc >> 8) ^ tableAt(0, (uint8_t)(crc ^ byte));
+    }
+
+    uint16_t crcUpdate(uint16_t crc, const uint8_t *buf, size_t len) {
+#if MODBUS_CRC_SLICE4
+        if (len >= CRC_SLICE4_MIN_LEN) return crcSlice4(crc, buf, len);
+#endif
+        return crcTable(crc, buf, len);
+    }
+
+    uint16_t crcTable(uint16_t crc, const uint8_t *buf, size_t len) {
+        for (size_t pos = 0; pos < len; pos++) {
+            crc = (crc >> 8) ^ tableAt(0, (uint8_t)(crc ^ buf[pos]));
+        }
+        return crc;
+    }
+
+    uint16_t crcSlice4(uint16_t crc, const uint8_t *buf, size_t len) {
+#if MODBUS_CRC_SLICE4
+        // Four bytes per step: the two CRC bytes fold into the first two
+        // data bytes, the last two enter with no CRC contribution
+        while (len >= 4) {
+            uint8_t b0 = (uint8_t)(crc ^ buf[0]);
+            uint8_t b1 = (uint8_t)((crc >> 8) ^ buf[1]);
+            crc = tableAt(3, b0) ^ tableAt(2, b1) ^ tableAt(1, buf[2]) ^ tableAt(0, buf[3]);
+            buf += 4;
+            len -= 4;
+        }
+#endif
+        return crcTable(crc, buf, len);
+    }
+
+    uint16_t crcBitwise(const uint8_t *buf, size_t len) {
+        uint16_t crc = CRC_INIT;
+        for (size_t pos = 0; pos < len; pos++) {
             crc ^= buf[pos];
             for (int i = 0; i < 8; i++) {
                 crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
@@ -14,4 +95,58 @@ namespace Modbus {
         }
         return crc;
     }
+
+    void appendCRC(std::vector<uint8_t>& frame) {
+        uint16_t crc = crcUpdate(CRC_INIT, frame.data(), frame.size());
+        frame.push_back(crc & 0xFF);
+        frame.push_back((crc >> 8) & 0xFF);
+    }
+
+    CrcBenchResult benchmarkCRC(size_t frames, size_t maxLen) {
+        CrcBenchResult br{};
+        br.frames = frames;
+        br.identical = true;
+        if (maxLen < 4) maxLen = 4;
+
+        std::vector<uint8_t> frame(maxLen);
+        uint16_t sink = 0;
+
+        for (size_t f = 0; f < frames; f++) {
+            size_t len = (size_t)random(4, (long)maxLen + 1);
+            for (size_t i = 0; i < len; i++) frame[i] = (uint8_t)random(0, 256);
+            br.bytes += len;
+
+            unsigned long t0 = micros();
+            uint16_t a = crcBitwise(frame.data(), len);
+            unsigned long t1 = micros();
+            uint16_t b = crcTable(CRC_INIT, frame.data(), len);
+            unsigned long t2 = micros();
+            uint16_t c = crcSlice4(CRC_INIT, frame.data(), len);
+            unsigned long t3 = micros();
+
+            // Incremental API must agree when fed in two pieces
+            size_t split = len / 3;
+            uint16_t d = crcUpdate(crcUpdate(CRC_INIT, frame.data(), split),
+                                   frame.data() + split, len - split);
+
+            br.tBitwiseUs += t1 - t0;
+            br.tTableUs   += t2 - t1;
+            br.tSlice4Us  += MODBUS_CRC_SLICE4 ? t3 - t2 : 0;
+            if (a != b || a != c || a != d) br.identical = false;
+            sink ^= a;
+            if ((f & 31) == 0) yield();
+        }
+
+        DEBUG_PRINTF("[Modbus] CRC bench sink=%04X\n", sink);
+        return br;
+    }
+
+    void printCrcBenchmark(const CrcBenchResult& r) {
+        Serial.printf("[Modbus] CRC16 benchmark: %u frames, %u bytes\n",
+                      (unsigned)r.frames, (unsigned)r.bytes);
+        Serial.printf("  Bitwise  : %lu µs\n", r.tBitwiseUs);
+        Serial.printf("  Table    : %lu µs\n", r.tTableUs);
+        Serial.printf("  Slice4   : %lu µs\n", r.tSlice4Us);
+        Serial.printf("  Identical: %s\n", r.identical ? "✅ YES" : "❌ NO");
+    }
 }
@@ -0,0 +1,72 @@
+#include "poll_scheduler.h"
+#include "debug_utils.h"
+
+namespace {
+    uint32_t periodMs[NUM_REGISTERS] = {0};   // 0 = every base tick
+    uint32_t tick = 0;
+    PollScheduler::Stats schedStats = {};
+}
+
+namespace PollScheduler {
+
+    void setPeriod(int reg, uint32_t ms) {
+        if (reg < 0 || reg >= NUM_REGISTERS) return;
+        periodMs[reg] = ms;
+    }
+
+    uint32_t getPeriod(int reg) {
+        return (reg >= 0 && reg < NUM_REGISTERS) ? periodMs[reg] : 0;
+    }
+
+    void clearPeriods() {
+        for (int i = 0; i < NUM_REGISTERS; i++) periodMs[i] = 0;
+    }
+
+    uint16_t periodTicks(int reg, unsigned long baseIntervalMs) {
+        uint32_t p = getPeriod(reg);
+        if (p == 0 || baseIntervalMs == 0) return 1;
+
+        uint32_t ticks = (p + baseIntervalMs / 2) / baseIntervalMs;   // nearest whole tick
+        if (ticks < 1) ticks = 1;
+        if (ticks > MAX_PERIOD_TICKS) ticks = MAX_PERIOD_TICKS;
+        return (uint16_t)ticks;
+    }
+
+    RequestSIM due(const RequestSIM& enabled, unsigned long baseIntervalMs) {
+        RequestSIM out = enabled;
+        int polled = 0, skipped = 0;
+
+        for (int i = 0; i < NUM_REGISTERS; i++) {
+            if (!enabled.read[i]) continue;
+            if (tick % periodTicks(i, baseIntervalMs) == 0) {
+                polled++;
+            } else {
+                out.read[i] = false;
+                skipped++;
+            }
+        }
+
+        schedStats.cycles++;
+        schedStats.regsPolled += polled;
+        schedStats.regsSkipped += skipped;
+        DEBUG_PRINTF("[PollScheduler] Tick %u: %d register(s) due, %d skipped\n",
+                     tick, polled, skipped);
+        return out;
+    }
+
+    void advance() { tick++; }
+
+    void reset() { tick = 0; }
+
+    uint32_t currentTick() { return tick; }
+
+    const Stats& stats() { return schedStats; }
+
+    void printStats() {
+        uint32_t total = schedStats.regsPolled + schedStats.regsSkipped;
+        Serial.printf("[PollScheduler] %u cycles: %u register reads, %u skipped (%.0f%% saved)\n",
+                      schedStats.cycles, schedStats.regsPolled, schedStats.regsSkipped,
+                      total ? 100.0f * schedStats.regsSkipped / total : 0.0f);
+    }
+
+}  // namespace PollScheduler
@@ -7,76 +7,136 @@
 #include "debug_utils.h"
 #include "request_sim.h"
 #include "frame_queue.h"
+#include "transaction_engine.h"
+#include "poll_scheduler.h"
+#include "deadband.h"
+#include "slave_registry.h"
 
 namespace {
-    unsigned long lastPollTime = 0;
+    unsigned long nextPollTime = 0;       // start of the next base tick
     unsigned long pollInterval = 5000;
     unsigned long lastCompressionTime = 0;
     const unsigned long compressionInterval = 30000; // compress every 15s
+    bool cycleOpen = false;   // frames of the current poll still in flight
+
+    // Registers read from each slave in the current cycle
+    RequestSIM cycleRequests[SlaveRegistry::MAX_SLAVES];
+    bool cyclePolled[SlaveRegistry::MAX_SLAVES];
+
+    // Runs once every frame of the cycle has completed or failed
+    void finishCycle() {
+        cycleOpen = false;
+        InverterSim::printTransportStats();
+        SlaveRegistry::endCycle();
+
+        // One merged record per slave from every frame of the cycle
+        TemporaryBuffer::commit();
+
+        // Append filtered data to buffer (only registers due this cycle),
+        // one stream per slave
+        for (uint8_t s = 0; s < SlaveRegistry::count(); s++) {
+            if (cyclePolled[s]) Buffer::appendFromTemporary(cycleRequests[s], SlaveRegistry::address(s));
+        }
+        PollScheduler::printStats();
+        Deadband::printStats();
+        SlaveRegistry::printStats();
+        TemporaryBuffer::printStats();
+        FramePool::printStats();
+        TransactionEngine::printStats();
+
+        // printGlobalRequestSim();
+
+        // 🔍 Main buffer only holds compressed blocks; print a summary
+        Serial.printf("[MainBuffer] 📊 Total snapshots: %d in %d block(s)\n",
+                      (int)Buffer::size(), (int)Buffer::blockCount());
+    }
 }
 
 namespace PollingManager {
 
     void begin(unsigned long intervalMs) {
         pollInterval = intervalMs;
-        lastPollTime = millis();
+        nextPollTime = millis() + pollingInterval;
+        PollScheduler::reset();
         lastCompressionTime = millis();
         DEBUG_PRINTF("[PollingManager] Initialized (interval = %lu ms)\n", pollInterval);
     }
 
+    bool cycleInProgress() { return cycleOpen; }
+
+    unsigned long msUntilNextPoll() {
+        long left = (long)(nextPollTime - millis());
+        return left > 0 ? (unsigned long)left : 0;
+    }
+
     void handle() {
         unsigned long now = millis();
 
-        // Step 1️⃣: Perform data polling every pollInterval
-        if (now - lastPollTime >= pollingInterval) {
-            lastPollTime = now;
-            DEBUG_PRINTLN("\n================ POLLING CYCLE START =================");
+        // Close the running cycle once its frames have all completed
+        if (cycleOpen) {
+            if (TransactionEngine::idle()) finishCycle();
+            return;
+        }
 
-            // Build Modbus request
+        // Step 1️⃣: Perform data polling on every base tick
+        if ((long)(now - nextPollTime) >= 0) {
+            // Ticks stay on a fixed grid; overrun ticks are skipped, not shifted
+            nextPollTime += pollingInterval;
+            while ((long)(now - nextPollTime) >= 0) {
+                nextPollTime += pollingInterval;
+                PollScheduler::advance();
+            }
+            DEBUG_PRINTLN("\n================ POLLING CYCLE START =================");
 
+            // Only the registers whose period falls on this tick, per slave;
+            // slaves that keep failing sit some cycles out
+            bool anyDue = false;
+            for (uint8_t s = 0; s < SlaveRegistry::count(); s++) {
+                cyclePolled[s] = false;
+                if (!SlaveRegistry::shouldPoll(s)) continue;
+                cycleRequests[s] = PollScheduler::due(SlaveRegistry::request(s), pollingInterval);
+                for (int i = 0; i < NUM_REGISTERS; i++) cyclePolled[s] = cyclePolled[s] || cycleRequests[s].read[i];
+                anyDue = anyDue || cyclePolled[s];
+            }
+            PollScheduler::advance();
 
-           // Use the global instance defined in request_sim.cpp
-            const auto& frames = ProtocolAdapter::decodeRequestStruct(requestSim);
+            if (!anyDue) {
+                DEBUG_PRINTLN("[PollingManager] No register due this tick.");
+                return;
+            }
+            // Every response of the cycle lands in one record per slave,
+            // stamped with the cycle's start
+            TemporaryBuffer::clear();
+            uint32_t cycleEpoch = (uint32_t)time(nullptr);
+
+            // Build Modbus requests for every slave, then interleave them so
+            // each slave gets its first frame out before any gets a second
+            for (uint8_t s = 0; s < SlaveRegistry::count(); s++) {
+                if (!cyclePolled[s]) continue;
+                SlaveRegistry::beginCycle(s);
+                TemporaryBuffer::open(SlaveRegistry::address(s), cycleEpoch);
+                ProtocolAdapter::decodeRequestStruct(cycleRequests[s], SlaveRegistry::address(s));
+            }
+            ProtocolAdapter::interleaveBySlave(frameQueue);
 
             // Debug: print current frame queue
             DEBUG_PRINTF("[UploadManager] 🧾 FrameQueue contains command %zu frames:\n", frameQueue.size());
             for (size_t i = 0; i < frameQueue.size(); ++i) {
                 const auto& frame = frameQueue[i];
-                DEBUG_PRINTF("   [%zu] Frame length: %zu bytes\n", i, frame.size());
+                DEBUG_PRINTF("   [%zu] Frame length: %u bytes\n", i, frame.len);
                 DEBUG_PRINTF("   Data: ");
-                for (uint8_t byte : frame) {
-                    DEBUG_PRINTF("%02X ", byte);  // Print each byte in hex
+                for (uint16_t b = 0; b < frame.len; b++) {
+                    DEBUG_PRINTF("%02X ", frame[b]);  // Print each byte in hex
                 }
                 DEBUG_PRINTF("\n");
             }
 
-            // Simulate sending & receiving
-            InverterSim::processFrameQueue(frames);
+            // Hand frames to the transaction engine; responses are decoded
+            // from loop() and the cycle closes in finishCycle()
+            InverterSim::processFrameQueue(frameQueue);
             
             frameQueue.clear();
-
-
-            // Append filtered data to buffer
-            Buffer::appendFromTemporary(requestSim);
-
-            // printGlobalRequestSim();
-            
-
-            // 🔍 Print main buffer contents
-            const auto& allSnapshots = Buffer::getAll();
-            Serial.printf("[MainBuffer] 📊 Total snapshots: %d\n", (int)allSnapshots.size());
-
-            for (size_t s = 0; s < allSnapshots.size(); ++s) {
-                const auto& snap = allSnapshots[s];
-                Serial.printf("  Snapshot %d @ %s\n", (int)s + 1, snap.timestamp.c_str());
-                yield();  // Prevent buffer overflow
-
-                // Print register values
-                for (size_t i = 0; i < snap.values.size(); ++i) {
-                        Serial.printf("    R%-3d = %.2f\n", (int)i, snap.values[i]);
-                        if (i % 5 == 0) yield();  // Prevent buffer overflow every 5 values
-                }
-            }
+            cycleOpen = true;
         }
     }
 
@@ -1,99 +1,173 @@
 #include "protocol_adapter.h"
 #include "frame_queue.h"
 #include "debug_utils.h"
+#include "modbus_utils.h"
+#include "read_planner.h"
+#include "write_planner.h"
+
+namespace {
+    bool writeMultipleEnabled = true;   // use FC16 until the device rejects it
+}
 
 namespace ProtocolAdapter {
 
-    // CRC16 (Modbus standard)
-    uint16_t modbusCRC(uint8_t *buf, int len) {
-        uint16_t crc = 0xFFFF;
-        for (int pos = 0; pos < len; pos++) {
-            crc ^= buf[pos];
-            for (int i = 0; i < 8; i++) {
-                crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
-            }
+    // Build Modbus Request Frame
+    FramePool::Handle BuildRequestFrame(uint8_t slaveAddr, uint8_t funcCode,
+                                        uint16_t startAddr, uint16_t numReg,
+                                        uint16_t data /* = 0 */) {
+        if (funcCode != 0x03 && funcCode != 0x06) return FramePool::NONE;
+
+        FramePool::Handle h = FramePool::acquire();
+        if (h == FramePool::NONE) return h;
+        FramePool::Frame& frame = FramePool::get(h);
+
+        // READ Holding Registers carries the count, WRITE Single Register the value
+        uint16_t word = (funcCode == 0x03) ? numReg : data;
+        frame.bytes[0] = slaveAddr;
+        frame.bytes[1] = funcCode;
+        frame.bytes[2] = (startAddr >> 8) & 0xFF; 
+        frame.bytes[3] = startAddr & 0xFF;
+        frame.bytes[4] = (word >> 8) & 0xFF;
+        frame.bytes[5] = word & 0xFF;
+
+        uint16_t crc = Modbus::modbusCRC(frame.bytes, 6);
+        frame.bytes[6] = crc & 0xFF;
+        frame.bytes[7] = (crc >> 8) & 0xFF;
+        frame.len = 8;
+
+        return h;
+    }
+
+    // Build Modbus Write Multiple Registers (0x10) frame
+    FramePool::Handle BuildRequestFrame(uint8_t slaveAddr, uint8_t funcCode, uint16_t startAddr,
+                                        const uint16_t* values, uint16_t numReg) {
+        uint8_t byteCount = (uint8_t)(numReg * 2);
+        if (funcCode != 0x10 || numReg == 0 || numReg > WritePlanner::FC16_MAX_REGS ||
+            9 + (size_t)byteCount > FramePool::SLOT_BYTES) {
+            return FramePool::NONE;
         }
-        return crc;
+
+        FramePool::Handle h = FramePool::acquire();
+        if (h == FramePool::NONE) return h;
+        FramePool::Frame& frame = FramePool::get(h);
+
+        frame.bytes[0] = slaveAddr;
+        frame.bytes[1] = funcCode;
+        frame.bytes[2] = (startAddr >> 8) & 0xFF;
+        frame.bytes[3] = startAddr & 0xFF;
+        frame.bytes[4] = (numReg >> 8) & 0xFF;
+        frame.bytes[5] = numReg & 0xFF;
+        frame.bytes[6] = byteCount;
+
+        for (uint16_t i = 0; i < numReg; i++) {
+            frame.bytes[7 + i * 2] = (values[i] >> 8) & 0xFF;
+            frame.bytes[8 + i * 2] = values[i] & 0xFF;
+        }
+
+        uint16_t crc = Modbus::modbusCRC(frame.bytes, 7 + byteCount);
+        frame.bytes[7 + byteCount] = crc & 0xFF;
+        frame.bytes[8 + byteCount] = (crc >> 8) & 0xFF;
+        frame.len = 9 + byteCount;
+
+        return h;
     }
 
-    // Build Modbus Request Frame
-    vector<uint8_t> BuildRequestFrame(uint8_t slaveAddr, uint8_t funcCode,
-                                      uint16_t startAddr, uint16_t numReg,
-                                      uint16_t data /* = 0 */) {
-        vector<uint8_t> frame;
-
-        if (funcCode == 0x03) {
-            // READ Holding Registers
-            frame.resize(8);
-            frame[0] = slaveAddr;
-            frame[1] = funcCode;
-            frame[2] = (startAddr >> 8) & 0xFF; 
-            frame[3] = startAddr & 0xFF;
-            frame[4] = (numReg >> 8) & 0xFF;
-            frame[5] = numReg & 0xFF;
-
-            uint16_t crc = modbusCRC(frame.data(), 6);
-            frame[6] = crc & 0xFF;
-            frame[7] = (crc >> 8) & 0xFF;
-        } 
-        else if (funcCode == 0x06) {
-            // WRITE Single Register
-            frame.resize(8);
-            frame[0] = slaveAddr;
-            frame[1] = funcCode;
-            frame[2] = (startAddr >> 8) & 0xFF;
-            frame[3] = startAddr & 0xFF;
-            frame[4] = (data >> 8) & 0xFF;
-            frame[5] = data & 0xFF;
-
-            uint16_t crc = modbusCRC(frame.data(), 6);
-            frame[6] = crc & 0xFF;
-            frame[7] = (crc >> 8) & 0xFF;
+    // Split an FC16 frame into equivalent FC06 frames (fallback path)
+    size_t splitWriteMultiple(const FramePool::Frame& frame, FrameQueue& out) {
+        if (frame.len < 11 || frame[1] != 0x10) return 0;
+
+        uint8_t slaveAddr = frame[0];
+        uint16_t startAddr = (frame[2] << 8) | frame[3];
+        uint16_t numReg = (frame[4] << 8) | frame[5];
+        if (frame.len < (size_t)(9 + numReg * 2)) return 0;
+
+        size_t added = 0;
+        for (uint16_t i = 0; i < numReg; i++) {
+            uint16_t data = (frame[7 + i * 2] << 8) | frame[8 + i * 2];
+            if (out.push(BuildRequestFrame(slaveAddr, 0x06, startAddr + i, 1, data))) added++;
         }
+        return added;
+    }
 
-        return frame;
+    void setWriteMultipleEnabled(bool enabled) {
+        writeMultipleEnabled = enabled;
+        Serial.printf("[ProtocolAdapter] FC16 write batching %s\n", enabled ? "enabled" : "disabled (FC06 fallback)");
     }
 
+    bool isWriteMultipleEnabled() { return writeMultipleEnabled; }
+
     // Decode struct → Build & Queue frames
-    const vector<vector<uint8_t>>& decodeRequestStruct(const RequestSIM &input) {
-        const uint8_t slaveAddr = 0x01;
+    int decodeRequestStruct(const RequestSIM &input, uint8_t slaveAddr) {
+        Serial.printf("[ProtocolAdapter] Decoding RequestSIM for slave %u...\n", slaveAddr);
+        int unqueued = 0;
 
-        Serial.println("[ProtocolAdapter] Decoding RequestSIM...");
+        // Handle WRITE requests first: adjacent writes go out as one FC16 frame
+        for (const auto& range : WritePlanner::plan(input)) {
+            if (range.count > 1 && writeMultipleEnabled) {
+                FramePool::Handle frame = BuildRequestFrame(slaveAddr, 0x10, range.startAddr,
+                                                            input.writeData + range.startAddr, range.count);
+                if (!frameQueue.push(frame)) {
+                    Serial.printf("[WRITE] ⚠️ R%d..R%d not queued (no frame slot)\n",
+                                  range.startAddr, range.startAddr + range.count - 1);
+                    unqueued++;
+                    continue;
+                }
+                Serial.printf("[WRITE] Queued R%d..R%d (FC16, %d regs)\n",
+                              range.startAddr, range.startAddr + range.count - 1, range.count);
+                continue;
+            }
 
-        // Handle WRITE requests first
-        for (int i = 0; i < NUM_REGISTERS; i++) {
-            if (input.write[i]) {
+            for (int i = range.startAddr; i < range.startAddr + range.count; i++) {
                 uint16_t data = input.writeData[i];
-                vector<uint8_t> frame = BuildRequestFrame(slaveAddr, 0x06, i, 1, data);
-                frameQueue.push_back(frame);
+                if (!frameQueue.push(BuildRequestFrame(slaveAddr, 0x06, i, 1, data))) {
+                    Serial.printf("[WRITE] ⚠️ R%d (Data=%d) not queued (no frame slot)\n", i, data);
+                    unqueued++;
+                    continue;
+                }
                 Serial.printf("[WRITE] Queued R%d (Data=%d)\n", i, data);
             }
         }
 
-        // Handle READ requests
-        for (int i = 0; i < NUM_REGISTERS; i++) {
-            if (input.read[i]) {
-            // Handle READ requests
-            vector<uint8_t> frame = BuildRequestFrame(slaveAddr, 0x03, 0, 10);
-            frameQueue.push_back(frame);
+        // Handle READ requests: coalesce the read[] bitmap into range reads
+        ReadPlan plan = ReadPlanner::plan(input);
+        for (const auto& range : plan.ranges) {
+            if (!frameQueue.push(BuildRequestFrame(slaveAddr, 0x03, range.startAddr, range.count))) {
+                Serial.printf("[READ]  ⚠️ R%d..R%d not queued (no frame slot)\n",
+                              range.startAddr, range.startAddr + range.count - 1);
+                unqueued++;
+                continue;
             }
+            Serial.printf("[READ]  Queued R%d..R%d\n", range.startAddr, range.startAddr + range.count - 1);
         }
-
-        // Handle READ requests
-        // for (int i = 0; i < NUM_REGISTERS; i++) {
-        //     if (input.read[i]) {
-        //         vector<uint8_t> frame = BuildRequestFrame(slaveAddr, 0x03, i, 1);
-        //         frameQueue.push_back(frame);
-        //         Serial.printf("[READ]  Queued R%d\n", i);
-        //     }
-        // }
+        ReadPlanner::printPlan(plan);
 
         Serial.printf("[ProtocolAdapter] Total frames queued: %d\n", (int)frameQueue.size());
-        return frameQueue;
+        return unqueued;
+    }
+
+    void interleaveBySlave(FrameQueue& frames) {
+        if (frames.size() < 3) return;
+
+        FramePool::Handle ordered[FrameQueue::CAPACITY];
+        bool taken[FrameQueue::CAPACITY] = {false};
+        size_t placed = 0;
+        while (placed < frames.size()) {
+            // One pass = the next untaken frame of every slave, in first-seen order
+            uint8_t seen[256 / 8] = {0};
+            for (size_t i = 0; i < frames.size(); i++) {
+                if (taken[i]) continue;
+                uint8_t addr = frames[i].slave();
+                if (seen[addr >> 3] & (1 << (addr & 7))) continue;
+                seen[addr >> 3] |= (uint8_t)(1 << (addr & 7));
+                taken[i] = true;
+                ordered[placed++] = frames.handles[i];
+            }
+        }
+        memcpy(frames.handles, ordered, placed);
     }
 
     // Accessors
-    const vector<vector<uint8_t>>& getFrameQueue() { return frameQueue; }
+    FrameQueue& getFrameQueue() { return frameQueue; }
     void clearFrameQueue() { frameQueue.clear(); }
 
 }  // namespace ProtocolAdapter
@@ -0,0 +1,74 @@
+#include "read_planner.h"
+#include "debug_utils.h"
+
+namespace {
+    uint16_t maxGap = ReadPlanner::DEFAULT_MAX_GAP;
+    uint16_t maxRegsPerFrame = ReadPlanner::DEFAULT_MAX_REGS_PER_FRAME;
+}
+
+namespace ReadPlanner {
+
+    void setLimits(uint16_t gap, uint16_t regsPerFrame) {
+        if (regsPerFrame < 1) regsPerFrame = 1;
+        if (regsPerFrame > FC03_MAX_REGS) regsPerFrame = FC03_MAX_REGS;
+        maxGap = gap;
+        maxRegsPerFrame = regsPerFrame;
+        DEBUG_PRINTF("[ReadPlanner] Limits set: maxGap=%u, maxRegsPerFrame=%u\n",
+                     maxGap, maxRegsPerFrame);
+    }
+
+    uint16_t getMaxGap() { return maxGap; }
+    uint16_t getMaxRegsPerFrame() { return maxRegsPerFrame; }
+
+    ReadPlan plan(const RequestSIM& input) {
+        return plan(input.read, NUM_REGISTERS);
+    }
+
+    ReadPlan plan(const bool* read, int count) {
+        uint32_t mask = 0;
+        for (int i = 0; i < count && i < REGISTER_COUNT; i++) {
+            if (read[i]) mask |= 1UL << i;
+        }
+        return plan(mask);
+    }
+
+    ReadPlan plan(uint32_t mask) {
+        mask &= RegisterMap::ALL_MASK;
+        bool defaults = maxGap == DEFAULT_MAX_GAP && maxRegsPerFrame == DEFAULT_MAX_REGS_PER_FRAME;
+        MaskPlan mp = (defaults && mask == RegisterMap::ALL_MASK)
+                          ? FULL_READ_PLAN
+                          : planMask(mask, maxGap, maxRegsPerFrame);
+
+        ReadPlan result{};
+        result.ranges.assign(mp.ranges, mp.ranges + mp.count);
+        result.wantedRegs = mp.wanted;
+        result.extraRegs = mp.extra;
+        for (const auto& range : result.ranges) {
+            result.requestBytes  += FC03_REQUEST_BYTES;
+            result.responseBytes += FC03_RESPONSE_BASE + range.count * 2;
+        }
+        return result;
+    }
+
+    void printPlan(const ReadPlan& plan) {
+        // Baseline: the pre-planner adapter queued one full-map FC03
+        // (R0..R{REGISTER_COUNT-1}) for every wanted register
+        size_t naiveFrames = plan.wantedRegs;
+        size_t naiveBytes  = naiveFrames * (FC03_REQUEST_BYTES + FC03_RESPONSE_BASE + 2 * REGISTER_COUNT);
+
+        DEBUG_PRINTF("[ReadPlanner] 🗺️ %u range(s) for %u wanted reg(s), %u gap reg(s)\n",
+                     (unsigned)plan.frameCount(), (unsigned)plan.wantedRegs,
+                     (unsigned)plan.extraRegs);
+#if DEBUG_ENABLED
+        for (const auto& r : plan.ranges) {
+            DEBUG_PRINTF("   FC03 R%u..R%u (%u regs)\n",
+                         r.startAddr, r.startAddr + r.count - 1, r.count);
+        }
+#endif
+        Serial.printf("[ReadPlanner] Frames: %u (vs %u) | Wire bytes: %u req + %u resp = %u (vs %u)\n",
+                     (unsigned)plan.frameCount(), (unsigned)naiveFrames,
+                     (unsigned)plan.requestBytes, (unsigned)plan.responseBytes,
+                     (unsigned)plan.wireBytes(), (unsigned)naiveBytes);
+    }
+
+}  // namespace ReadPlanner
@@ -0,0 +1,54 @@
+#include "register_map.h"
+#include <string.h>
+
+namespace {
+
+    // Names and units live in flash; only the tables in register_map.h are constexpr
+#define REGISTER_NAME_STRING(addr, name, scale, unit, writable) \
+    const char NAME_R##addr[] PROGMEM = name;                       \
+    static_assert(sizeof(name) <= RegisterMap::NAME_CHARS, "Register name too long");
+    REGISTER_MAP_ENTRIES(REGISTER_NAME_STRING)
+#undef REGISTER_NAME_STRING
+
+#define REGISTER_NAME_POINTER(addr, name, scale, unit, writable) NAME_R##addr,
+    const char* const NAMES[] PROGMEM = { REGISTER_MAP_ENTRIES(REGISTER_NAME_POINTER) };
+#undef REGISTER_NAME_POINTER
+
+    const char UNIT_V[] PROGMEM = "V";
+    const char UNIT_A[] PROGMEM = "A";
+    const char UNIT_HZ[] PROGMEM = "Hz";
+    const char UNIT_C[] PROGMEM = "°C";
+    const char UNIT_PCT[] PROGMEM = "%";
+    const char UNIT_W[] PROGMEM = "W";
+    const char* const UNITS[] PROGMEM = { UNIT_V, UNIT_A, UNIT_HZ, UNIT_C, UNIT_PCT, UNIT_W };
+
+    static_assert(sizeof(NAMES) / sizeof(NAMES[0]) == (size_t)REGISTER_COUNT, "One name per register");
+    static_assert(sizeof(UNITS) / sizeof(UNITS[0]) == UNIT_KINDS, "One string per RegisterUnit");
+
+    const char* copyFlash(const char* const* table, int i, char* buf, size_t cap) {
+        if (cap == 0) return buf;
+        strncpy_P(buf, (const char*)pgm_read_ptr(&table[i]), cap - 1);
+        buf[cap - 1] = '\0';
+        return buf;
+    }
+}
+
+namespace RegisterMap {
+
+    const char* name(int reg, char* buf, size_t cap) {
+        if (reg < 0 || reg >= REGISTER_COUNT) {
+            snprintf(buf, cap, "R%d", reg);
+            return buf;
+        }
+        return copyFlash(NAMES, reg, buf, cap);
+    }
+
+    const char* unit(int reg, char* buf, size_t cap) {
+        if (reg < 0 || reg >= REGISTER_COUNT) {
+            if (cap) buf[0] = '\0';
+            return buf;
+        }
+        return copyFlash(UNITS, registerMap[reg].unit, buf, cap);
+    }
+
+}  // namespace RegisterMap
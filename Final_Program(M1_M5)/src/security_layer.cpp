@@ -101,6 +101,10 @@ std::vector<uint8_t> encryptBuffer(const std::vector<uint8_t>& plain){
   return packet;
 }
 
+void ensureSequenceAbove(uint32_t seq){
+  if(seqCounter <= seq) seqCounter = seq + 1;
+}
+
 // ======================================================================
 //                            DECRYPTION
 // ======================================================================
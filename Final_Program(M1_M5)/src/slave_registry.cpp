@@ -0,0 +1,238 @@
+#include "slave_registry.h"
+#include "debug_utils.h"
+
+namespace {
+    struct Slave {
+        uint8_t address;
+        bool ownRequest;           // false: follow the global requestSim
+        RequestSIM request;
+        uint8_t failStreak;        // polled cycles in a row without a response
+        uint16_t skipLeft;         // cycles still skipped
+        bool polled;               // polled in the running cycle
+        bool responded;            // answered at least one frame this cycle
+        SlaveRegistry::Stats stats;
+    };
+
+    const uint8_t DEFAULT_SLAVES[] = { INVERTER_SLAVES };
+
+    Slave slaves[SlaveRegistry::MAX_SLAVES];
+    uint8_t slaveCount = 0;
+
+    void resetSlave(Slave& s, uint8_t address) {
+        s.address = address;
+        s.ownRequest = false;
+        s.request.clear();
+        s.failStreak = 0;
+        s.skipLeft = 0;
+        s.polled = false;
+        s.responded = false;
+        s.stats = SlaveRegistry::Stats{};
+    }
+
+    // Parses "[1,0,1,...]" starting at `from` into read[]; false if no array
+    bool parseReadArray(const String& obj, int from, RequestSIM& req) {
+        int arrayStart = obj.indexOf('[', from);
+        int arrayEnd = obj.indexOf(']', arrayStart);
+        if (arrayStart == -1 || arrayEnd == -1) return false;
+
+        req.clear();
+        int idx = 0;
+        int lastPos = arrayStart + 1;
+        while (idx < NUM_REGISTERS && lastPos < arrayEnd) {
+            int comma = obj.indexOf(',', lastPos);
+            if (comma == -1 || comma > arrayEnd) comma = arrayEnd;
+            String token = obj.substring(lastPos, comma);
+            token.trim();
+            req.read[idx] = token.toInt() != 0;
+            idx++;
+            lastPos = comma + 1;
+        }
+        return true;
+    }
+}
+
+namespace SlaveRegistry {
+
+    void begin() {
+        clear();
+        for (uint8_t address : DEFAULT_SLAVES) add(address);
+        Serial.printf("[Slaves] %u inverter(s) on the bus\n", slaveCount);
+    }
+
+    uint8_t count() { return slaveCount; }
+
+    uint8_t address(uint8_t index) {
+        return index < slaveCount ? slaves[index].address : NO_SLAVE;
+    }
+
+    int indexOf(uint8_t address) {
+        for (uint8_t i = 0; i < slaveCount; i++) {
+            if (slaves[i].address == address) return i;
+        }
+        return -1;
+    }
+
+    uint8_t defaultAddress() {
+        return slaveCount ? slaves[0].address : DEFAULT_SLAVES[0];
+    }
+
+    bool add(uint8_t address) {
+        if (address < 1 || address > 247) {
+            Serial.printf("[Slaves] ⚠️ Invalid slave address %u\n", address);
+            return false;
+        }
+        if (indexOf(address) >= 0) return false;
+        if (slaveCount >= MAX_SLAVES) {
+            Serial.printf("[Slaves] ⚠️ Slave %u dropped, already %u slaves\n", address, MAX_SLAVES);
+            return false;
+        }
+        resetSlave(slaves[slaveCount++], address);
+        return true;
+    }
+
+    void clear() { slaveCount = 0; }
+
+    const RequestSIM& request(uint8_t index) {
+        if (index >= slaveCount || !slaves[index].ownRequest) return requestSim;
+        return slaves[index].request;
+    }
+
+    void setRequest(uint8_t index, const RequestSIM& req) {
+        if (index >= slaveCount) return;
+        slaves[index].request = req;
+        slaves[index].ownRequest = true;
+    }
+
+    void followDefaultRequest(uint8_t index) {
+        if (index < slaveCount) slaves[index].ownRequest = false;
+    }
+
+    void updateFromConfig(const String& json) {
+        int key = json.indexOf("\"slaves\"");
+        if (key == -1) return;
+        int pos = json.indexOf('[', key);
+        if (pos == -1) return;
+        int firstObject = json.indexOf('{', pos);
+        int close = json.indexOf(']', pos);
+        if (firstObject == -1 || (close != -1 && close < firstObject)) return;   // [] = keep the list
+
+        // Objects of the array hold no nested braces: {"address":2,"reg_read":[...]}
+        Slave previous[MAX_SLAVES];
+        uint8_t previousCount = slaveCount;
+        for (uint8_t i = 0; i < slaveCount; i++) previous[i] = slaves[i];
+        clear();
+
+        pos++;
+        while (true) {
+            while (pos < (int)json.length() && (json[pos] == ' ' || json[pos] == ',' ||
+                                                json[pos] == '\n' || json[pos] == '\r')) pos++;
+            if (pos >= (int)json.length() || json[pos] != '{') break;
+            int end = json.indexOf('}', pos);
+            if (end == -1) break;
+            String obj = json.substring(pos, end + 1);
+            pos = end + 1;
+
+            int addrKey = obj.indexOf("\"address\"");
+            if (addrKey == -1) continue;
+            long address = obj.substring(obj.indexOf(':', addrKey) + 1).toInt();
+            if (address < 0 || address > 255 || !add((uint8_t)address)) continue;
+
+            // Health carries over for slaves that stay on the list
+            Slave& s = slaves[slaveCount - 1];
+            for (uint8_t i = 0; i < previousCount; i++) {
+                if (previous[i].address == s.address) {
+                    s.failStreak = previous[i].failStreak;
+                    s.skipLeft = previous[i].skipLeft;
+                    s.stats = previous[i].stats;
+                }
+            }
+
+            int readKey = obj.indexOf("\"reg_read\"");
+            if (readKey != -1 && parseReadArray(obj, readKey, s.request)) s.ownRequest = true;
+        }
+
+        // An empty or unusable list keeps the build-time default device
+        if (slaveCount == 0) {
+            Serial.println("[Slaves] ⚠️ No valid slave in config, keeping the previous list");
+            for (uint8_t i = 0; i < previousCount; i++) slaves[i] = previous[i];
+            slaveCount = previousCount;
+            return;
+        }
+
+        Serial.printf("[Slaves] ✅ %u slave(s) from config:", slaveCount);
+        for (uint8_t i = 0; i < slaveCount; i++) {
+            Serial.printf(" %u%s", slaves[i].address, slaves[i].ownRequest ? "*" : "");
+        }
+        Serial.println(" (* = own reg_read)");
+    }
+
+    // ------------------------------------------------------------
+    // Health: back off from slaves that stop answering
+    // ------------------------------------------------------------
+    bool shouldPoll(uint8_t index) {
+        if (index >= slaveCount) return false;
+        Slave& s = slaves[index];
+        if (s.skipLeft == 0) return true;
+        s.skipLeft--;
+        s.stats.skippedCycles++;
+        return false;
+    }
+
+    void beginCycle(uint8_t index) {
+        if (index >= slaveCount) return;
+        slaves[index].polled = true;
+        slaves[index].responded = false;
+        slaves[index].stats.cycles++;
+    }
+
+    void recordResponse(uint8_t address) {
+        int i = indexOf(address);
+        if (i < 0) return;
+        slaves[i].responded = true;
+        slaves[i].stats.responses++;
+    }
+
+    void endCycle() {
+        for (uint8_t i = 0; i < slaveCount; i++) {
+            Slave& s = slaves[i];
+            if (!s.polled) continue;
+            s.polled = false;
+
+            if (s.responded) {
+                if (s.failStreak >= SLAVE_FAILS_BEFORE_SKIP) {
+                    Serial.printf("[Slaves] ✅ Slave %u answering again\n", s.address);
+                }
+                s.failStreak = 0;
+                continue;
+            }
+
+            s.stats.silentCycles++;
+            if (s.failStreak < 255) s.failStreak++;
+            if (s.failStreak >= SLAVE_FAILS_BEFORE_SKIP) {
+                // 2, 4, 8, ... cycles, capped
+                uint8_t shift = s.failStreak - SLAVE_FAILS_BEFORE_SKIP + 1;
+                uint32_t skip = shift < 16 ? (1UL << shift) : SLAVE_MAX_SKIP_CYCLES;
+                s.skipLeft = (uint16_t)(skip < SLAVE_MAX_SKIP_CYCLES ? skip : SLAVE_MAX_SKIP_CYCLES);
+                Serial.printf("[Slaves] ⚠️ Slave %u silent for %u cycle(s), skipping %u\n",
+                              s.address, s.failStreak, s.skipLeft);
+            }
+        }
+    }
+
+    const Stats& stats(uint8_t index) {
+        static const Stats none = {};
+        return index < slaveCount ? slaves[index].stats : none;
+    }
+
+    void printStats() {
+#if DEBUG_ENABLED
+        for (uint8_t i = 0; i < slaveCount; i++) {
+            const Slave& s = slaves[i];
+            DEBUG_PRINTF("[Slaves] #%u: cycles=%u silent=%u skipped=%u responses=%u\n",
+                         s.address, s.stats.cycles, s.stats.silentCycles,
+                         s.stats.skippedCycles, s.stats.responses);
+        }
+#endif
+    }
+
+}  // namespace SlaveRegistry
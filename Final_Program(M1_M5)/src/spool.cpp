@@ -0,0 +1,449 @@
+#include "spool.h"
+#include "modbus_utils.h"
+#include "debug_utils.h"
+#include <LittleFS.h>
+#include <algorithm>
+
+namespace {
+    using Spool::SegmentInfo;
+
+    bool ready = false;
+    uint32_t budget = SPOOL_BUDGET_BYTES;
+
+    SegmentInfo segs[Spool::MAX_SEGMENTS];   // oldest first
+    size_t segCount = 0;
+    bool activeOpen = false;      // segs[segCount - 1] still takes appends
+    uint32_t nextId = 1;
+    uint32_t maxSeq = 0;
+
+    // Oldest undelivered record
+    uint32_t cursorOffset = 0;    // in segs[0]
+    uint32_t deliveredInHead = 0; // records of segs[0] before the cursor
+    uint32_t peekedBytes = 0;     // record returned by peekOldest()
+
+    Spool::Stats spoolStats = {};
+
+    // ---------------- little-endian helpers ----------------
+    void put16(uint8_t* p, uint16_t v) { p[0] = v & 0xFF; p[1] = v >> 8; }
+    void put32(uint8_t* p, uint32_t v) { put16(p, v & 0xFFFF); put16(p + 2, v >> 16); }
+    uint16_t get16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+    uint32_t get32(const uint8_t* p) { return get16(p) | ((uint32_t)get16(p + 2) << 16); }
+
+    String segPath(uint32_t id) {
+        char path[32];
+        snprintf(path, sizeof(path), "%s/%08X.seg", Spool::SPOOL_DIR, id);
+        return String(path);
+    }
+
+    String dirPath(const char* name) {
+        return String(Spool::SPOOL_DIR) + "/" + name;
+    }
+
+    void encodeHeader(uint8_t* h, uint16_t len, uint32_t seq, uint32_t first, uint32_t last) {
+        put16(h + 0, Spool::RECORD_MAGIC);
+        put16(h + 2, len);
+        put32(h + 4, seq);
+        put32(h + 8, first);
+        put32(h + 12, last);
+        put16(h + 16, 0);
+    }
+
+    // Reads the header at the file position; false at end of data or on a bad header
+    bool readHeader(File& f, uint8_t* h, Spool::BatchInfo& info) {
+        if (f.read(h, Spool::RECORD_HEADER_BYTES) != Spool::RECORD_HEADER_BYTES) return false;
+        if (get16(h) != Spool::RECORD_MAGIC) return false;
+        info.length = get16(h + 2);
+        info.seq = get32(h + 4);
+        info.firstEpoch = get32(h + 8);
+        info.lastEpoch = get32(h + 12);
+        return info.length > 0;
+    }
+
+    // Reads the payload after a header and checks the record CRC.
+    // With out == nullptr the payload is only checked, in small chunks.
+    bool readPayload(File& f, const uint8_t* h, uint16_t len, uint8_t* out) {
+        uint16_t crc = Modbus::crcUpdate(Modbus::CRC_INIT, h, Spool::RECORD_HEADER_BYTES - 2);
+        if (out) {
+            if (f.read(out, len) != len) return false;
+            crc = Modbus::crcUpdate(crc, out, len);
+        } else {
+            uint8_t chunk[64];
+            for (uint16_t left = len; left > 0;) {
+                size_t n = left < sizeof(chunk) ? left : sizeof(chunk);
+                if (f.read(chunk, n) != n) return false;
+                crc = Modbus::crcUpdate(crc, chunk, n);
+                left -= n;
+            }
+        }
+        return crc == get16(h + 18);
+    }
+
+    // Rebuilds one segment's summary from its records; a torn or corrupt
+    // tail (power loss mid-append) is cut off
+    bool scanSegment(uint32_t id, SegmentInfo& seg) {
+        File f = LittleFS.open(segPath(id), "r");
+        if (!f) return false;
+
+        seg = { id, 0, 0, 0, 0, 0, 0 };
+        uint32_t fileSize = f.size();
+        uint8_t h[Spool::RECORD_HEADER_BYTES];
+        Spool::BatchInfo info;
+
+        while (seg.bytes < fileSize && readHeader(f, h, info) && readPayload(f, h, info.length, nullptr)) {
+            if (seg.batches == 0) { seg.firstSeq = info.seq; seg.firstEpoch = info.firstEpoch; }
+            seg.lastSeq = info.seq;
+            seg.lastEpoch = info.lastEpoch;
+            seg.batches++;
+            seg.bytes += Spool::RECORD_HEADER_BYTES + info.length;
+        }
+        f.close();
+
+        if (seg.bytes < fileSize) {
+            DEBUG_PRINTF("[Spool] ⚠️ Segment %08X: dropped %u B of torn/corrupt data\n",
+                         id, fileSize - seg.bytes);
+            spoolStats.corrupt++;
+            File w = LittleFS.open(segPath(id), "r+");
+            if (w) { w.truncate(seg.bytes); w.close(); }
+        }
+        return true;
+    }
+
+    void writeIndex() {
+        size_t sealed = activeOpen ? segCount - 1 : segCount;
+        String tmp = dirPath("index.tmp");
+        File f = LittleFS.open(tmp, "w");
+        if (!f) return;
+
+        uint8_t head[8];
+        put32(head, Spool::INDEX_MAGIC);
+        put16(head + 4, Spool::INDEX_VERSION);
+        put16(head + 6, (uint16_t)sealed);
+        f.write(head, sizeof(head));
+        for (size_t i = 0; i < sealed; i++) {
+            uint8_t e[28];
+            const SegmentInfo& s = segs[i];
+            put32(e + 0, s.id);         put32(e + 4, s.bytes);
+            put32(e + 8, s.firstSeq);   put32(e + 12, s.lastSeq);
+            put32(e + 16, s.firstEpoch); put32(e + 20, s.lastEpoch);
+            put32(e + 24, s.batches);
+            f.write(e, sizeof(e));
+        }
+        f.close();
+        LittleFS.rename(tmp, dirPath("index"));
+    }
+
+    // Sealed segments from the index file (count returned, 0 if absent)
+    size_t readIndex(SegmentInfo* out, size_t cap) {
+        File f = LittleFS.open(dirPath("index"), "r");
+        if (!f) return 0;
+        uint8_t head[8];
+        size_t n = 0;
+        if (f.read(head, sizeof(head)) == sizeof(head) &&
+            get32(head) == Spool::INDEX_MAGIC && get16(head + 4) == Spool::INDEX_VERSION) {
+            uint16_t count = get16(head + 6);
+            uint8_t e[28];
+            while (n < count && n < cap && f.read(e, sizeof(e)) == sizeof(e)) {
+                out[n++] = { get32(e), get32(e + 4), get32(e + 8), get32(e + 12),
+                             get32(e + 16), get32(e + 20), get32(e + 24) };
+            }
+        }
+        f.close();
+        return n;
+    }
+
+    void writeCursor() {
+        uint8_t c[10];
+        put32(c, segCount ? segs[0].id : 0);
+        put32(c + 4, cursorOffset);
+        put16(c + 8, Modbus::modbusCRC(c, 8));
+        File f = LittleFS.open(dirPath("cursor"), "w");
+        if (!f) return;
+        f.write(c, sizeof(c));
+        f.close();
+    }
+
+    void readCursor() {
+        cursorOffset = 0;
+        deliveredInHead = 0;
+        if (segCount == 0) return;
+
+        File f = LittleFS.open(dirPath("cursor"), "r");
+        if (!f) return;
+        uint8_t c[10];
+        bool ok = f.read(c, sizeof(c)) == sizeof(c) && get16(c + 8) == Modbus::modbusCRC(c, 8);
+        f.close();
+        if (!ok || get32(c) != segs[0].id) return;   // head segment changed: start at its top
+
+        // Count the delivered records in front of the cursor
+        uint32_t target = get32(c + 4);
+        File s = LittleFS.open(segPath(segs[0].id), "r");
+        if (!s) return;
+        uint8_t h[Spool::RECORD_HEADER_BYTES];
+        Spool::BatchInfo info;
+        while (cursorOffset < target && readHeader(s, h, info)) {
+            cursorOffset += Spool::RECORD_HEADER_BYTES + info.length;
+            s.seek(cursorOffset, SeekSet);
+            deliveredInHead++;
+        }
+        s.close();
+    }
+
+    void removeHead() {
+        if (segCount == 0) return;
+        LittleFS.remove(segPath(segs[0].id));
+        for (size_t i = 1; i < segCount; i++) segs[i - 1] = segs[i];
+        segCount--;
+        if (segCount == 0) activeOpen = false;
+        cursorOffset = 0;
+        deliveredInHead = 0;
+        peekedBytes = 0;
+        writeIndex();
+        writeCursor();
+    }
+
+    uint32_t totalBytes() {
+        uint32_t sum = 0;
+        for (size_t i = 0; i < segCount; i++) sum += segs[i].bytes;
+        return sum;
+    }
+
+    bool startSegment() {
+        if (activeOpen) {
+            activeOpen = false;   // seal the current one
+            spoolStats.rotations++;
+            writeIndex();
+        }
+        if (segCount >= Spool::MAX_SEGMENTS) {
+            spoolStats.dropped += segs[0].batches - deliveredInHead;
+            removeHead();
+        }
+        segs[segCount++] = { nextId++, 0, 0, 0, 0, 0, 0 };
+        activeOpen = true;
+        return true;
+    }
+}
+
+namespace Spool {
+
+    bool begin() {
+        ready = false;
+        segCount = 0;
+        activeOpen = false;
+
+        if (!LittleFS.begin()) {
+            Serial.println("[Spool] ❌ LittleFS mount failed, spooling disabled");
+            return false;
+        }
+        LittleFS.mkdir(SPOOL_DIR);
+
+        // Leave at least half of the filesystem to everything else
+        FSInfo info;
+        if (LittleFS.info(info)) {
+            budget = min((uint32_t)SPOOL_BUDGET_BYTES, (uint32_t)(info.totalBytes / 2));
+        }
+        if (budget < 2 * SPOOL_SEGMENT_BYTES) budget = 2 * SPOOL_SEGMENT_BYTES;
+
+        // Segment files present, oldest first; beyond MAX_SEGMENTS the oldest go
+        std::vector<uint32_t> ids;
+        Dir dir = LittleFS.openDir(SPOOL_DIR);
+        while (dir.next()) {
+            String name = dir.fileName();
+            if (!name.endsWith(".seg")) continue;
+            uint32_t id = strtoul(name.c_str(), nullptr, 16);
+            if (id != 0) ids.push_back(id);
+        }
+        std::sort(ids.begin(), ids.end());
+        while (ids.size() > MAX_SEGMENTS) {
+            LittleFS.remove(segPath(ids.front()));
+            ids.erase(ids.begin());
+        }
+        size_t idCount = ids.size();
+
+        // Trust the index where it matches the file, scan otherwise
+        SegmentInfo indexed[MAX_SEGMENTS];
+        size_t indexedCount = readIndex(indexed, MAX_SEGMENTS);
+        bool indexStale = false;
+        for (size_t i = 0; i < idCount; i++) {
+            bool last = (i + 1 == idCount);
+            SegmentInfo seg = {};
+            bool found = false;
+            for (size_t k = 0; k < indexedCount && !last; k++) {
+                if (indexed[k].id != ids[i]) continue;
+                File f = LittleFS.open(segPath(ids[i]), "r");
+                found = f && f.size() == indexed[k].bytes;
+                if (f) f.close();
+                if (found) seg = indexed[k];
+                break;
+            }
+            if (!found) {
+                if (!scanSegment(ids[i], seg)) continue;
+                if (!last) indexStale = true;
+            }
+            if (seg.batches == 0) {              // nothing usable in it
+                LittleFS.remove(segPath(ids[i]));
+                indexStale = true;
+                continue;
+            }
+            segs[segCount++] = seg;
+        }
+        if (segCount > 0) {
+            nextId = segs[segCount - 1].id + 1;
+            maxSeq = segs[segCount - 1].lastSeq;
+            activeOpen = segs[segCount - 1].bytes < SPOOL_SEGMENT_BYTES;
+        }
+        if (indexStale || indexedCount != (activeOpen ? segCount - 1 : segCount)) writeIndex();
+
+        readCursor();
+        ready = true;
+
+        Serial.printf("[Spool] ✅ Ready: %u batch(es), %u B pending in %u segment(s), budget %u B\n",
+                      pendingBatches(), pendingBytes(), (unsigned)segCount, budget);
+        return true;
+    }
+
+    bool isReady() { return ready; }
+
+    bool isEmpty() { return pendingBatches() == 0; }
+
+    uint32_t pendingBatches() {
+        uint32_t n = 0;
+        for (size_t i = 0; i < segCount; i++) n += segs[i].batches;
+        return n - deliveredInHead;
+    }
+
+    uint32_t pendingBytes() {
+        return totalBytes() - cursorOffset;
+    }
+
+    uint32_t highestSeq() { return maxSeq; }
+
+    bool append(const std::vector<uint8_t>& packet, uint32_t firstEpoch, uint32_t lastEpoch) {
+        if (!ready || packet.size() < 4 || packet.size() > 0xFFFF) return false;
+
+        uint16_t len = (uint16_t)packet.size();
+        uint32_t recordBytes = RECORD_HEADER_BYTES + len;
+        uint32_t seq = get32(packet.data());
+
+        // Budget: oldest segments go first
+        while (segCount > 0 && totalBytes() + recordBytes > budget) {
+            uint32_t lost = segs[0].batches - deliveredInHead;
+            spoolStats.dropped += lost;
+            Serial.printf("[Spool] ⚠️ Budget full: dropping segment %08X (%u batch(es))\n",
+                          segs[0].id, lost);
+            removeHead();
+        }
+
+        if (!activeOpen || (segs[segCount - 1].bytes > 0 &&
+                            segs[segCount - 1].bytes + recordBytes > SPOOL_SEGMENT_BYTES)) {
+            startSegment();
+        }
+        SegmentInfo& seg = segs[segCount - 1];
+
+        uint8_t h[RECORD_HEADER_BYTES];
+        encodeHeader(h, len, seq, firstEpoch, lastEpoch);
+        uint16_t crc = Modbus::crcUpdate(Modbus::CRC_INIT, h, RECORD_HEADER_BYTES - 2);
+        put16(h + 18, Modbus::crcUpdate(crc, packet.data(), len));
+
+        File f = LittleFS.open(segPath(seg.id), "a");
+        if (!f) {
+            Serial.println("[Spool] ❌ Cannot open segment for append");
+            return false;
+        }
+        size_t written = f.write(h, sizeof(h));
+        written += f.write(packet.data(), len);
+        f.close();
+        if (written != recordBytes) {
+            // Partial record: the next begin() scan cuts it off
+            Serial.println("[Spool] ❌ Short write (filesystem full?)");
+            activeOpen = false;
+            return false;
+        }
+
+        if (seg.batches == 0) { seg.firstSeq = seq; seg.firstEpoch = firstEpoch; }
+        seg.lastSeq = seq;
+        seg.lastEpoch = lastEpoch;
+        seg.batches++;
+        seg.bytes += recordBytes;
+        if (seq > maxSeq) maxSeq = seq;
+
+        spoolStats.appended++;
+        spoolStats.bytesWritten += recordBytes;
+        DEBUG_PRINTF("[Spool] 💾 Spooled batch #%u (%u B) → segment %08X\n", seq, len, seg.id);
+        return true;
+    }
+
+    bool peekOldest(std::vector<uint8_t>& packet, BatchInfo* infoOut) {
+        peekedBytes = 0;
+        while (ready && segCount > 0) {
+            SegmentInfo& head = segs[0];
+            if (cursorOffset >= head.bytes) {          // head fully delivered
+                if (activeOpen && segCount == 1) return false;
+                removeHead();
+                continue;
+            }
+
+            File f = LittleFS.open(segPath(head.id), "r");
+            if (!f) { removeHead(); continue; }
+            f.seek(cursorOffset, SeekSet);
+
+            uint8_t h[RECORD_HEADER_BYTES];
+            BatchInfo info;
+            if (!readHeader(f, h, info)) {
+                // Unreadable from here on: skip the rest of the segment
+                f.close();
+                spoolStats.corrupt++;
+                spoolStats.dropped += head.batches - deliveredInHead;
+                deliveredInHead = head.batches;
+                cursorOffset = head.bytes;
+                continue;
+            }
+            packet.resize(info.length);
+            bool ok = readPayload(f, h, info.length, packet.data());
+            f.close();
+
+            if (!ok) {                                 // skip this record only
+                spoolStats.corrupt++;
+                spoolStats.dropped++;
+                cursorOffset += RECORD_HEADER_BYTES + info.length;
+                deliveredInHead++;
+                writeCursor();
+                continue;
+            }
+            peekedBytes = RECORD_HEADER_BYTES + info.length;
+            if (infoOut) *infoOut = info;
+            return true;
+        }
+        return false;
+    }
+
+    void commitOldest() {
+        if (peekedBytes == 0 || segCount == 0) return;
+        cursorOffset += peekedBytes;
+        deliveredInHead++;
+        peekedBytes = 0;
+        spoolStats.delivered++;
+
+        // A drained segment is deleted (an open one too: the next append
+        // starts a new file); removeHead() also rewrites the cursor
+        if (cursorOffset >= segs[0].bytes) removeHead();
+        else writeCursor();
+    }
+
+    void clear() {
+        while (segCount > 0) removeHead();
+        LittleFS.remove(dirPath("cursor"));
+        DEBUG_PRINTLN("[Spool] 🧹 Spool cleared.");
+    }
+
+    const Stats& stats() { return spoolStats; }
+
+    void printStats() {
+        if (!ready) return;
+        Serial.printf("[Spool] pending=%u batch(es)/%u B in %u seg | appended=%u delivered=%u "
+                      "dropped=%u corrupt=%u rotations=%u written=%u B\n",
+                      pendingBatches(), pendingBytes(), (unsigned)segCount,
+                      spoolStats.appended, spoolStats.delivered, spoolStats.dropped,
+                      spoolStats.corrupt, spoolStats.rotations, spoolStats.bytesWritten);
+    }
+
+}  // namespace Spool
@@ -1,22 +1,85 @@
 #include "temporary_buffer.h"
 #include "debug_utils.h"
+#include "slave_registry.h"
+
+namespace {
+    TemporaryBuffer::Stats counters = {};
+
+    // Prints the failed registers as ranges: "R0-R4 R8"
+    void printRanges(uint16_t mask) {
+        for (int i = 0; i < REGISTER_COUNT; i++) {
+            if (!((mask >> i) & 1)) continue;
+            int end = i;
+            while (end + 1 < REGISTER_COUNT && ((mask >> (end + 1)) & 1)) end++;
+            if (end == i) Serial.printf(" R%d", i);
+            else Serial.printf(" R%d-R%d", i, end);
+            i = end;
+        }
+    }
+}
 
 namespace TemporaryBuffer {
 
-    vector<TimedSnapshot> buffer;
+    vector<SnapshotRecord> buffer;
 
-    void update(const TimedSnapshot& newSnapshot) {
-        // If you only want to keep the latest one, clear first:
-        buffer.clear();
+    void open(uint8_t slave, uint32_t epoch) {
+        for (auto& snap : buffer) {
+            if (snap.slave == slave) return;
+        }
 
-        // Then push the new snapshot
-        buffer.push_back(newSnapshot);
+        // Capacity is kept, no reallocation after the first cycle
+        if (buffer.capacity() < SlaveRegistry::MAX_SLAVES) buffer.reserve(SlaveRegistry::MAX_SLAVES);
+        buffer.emplace_back();
+        SnapshotRecord& snap = buffer.back();
+        snap.clear();
+        snap.epoch = epoch;
+        snap.slave = slave;
+    }
+
+    SnapshotRecord& record(uint8_t slave) {
+        for (auto& snap : buffer) {
+            if (snap.slave == slave) return snap;
+        }
+        // Response outside a polling cycle (blocking send)
+        open(slave, (uint32_t)time(nullptr));
+        return buffer.back();
+    }
 
-        DEBUG_PRINTF("[TempBuffer] 📥 Updated with snapshot at %s (size=%d)\n",
-                     newSnapshot.timestamp.c_str(), (int)newSnapshot.values.size());
+    void markFailed(uint8_t slave, uint16_t startAddr, uint16_t quantity) {
+        if (startAddr >= REGISTER_COUNT) return;
+        uint32_t end = (uint32_t)startAddr + quantity;
+        if (end > REGISTER_COUNT) end = REGISTER_COUNT;
+        SnapshotRecord& snap = record(slave);
+        for (uint16_t reg = startAddr; reg < end; reg++) snap.fail(reg);
     }
 
-    const vector<TimedSnapshot>& getAll() {
+    size_t commit() {
+        size_t kept = 0;
+        for (size_t i = 0; i < buffer.size(); i++) {
+            const SnapshotRecord& snap = buffer[i];
+            if (snap.present == 0) {
+                counters.empty++;
+                Serial.printf("[TempBuffer] ⚠️ Slave %u: nothing arrived this cycle\n", snap.slave);
+                continue;
+            }
+            if (snap.failed) {
+                counters.partial++;
+                Serial.printf("[TempBuffer] ⚠️ Slave %u partial (mask=0x%04X), failed:", snap.slave, snap.present);
+                printRanges(snap.failed);
+                Serial.println();
+            } else {
+                counters.complete++;
+            }
+            if (kept != i) buffer[kept] = snap;
+            kept++;
+        }
+        buffer.resize(kept);
+
+        DEBUG_PRINTF("[TempBuffer] 📥 Committed %u record(s)\n", (unsigned)kept);
+        return kept;
+    }
+
+    const vector<SnapshotRecord>& getAll() {
         return buffer;
     }
 
@@ -25,4 +88,11 @@ namespace TemporaryBuffer {
         DEBUG_PRINTLN("[TempBuffer] 🧹 Cleared temporary buffer.");
     }
 
+    const Stats& stats() { return counters; }
+
+    void printStats() {
+        DEBUG_PRINTF("[TempBuffer] Records: %u complete, %u partial, %u empty\n",
+                     counters.complete, counters.partial, counters.empty);
+    }
+
 }  // namespace TemporaryBuffer
@@ -0,0 +1,298 @@
+#include "transaction_engine.h"
+#include "inverter_comm.h"
+#include "hex_codec.h"
+#include "modbus_utils.h"
+#include "debug_utils.h"
+
+namespace {
+
+    enum TxState : uint8_t {
+        TX_QUEUED,
+        TX_SENDING,
+        TX_AWAITING,
+        TX_VALIDATING,
+        TX_BACKOFF,
+        TX_DONE,
+        TX_FAILED
+    };
+
+    struct Transaction {
+        FramePool::Handle request;
+        FramePool::Handle response;    // RTU frame once DONE, NONE before
+        TxState state;
+        uint8_t attempts;
+        int8_t slot;                 // transport slot while on the wire, -1 otherwise
+        unsigned long deadline;      // response deadline or retry time
+    };
+
+    TransactionEngine::Config config = {
+        TransactionEngine::MAX_IN_FLIGHT, 3, 3000, 400
+    };
+    TransactionEngine::CompletionCallback completionCb = nullptr;
+    TransactionEngine::Stats counters = {};
+
+    // Queue in submission order; entries shift on insert/remove (at most MAX_QUEUED)
+    Transaction transactions[TransactionEngine::MAX_QUEUED];
+    size_t txCount = 0;
+    bool slotBusy[TransactionEngine::MAX_IN_FLIGHT] = {false};
+
+    // Responses arrive here (full RTU ADU) and are copied into a pool slot
+    uint8_t rxFrame[HexCodec::MAX_FRAME_BYTES];
+
+    const FramePool::Frame& requestOf(const Transaction& tx) { return FramePool::get(tx.request); }
+
+    bool isWrite(const FramePool::Frame& frame) {
+        return frame.len > 1 && (frame[1] == 0x06 || frame[1] == 0x10);
+    }
+
+    void releaseFrames(Transaction& tx) {
+        FramePool::release(tx.request);
+        FramePool::release(tx.response);
+        tx.request = tx.response = FramePool::NONE;
+    }
+
+    int8_t acquireSlot() {
+        for (uint8_t s = 0; s < config.inFlight; s++) {
+            if (!slotBusy[s]) { slotBusy[s] = true; return (int8_t)s; }
+        }
+        return -1;
+    }
+
+    void releaseSlot(Transaction& tx) {
+        if (tx.slot >= 0) slotBusy[tx.slot] = false;
+        tx.slot = -1;
+    }
+
+    // An earlier write to the same slave blocks everything queued behind
+    // it for that slave until its completion callback has run (it may
+    // queue FC06 fallback frames); other slaves go ahead
+    bool blockedByWrite(size_t index) {
+        uint8_t slave = requestOf(transactions[index]).slave();
+        for (size_t i = 0; i < index; i++) {
+            const FramePool::Frame& earlier = requestOf(transactions[i]);
+            if (earlier.slave() == slave && isWrite(earlier)) return true;
+        }
+        return false;
+    }
+
+    // A slave keeps at most one frame on the wire while another slave's
+    // frame waits for a slot, so a slow device cannot hold every slot
+    bool slaveHoldsSlot(size_t index) {
+        uint8_t slave = requestOf(transactions[index]).slave();
+        bool slaveOnWire = false;
+        bool otherWaiting = false;
+        for (size_t i = 0; i < txCount; i++) {
+            const Transaction& tx = transactions[i];
+            if (requestOf(tx).slave() == slave) {
+                slaveOnWire = slaveOnWire || tx.slot >= 0;
+            } else if (tx.state == TX_QUEUED) {
+                otherWaiting = true;
+            }
+        }
+        return slaveOnWire && otherWaiting;
+    }
+
+    void scheduleRetry(Transaction& tx, unsigned long now) {
+        releaseSlot(tx);
+        FramePool::release(tx.response);
+        tx.response = FramePool::NONE;
+        tx.attempts++;
+        if (tx.attempts >= config.maxAttempts) {
+            counters.failed++;
+            DEBUG_PRINTF("[TxEngine] Frame FC=0x%02X FAILED after %d attempts.\n",
+                         requestOf(tx)[1], tx.attempts);
+            tx.state = TX_FAILED;
+            return;
+        }
+        counters.retries++;
+        unsigned long backoff = config.backoffMs << (tx.attempts - 1);
+        DEBUG_PRINTF("[TxEngine] Retry in %lu ms (attempt %d)\n", backoff, tx.attempts + 1);
+        tx.deadline = now + backoff;
+        tx.state = TX_BACKOFF;
+    }
+}
+
+namespace TransactionEngine {
+
+    void begin(CompletionCallback onComplete) {
+        completionCb = onComplete;
+
+        for (uint8_t s = 0; s < MAX_IN_FLIGHT; s++) {
+            InverterSim::getTransport(s).setTimeout(config.timeoutMs);
+        }
+
+        DEBUG_PRINTF("[TxEngine] Ready over %s (%d in flight, %d attempts, timeout %lu ms)\n",
+                     InverterTransport::kindName(InverterSim::getTransportKind()),
+                     config.inFlight, config.maxAttempts, config.timeoutMs);
+    }
+
+    void configure(const Config& cfg) {
+        config = cfg;
+        if (config.inFlight < 1) config.inFlight = 1;
+        if (config.inFlight > MAX_IN_FLIGHT) config.inFlight = MAX_IN_FLIGHT;
+        if (config.maxAttempts < 1) config.maxAttempts = 1;
+        for (uint8_t s = 0; s < MAX_IN_FLIGHT; s++) {
+            InverterSim::getTransport(s).setTimeout(config.timeoutMs);
+        }
+    }
+
+    const Config& getConfig() { return config; }
+
+    bool submit(FramePool::Handle frame, bool front) {
+        FrameQueue one;
+        one.push(frame);
+        return submitAll(one, front) == 1;
+    }
+
+    size_t submitAll(FrameQueue& frames, bool front) {
+        FramePool::Handle handles[FrameQueue::CAPACITY];
+        uint8_t n = frames.take(handles);
+
+        Transaction batch[MAX_QUEUED];
+        size_t queued = 0;
+        for (uint8_t k = 0; k < n; k++) {
+            if (FramePool::get(handles[k]).len < 4) {
+                FramePool::release(handles[k]);
+                continue;
+            }
+            if (txCount + queued >= MAX_QUEUED) {
+                // Reported like a failed frame, so dropped reads count as failed registers
+                Serial.printf("[TxEngine] ⚠️ Queue full, %d frame(s) dropped.\n", n - k);
+                for (; k < n; k++) {
+                    counters.dropped++;
+                    if (completionCb) completionCb(FramePool::get(handles[k]), FramePool::get(FramePool::NONE), false);
+                    FramePool::release(handles[k]);
+                }
+                break;
+            }
+            Transaction& tx = batch[queued++];
+            tx.request = handles[k];
+            tx.response = FramePool::NONE;
+            tx.state = TX_QUEUED;
+            tx.attempts = 0;
+            tx.slot = -1;
+            tx.deadline = 0;
+        }
+
+        size_t pos = front ? 0 : txCount;
+        memmove(&transactions[pos + queued], &transactions[pos], (txCount - pos) * sizeof(Transaction));
+        memcpy(&transactions[pos], batch, queued * sizeof(Transaction));
+        txCount += queued;
+        counters.submitted += queued;
+
+        DEBUG_PRINTF("[TxEngine] Queued %d frame(s), %d pending\n", (int)queued, (int)txCount);
+        return queued;
+    }
+
+    void handle() {
+        if (txCount == 0) return;
+        unsigned long now = millis();
+
+        for (size_t i = 0; i < txCount; i++) {
+            Transaction& tx = transactions[i];
+
+            switch (tx.state) {
+            case TX_BACKOFF:
+                if ((long)(now - tx.deadline) < 0) break;
+                tx.state = TX_QUEUED;
+                // fall through
+            case TX_QUEUED:
+                if (blockedByWrite(i) || slaveHoldsSlot(i)) break;
+                tx.slot = acquireSlot();
+                if (tx.slot < 0) break;
+                tx.state = TX_SENDING;
+                // fall through
+            case TX_SENDING:
+                if (InverterSim::getTransport(tx.slot).begin(requestOf(tx).bytes, requestOf(tx).len)) {
+                    tx.deadline = now + config.timeoutMs;
+                    tx.state = TX_AWAITING;
+                } else {
+                    scheduleRetry(tx, now);
+                }
+                break;
+
+            case TX_AWAITING: {
+                size_t len = 0;
+                InverterTransport::Status st = InverterSim::getTransport(tx.slot).poll(rxFrame, sizeof(rxFrame), len);
+                if (st == InverterTransport::DONE) {
+                    tx.response = FramePool::copy(rxFrame, len);
+                    if (tx.response == FramePool::NONE) {
+                        scheduleRetry(tx, now);
+                        break;
+                    }
+                    tx.state = TX_VALIDATING;
+                } else if (st == InverterTransport::FAILED) {
+                    scheduleRetry(tx, now);
+                    break;
+                } else {
+                    if ((long)(now - tx.deadline) >= 0) {
+                        DEBUG_PRINTLN("[TxEngine] ⏱️ Response deadline passed.");
+                        InverterSim::getTransport(tx.slot).abort();
+                        scheduleRetry(tx, now);
+                    }
+                    break;
+                }
+            }
+                // fall through
+            case TX_VALIDATING: {
+                const FramePool::Frame& frame = FramePool::get(tx.response);
+                size_t len = frame.len;
+                if (len < 4 || Modbus::modbusCRC(frame.bytes, len - 2) !=
+                                   (uint16_t)(frame[len - 2] | (frame[len - 1] << 8))) {
+                    DEBUG_PRINTLN("[TxEngine] Invalid response frame.");
+                    scheduleRetry(tx, now);
+                    break;
+                }
+                // With several slaves in flight a late or misrouted reply
+                // must not be decoded into another slave's record
+                const FramePool::Frame& request = requestOf(tx);
+                if (frame[0] != request[0] || (frame[1] & 0x7F) != request[1]) {
+                    counters.mismatched++;
+                    Serial.printf("[TxEngine] ⚠️ Reply from slave %u FC=0x%02X to slave %u FC=0x%02X, retrying.\n",
+                                  frame[0], frame[1], request[0], request[1]);
+                    scheduleRetry(tx, now);
+                    break;
+                }
+                releaseSlot(tx);
+                tx.state = TX_DONE;
+                break;
+            }
+
+            default:
+                break;
+            }
+        }
+
+        // Hand finished transactions to the decoder; callbacks may submit
+        // follow-up frames, so detach the finished ones first
+        Transaction finished[MAX_QUEUED];
+        size_t doneCount = 0;
+        size_t kept = 0;
+        for (size_t i = 0; i < txCount; i++) {
+            if (transactions[i].state == TX_DONE || transactions[i].state == TX_FAILED) {
+                finished[doneCount++] = transactions[i];
+            } else {
+                transactions[kept++] = transactions[i];
+            }
+        }
+        txCount = kept;
+        for (size_t i = 0; i < doneCount; i++) {
+            Transaction& tx = finished[i];
+            bool success = tx.state == TX_DONE;
+            if (completionCb) completionCb(requestOf(tx), FramePool::get(success ? tx.response : FramePool::NONE), success);
+            releaseFrames(tx);
+        }
+    }
+
+    bool idle() { return txCount == 0; }
+    size_t pending() { return txCount; }
+
+    const Stats& stats() { return counters; }
+
+    void printStats() {
+        DEBUG_PRINTF("[TxEngine] Frames: %u submitted, %u dropped, %u retries, %u failed, %u mismatched\n",
+                     counters.submitted, counters.dropped, counters.retries,
+                     counters.failed, counters.mismatched);
+    }
+
+}  // namespace TransactionEngine
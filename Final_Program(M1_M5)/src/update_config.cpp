@@ -1,4 +1,7 @@
 #include "update_config.h"
+#include "poll_scheduler.h"
+#include "deadband.h"
+#include "slave_registry.h"
 
 static unsigned long lastInterval = 0;
 static String lastVersion = "unknown";
@@ -6,13 +9,32 @@ static String lastVersion = "unknown";
 // ✅ Use the global instance
 extern RequestSIM requestSim;
 
+// Index of a top-level key, skipping the per-slave copies inside "slaves":[...]
+static int topLevelKey(const String& json, const char* key) {
+    int spanStart = json.indexOf("\"slaves\"");
+    int spanEnd = -1;
+    if (spanStart != -1) {
+        int depth = 0;
+        for (int i = json.indexOf('[', spanStart); i >= 0 && i < (int)json.length(); i++) {
+            if (json[i] == '[') depth++;
+            else if (json[i] == ']' && --depth == 0) { spanEnd = i; break; }
+        }
+    }
+
+    int pos = json.indexOf(key);
+    while (pos != -1 && spanEnd != -1 && pos > spanStart && pos < spanEnd) {
+        pos = json.indexOf(key, spanEnd);
+    }
+    return pos;
+}
+
 namespace UpdateConfig {
 
     void updateFromCloud(const String& json) {
         requestSim.clear();
 
         // --- Parse reg_read array ---
-        int start = json.indexOf("\"reg_read\"");
+        int start = topLevelKey(json, "\"reg_read\"");
         if (start == -1) {
             Serial.println("[UpdateConfig] ⚠️ reg_read not found in JSON");
         } else {
@@ -63,6 +85,36 @@ namespace UpdateConfig {
         }
 
 
+        // --- Parse reg_period array (ms per register, 0 = every interval) ---
+        int periodKey = json.indexOf("\"reg_period\"");
+        if (periodKey != -1) {
+            int arrayStart = json.indexOf('[', periodKey);
+            int arrayEnd   = json.indexOf(']', arrayStart);
+            if (arrayStart != -1 && arrayEnd != -1) {
+                PollScheduler::clearPeriods();
+                int idx = 0;
+                int lastPos = arrayStart + 1;
+                while (idx < NUM_REGISTERS && lastPos < arrayEnd) {
+                    int comma = json.indexOf(',', lastPos);
+                    if (comma == -1 || comma > arrayEnd) comma = arrayEnd;
+                    String token = json.substring(lastPos, comma);
+                    token.trim();
+                    long period = token.toInt();
+                    PollScheduler::setPeriod(idx, period > 0 ? (uint32_t)period : 0);
+
+                    idx++;
+                    lastPos = comma + 1;
+                }
+                Serial.println("[UpdateConfig] ✅ reg_period[] updated from config");
+            }
+        }
+
+        // --- Parse deadband (report-by-exception) settings ---
+        Deadband::updateFromConfig(json);
+
+        // --- Parse the inverter list (per-slave reg_read optional) ---
+        SlaveRegistry::updateFromConfig(json);
+
         // --- Parse version ---
         int versionKey = json.indexOf("\"version\"");
         if (versionKey != -1) {
@@ -77,7 +129,8 @@ namespace UpdateConfig {
         // Debug summary
         Serial.println("[UpdateConfig] ✅ Final requestSim.read[]:");
         for (int i = 0; i < NUM_REGISTERS; i++) {
-            Serial.printf("  read[%d] = %d\n", i, requestSim.read[i]);
+            Serial.printf("  read[%d] = %d  period = %lu ms\n", i, requestSim.read[i],
+                          (unsigned long)PollScheduler::getPeriod(i));
             if (i % 10 == 0) yield();  // Prevent buffer overflow every 10 items
         }
         Serial.flush();
@@ -16,6 +16,8 @@
 #include "inverterSIM_utils.h"
 #include "frame_queue.h"
 #include "firmware_updater.h"
+#include "spool.h"
+#include "slave_registry.h"
 
 // ⚙️ Local namespace variables
 namespace {
@@ -24,6 +26,7 @@ namespace {
     const unsigned long uploadInterval = 30000; // every 30 seconds
 
     CloudClient cloud;
+    int lastHttpCode = 0;   // status of the last upload (<= 0: no HTTP response)
 }
 
 // 🌐 UploadManager namespace implementation
@@ -44,6 +47,7 @@ namespace UploadManager {
 
     // 📤 Upload binary data to cloud
     bool uploadtoCloud(const std::vector<uint8_t>& data) {
+        lastHttpCode = 0;
         if (WiFi.status() != WL_CONNECTED) {
             DEBUG_PRINTLN("[UploadManager] ❌ Wi-Fi not connected. Upload skipped.");
             return false;
@@ -65,6 +69,7 @@ namespace UploadManager {
         http.addHeader("Content-Type", "application/octet-stream");
 
         int httpCode = http.POST((uint8_t*)data.data(), data.size());
+        lastHttpCode = httpCode;
 
         // Capture response payload (if any) for diagnostics
         String httpBody;
@@ -93,28 +98,36 @@ namespace UploadManager {
         return false;
     }
 
-    // 🔁 Periodic upload + cloud command handling
-    void handle() {
-        unsigned long now = millis();
-        if (now - lastUploadTime < uploadInterval) return;
-        lastUploadTime = now;
-
-        // Check available heap before processing
-        uint32_t freeHeap = ESP.getFreeHeap();
-        DEBUG_PRINTF("[UploadManager] Free Heap: %u bytes\n", freeHeap);
-        
-        if (freeHeap < 8192) {  // Less than 8KB free
-            DEBUG_PRINTLN("[UploadManager] ⚠️ Low memory! Skipping upload cycle.");
-            return;
+    // 💾 Send spooled batches, oldest first, at most maxBatches per call
+    bool drainSpool(uint8_t maxBatches) {
+        if (Spool::isEmpty()) return true;
+        if (WiFi.status() != WL_CONNECTED) return false;
+
+        std::vector<uint8_t> packet;
+        Spool::BatchInfo info;
+        for (uint8_t n = 0; n < maxBatches && Spool::peekOldest(packet, &info); n++) {
+            DEBUG_PRINTF("[UploadManager] 📤 Backlog batch #%u (%u B, %u..%u)\n",
+                         info.seq, info.length, info.firstEpoch, info.lastEpoch);
+            if (!uploadtoCloud(packet)) {
+                // Network trouble: retry next cycle. A 4xx means the cloud
+                // will never take this packet, so it is not retried.
+                if (lastHttpCode < 400 || lastHttpCode >= 500) break;
+                DEBUG_PRINTF("[UploadManager] ⚠️ Backlog batch #%u rejected (%d), discarded\n",
+                             info.seq, lastHttpCode);
+            }
+            Spool::commitOldest();
+            yield();
         }
+        Spool::printStats();
+        return Spool::isEmpty();
+    }
 
-        DEBUG_PRINTLN("[UploadManager] ⏫ Upload check triggered.");
-
-        // 🔄 Check for firmware updates at start of each upload cycle
-        FirmwareUpdater::handle();
-
-        // ☁️ Upload compressed + encrypted payload
-           auto compressed = initiateCompression();
+    // ☁️ Encrypts one block and uploads it, or spools it when it cannot be
+    // sent now. Returns true once the block may be released from RAM.
+    static bool shipBlock(const Buffer::Block& block, bool backlogClear) {
+           // Behind a backlog the block is spooled, never sent now: build
+           // it as a keyframe so nothing refers to an undelivered batch
+           auto compressed = initiateCompression(block, !backlogClear);
         // std::vector<uint8_t> encrypted = encryptBuffer(compressed);
         // std::vector<uint8_t> decrypted = decryptBuffer(encrypted);
             // 2️⃣ Encrypt (returns a new vector)
@@ -125,6 +138,7 @@ namespace UploadManager {
             unsigned long __t1 = micros();
             pe_addCpuMs((__t1 - __t0) / 1000UL);
 
+#if COMPRESSION_DIAGNOSTICS
             // ===== Power Estimator: measure decryption time =====
             unsigned long __t2 = micros();
             vector<uint8_t> decrypted = decryptBuffer(encrypted);
@@ -150,16 +164,72 @@ namespace UploadManager {
         if (decrypted.size() > 64) Serial.printf("... (%d more bytes)", decrypted.size() - 64);
         Serial.println();
         Serial.flush();  // Ensure data is sent
+#endif
             
-            // Upload compressed+encrypted data
-            bool ok = UploadManager::uploadtoCloud(encrypted);
+            // Upload compressed+encrypted data (queued behind any backlog)
+            bool ok = backlogClear && UploadManager::uploadtoCloud(encrypted);
+
+            // A referenced payload only decodes against the cloud's copy of
+            // the previous batch: it is never spooled, and is resent whole
+            // when the cloud has lost that copy (409)
+            if (!ok && isReferencedPayload(compressed)) {
+                bool resync = lastHttpCode == 409;
+                dropUploadReference();
+                compressed = initiateCompression(block, true, true);
+                encrypted = encryptBuffer(compressed);
+                if (resync) {
+                    DEBUG_PRINTLN("[UploadManager] 🔗 Cloud asked for a resync → resending as keyframe");
+                    ok = UploadManager::uploadtoCloud(encrypted);
+                }
+            }
 
             if (ok) {
-                DEBUG_PRINTLN("[UploadManager] ✅ Upload successful → clearing buffer");
-                Buffer::clear();
-            } else {
-                DEBUG_PRINTLN("[UploadManager] ❌ Upload failed → buffer NOT cleared");
+                acknowledgeUpload();
+                DEBUG_PRINTLN("[UploadManager] ✅ Upload successful → releasing uploaded snapshots");
+                return true;
             }
+            dropUploadReference();
+            if (Spool::append(encrypted, block.firstEpoch, block.lastEpoch)) {
+                DEBUG_PRINTLN("[UploadManager] 💾 Not sent → block spooled to flash");
+                return true;
+            }
+            DEBUG_PRINTLN("[UploadManager] ❌ Upload failed → buffer NOT cleared");
+            return false;
+    }
+
+    // 🔁 Periodic upload + cloud command handling
+    void handle() {
+        unsigned long now = millis();
+        if (now - lastUploadTime < uploadInterval) return;
+        lastUploadTime = now;
+
+        // Check available heap before processing
+        uint32_t freeHeap = ESP.getFreeHeap();
+        DEBUG_PRINTF("[UploadManager] Free Heap: %u bytes\n", freeHeap);
+        
+        if (freeHeap < 8192) {  // Less than 8KB free
+            DEBUG_PRINTLN("[UploadManager] ⚠️ Low memory! Skipping upload cycle.");
+            return;
+        }
+
+        DEBUG_PRINTLN("[UploadManager] ⏫ Upload check triggered.");
+
+        // 🔄 Check for firmware updates at start of each upload cycle
+        FirmwareUpdater::handle();
+
+        // 💾 Backlog first: packets must reach the cloud in sequence order
+        bool backlogClear = drainSpool(SPOOL_DRAIN_BATCHES_PER_CYCLE);
+
+        // ☁️ Upload the sealed blocks, oldest first
+        Buffer::seal();
+        for (Buffer::Batch batch = Buffer::peek(1); batch.count > 0; batch = Buffer::peek(1)) {
+            const Buffer::Block* block = Buffer::get(batch.firstSeq);
+            if (!block || !shipBlock(*block, backlogClear)) break;
+            Buffer::commit(batch);
+            backlogClear = backlogClear && Spool::isEmpty();   // later blocks queue behind it
+            yield();
+        }
+        printCompressionStats();
         // 🔹 Fetch configuration and command data
         yield();  // Prevent watchdog timeout
         String config_response;
@@ -209,6 +279,12 @@ namespace UploadManager {
             commandsBlock.trim();  // Remove whitespace
             int start = 0;
 
+            // 🧱 One RequestSIM per slave collects every command so adjacent
+            //    writes can be batched into a single FC16 frame
+            RequestSIM cloudRequestSims[SlaveRegistry::MAX_SLAVES];
+            for (auto& req : cloudRequestSims) req.clear();
+            int queuedCommands = 0;
+
             // 🔁 Parse all commands in the array
             while (true) {
                 yield();  // Prevent watchdog timeout in loop
@@ -226,6 +302,8 @@ namespace UploadManager {
                 String action    = cloud.getValue(cmdObj, "action");
                 String targetReg = cloud.getValue(cmdObj, "target_register");
                 String value     = cloud.getValue(cmdObj, "value");
+                String device    = cmdObj.indexOf("\"device\"") != -1
+                                     ? cloud.getValue(cmdObj, "device") : String();  // optional slave address
 
                 if (action.isEmpty() || targetReg.isEmpty() || value.isEmpty()) {
                     DEBUG_PRINTLN("[UploadManager] ⚠️ Skipping incomplete command.");
@@ -235,13 +313,23 @@ namespace UploadManager {
                 DEBUG_PRINTF("[UploadManager] 📩 Parsed command: Action=%s Target=%s Value=%s\n",
                              action.c_str(), targetReg.c_str(), value.c_str());
 
-                // 🧱 Create a temporary RequestSIM object for this command
-                RequestSIM cloudRequestSim;
-                cloudRequestSim.clear();
-
                 int regIndex = strtol(targetReg.c_str(), nullptr, 0);
                 uint16_t data = (uint16_t)value.toInt();
 
+                if (regIndex < 0 || regIndex >= NUM_REGISTERS) {
+                    DEBUG_PRINTF("[UploadManager] ⚠️ Register out of range: %d\n", regIndex);
+                    continue;
+                }
+
+                // Untagged commands go to the default (first) slave
+                long address = device.isEmpty() ? SlaveRegistry::defaultAddress() : device.toInt();
+                int slaveIndex = (address > 0 && address < 256) ? SlaveRegistry::indexOf((uint8_t)address) : -1;
+                if (slaveIndex < 0) {
+                    DEBUG_PRINTF("[UploadManager] ⚠️ Unknown device: %s\n", device.c_str());
+                    continue;
+                }
+                RequestSIM& cloudRequestSim = cloudRequestSims[slaveIndex];
+
                 if (action.equalsIgnoreCase("write_register")) {
                     cloudRequestSim.write[regIndex] = true;
                     cloudRequestSim.writeData[regIndex] = data;
@@ -251,40 +339,53 @@ namespace UploadManager {
                     DEBUG_PRINTF("[UploadManager] ⚠️ Unknown action: %s\n", action.c_str());
                     continue;
                 }
+                queuedCommands++;
+            }
 
-                // 🔹 Decode into Modbus frames (adds to frameQueue)
-                const auto& frames = ProtocolAdapter::decodeRequestStruct(cloudRequestSim);
-                
-                // 🔹 Process the frames immediately
-                InverterSim::processFrameQueue(frames);
+            int unqueued = 0;
+            if (queuedCommands > 0) {
+                // 🔹 Decode all commands into Modbus frames (adds to frameQueue)
+                for (uint8_t i = 0; i < SlaveRegistry::count(); i++) {
+                    unqueued += ProtocolAdapter::decodeRequestStruct(cloudRequestSims[i], SlaveRegistry::address(i));
+                }
+                ProtocolAdapter::interleaveBySlave(frameQueue);
+
+                // 🔹 Process the frames in one pass
+                InverterSim::processFrameQueue(frameQueue);
                 frameQueue.clear();
             }
 
             // ================================================================
-            // 📬 Send ACK after processing all commands
+            // 📬 Send ACK after processing all commands. The ACK clears the
+            //    whole cloud queue, so it is held back when a frame could not
+            //    be queued; the commands are fetched again next time.
             // ================================================================
-            time_t now = time(nullptr);
-            struct tm* t = localtime(&now);
-            char timeBuf[25];
-            strftime(timeBuf, sizeof(timeBuf), "%Y-%m-%dT%H:%M:%S", t);
-
-            String ackPayload;
-            ackPayload.reserve(150);  // Pre-allocate to prevent fragmentation
-            ackPayload = "{";
-            ackPayload += "\"command_result\":{";
-            ackPayload += "\"result\":\"success\",";
-            ackPayload += "\"executed_at\":\"" + String(timeBuf) + "\"";
-            ackPayload += "}";
-            ackPayload += "}";
-
-            DEBUG_PRINTLN("[UploadManager] 🚀 Sending ACK to cloud...");
-            yield();  // Prevent watchdog timeout
-            bool ackOk = cloud.postJSON(target.fetchCommandEndpoint.c_str(), ackPayload);
-
-            if (ackOk)
-                DEBUG_PRINTLN("[UploadManager] ✅ ACK sent successfully!");
-            else
-                DEBUG_PRINTLN("[UploadManager] ⚠️ Failed to send ACK.");
+            if (unqueued > 0) {
+                Serial.printf("[UploadManager] ⚠️ %d command frame(s) not queued, ACK withheld\n", unqueued);
+            } else {
+                time_t now = time(nullptr);
+                struct tm* t = localtime(&now);
+                char timeBuf[25];
+                strftime(timeBuf, sizeof(timeBuf), "%Y-%m-%dT%H:%M:%S", t);
+
+                String ackPayload;
+                ackPayload.reserve(150);  // Pre-allocate to prevent fragmentation
+                ackPayload = "{";
+                ackPayload += "\"command_result\":{";
+                ackPayload += "\"result\":\"success\",";
+                ackPayload += "\"executed_at\":\"" + String(timeBuf) + "\"";
+                ackPayload += "}";
+                ackPayload += "}";
+
+                DEBUG_PRINTLN("[UploadManager] 🚀 Sending ACK to cloud...");
+                yield();  // Prevent watchdog timeout
+                bool ackOk = cloud.postJSON(target.fetchCommandEndpoint.c_str(), ackPayload);
+
+                if (ackOk)
+                    DEBUG_PRINTLN("[UploadManager] ✅ ACK sent successfully!");
+                else
+                    DEBUG_PRINTLN("[UploadManager] ⚠️ Failed to send ACK.");
+            }
         }
         
         // Free memory from large strings
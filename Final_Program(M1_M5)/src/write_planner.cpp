@@ -0,0 +1,37 @@
+#include "write_planner.h"
+#include "debug_utils.h"
+#include "register_map.h"
+
+namespace WritePlanner {
+
+    vector<WriteRange> plan(const RequestSIM& input, uint16_t maxRegsPerFrame) {
+        vector<WriteRange> ranges;
+        if (maxRegsPerFrame < 1) maxRegsPerFrame = 1;
+        if (maxRegsPerFrame > FC16_MAX_REGS) maxRegsPerFrame = FC16_MAX_REGS;
+
+        for (int r = 0; r < NUM_REGISTERS; r++) {
+            if (input.write[r] && !RegisterMap::isWritable(r)) {
+                Serial.printf("[WritePlanner] ⚠️ R%d is read-only, write of %u dropped\n",
+                              r, input.writeData[r]);
+            }
+        }
+
+        auto wanted = [&](int r) { return input.write[r] && RegisterMap::isWritable(r); };
+
+        int i = 0;
+        while (i < NUM_REGISTERS) {
+            if (!wanted(i)) { i++; continue; }
+
+            WriteRange range{(uint16_t)i, 0};
+            while (i < NUM_REGISTERS && wanted(i) && range.count < maxRegsPerFrame) {
+                range.count++;
+                i++;
+            }
+            ranges.push_back(range);
+        }
+
+        DEBUG_PRINTF("[WritePlanner] %u write run(s) planned\n", (unsigned)ranges.size());
+        return ranges;
+    }
+
+}  // namespace WritePlanner
@@ -0,0 +1,32 @@
+// Minimal Arduino API for host builds (pio test -e native). Only what the
+// modules built for the host tests use.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+
+typedef std::string String;
+
+#define PROGMEM
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+
+inline long random(long lo, long hi) { return lo + rand() % (hi - lo); }
+
+inline unsigned long micros() {
+    using namespace std::chrono;
+    return (unsigned long)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+inline void yield() {}
+
+struct HostSerial {
+    template <typename... Args>
+    void printf(const char* fmt, Args... args) { ::printf(fmt, args...); }
+    void println(const char* s = "") { ::printf("%s\n", s); }
+};
+inline HostSerial Serial;
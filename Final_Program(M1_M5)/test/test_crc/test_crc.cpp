@@ -0,0 +1,47 @@
+// Host test of the CRC16 variants in modbus_utils.cpp: pio test -e native
+#include <unity.h>
+#include "modbus_utils.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Read Holding Registers R0..R9 of slave 1, as sent by the firmware
+void test_known_frame() {
+    const uint8_t frame[] = {0x01, 0x03, 0x00, 0x00, 0x00, 0x0A};
+    TEST_ASSERT_EQUAL_HEX16(0xCDC5, Modbus::modbusCRC(frame, sizeof(frame)));
+    TEST_ASSERT_EQUAL_HEX16(0xCDC5, Modbus::crcBitwise(frame, sizeof(frame)));
+}
+
+// Bitwise, table, slicing-by-4 and the incremental API agree everywhere
+void test_random_frames_identical() {
+    srand(1);
+    uint8_t frame[256];
+    for (int f = 0; f < 20000; f++) {
+        size_t len = 1 + rand() % sizeof(frame);
+        for (size_t i = 0; i < len; i++) frame[i] = (uint8_t)rand();
+
+        uint16_t expected = Modbus::crcBitwise(frame, len);
+        TEST_ASSERT_EQUAL_HEX16(expected, Modbus::crcTable(Modbus::CRC_INIT, frame, len));
+        TEST_ASSERT_EQUAL_HEX16(expected, Modbus::crcSlice4(Modbus::CRC_INIT, frame, len));
+        TEST_ASSERT_EQUAL_HEX16(expected, Modbus::modbusCRC(frame, (int)len));
+
+        size_t split = rand() % (len + 1);
+        TEST_ASSERT_EQUAL_HEX16(expected, Modbus::crcUpdate(Modbus::crcUpdate(Modbus::CRC_INIT, frame, split),
+                                                            frame + split, len - split));
+    }
+}
+
+// Same benchmark as MODBUS_CRC_BENCHMARK on the device, timed on the host
+void test_benchmark() {
+    Modbus::CrcBenchResult r = Modbus::benchmarkCRC(5000, 256);
+    Modbus::printCrcBenchmark(r);
+    TEST_ASSERT_TRUE(r.identical);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_known_frame);
+    RUN_TEST(test_random_frames_identical);
+    RUN_TEST(test_benchmark);
+    return UNITY_END();
+}